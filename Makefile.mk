@@ -71,6 +71,8 @@ override MODE !=  case "$(MODE)" in \
 .config.defaults += MODE
 $(info $S  MODE     $(MODE))
 .config.defaults += INSN
+RTCHECK ?= # link malloc/free/mutex hooks for --check-rt
+.config.defaults += RTCHECK
 
 # == Dirctories ==
 prefix		 ?= /usr/local
@@ -203,6 +205,7 @@ help: FORCE
 	@echo '  make DESTDIR=/  - Absolute path prepended to all install/uninstall locations'
 	@echo "  make MODE=...   - Run 'quick' build or make 'production' mode binaries."
 	@echo '                    Other modes: debug, devel, asan, lsan, tsan, ubsan'
+	@echo '  make RTCHECK=1  - Link allocation and lock hooks for --check-rt (ignored for asan, lsan, tsan)'
 
 # == 'default' settings ==
 # Allow value defaults to be adjusted via: make default builddir=... CXX=...
@@ -7,7 +7,8 @@ include ase/tests/Makefile.mk
 # == ase/ *.cc file sets ==
 ase/jackdriver.sources		::= ase/driver-jack.cc
 ase/gtk2wrap.sources		::= ase/gtk2wrap.cc
-ase/noglob.cc			::= ase/main.cc $(ase/gtk2wrap.sources) $(ase/jackdriver.sources)
+ase/rtcheck.sources		::= ase/rtcheck-hooks.cc
+ase/noglob.cc			::= ase/main.cc $(ase/gtk2wrap.sources) $(ase/jackdriver.sources) $(ase/rtcheck.sources)
 ase/libsources.cc		::= $(filter-out $(ase/noglob.cc), $(wildcard ase/*.cc))
 ase/libsources.c		::= $(wildcard ase/*.c)
 ase/include.deps		::= $>/ase/sysconfig.h
@@ -15,6 +16,12 @@ ase/include.deps		::= $>/ase/sysconfig.h
 # == AnklangSynthEngine definitions ==
 lib/AnklangSynthEngine		::= $>/lib/AnklangSynthEngine
 ase/AnklangSynthEngine.sources	::= ase/main.cc $(ase/libsources.cc) $(ase/libsources.c)
+# Interpose malloc() & co for --check-rt only on request, sanitizers need their own allocators
+ifneq ($(RTCHECK),)
+ifeq ($(filter asan lsan tsan, $(MODE)),)
+ase/AnklangSynthEngine.sources	 += $(ase/rtcheck.sources)
+endif
+endif
 ase/AnklangSynthEngine.gensrc	::= $(strip \
 	$>/ase/api.jsonipc.cc		\
 	$>/ase/blake3impl.c		\
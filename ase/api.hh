@@ -198,6 +198,15 @@ struct DeviceInfo {
   String creator_url;  ///< Internet contact of the creator.
 };
 
+/// DSP load measurements, durations are given in microseconds.
+struct DspLoad {
+  float  last = 0;      ///< Render duration of the last block.
+  float  mean = 0;      ///< Mean render duration per block.
+  float  p99 = 0;       ///< 99th percentile of render durations (approximated).
+  float  max = 0;       ///< Maximum render duration.
+  int32  blocks = 0;    ///< Number of measured blocks.
+};
+
 /// Interface to access Device instances.
 class Device : public virtual Gadget {
 public:
@@ -212,6 +221,9 @@ public:
   virtual bool       is_active     () = 0;      ///< Check whether this is the active synthesis engine project.
   virtual DeviceInfo device_info   () = 0;      ///< Describe this Device type.
   void               remove_self   ();          ///< Remove device from its container.
+  // DSP load
+  DspLoad            dsp_load      ();          ///< Measure and retrieve DSP load of this device.
+  TelemetryFieldS    dsp_telemetry ();          ///< Measure DSP load, retrieve telemetry locations of the DspLoad fields.
   // GUI handling
   virtual void       gui_toggle    () = 0;      ///< Toggle GUI display.
   virtual bool       gui_supported () = 0;      ///< Has GUI display facilities.
@@ -267,6 +279,8 @@ public:
   virtual DeviceP         access_device       () = 0;                ///< Retrieve Device handle for this track.
   virtual MonitorP        create_monitor      (int32 ochannel) = 0;  /// Create signal monitor for an output channel.
   virtual TelemetryFieldS telemetry           () const = 0;          ///< Retrieve track telemetry locations.
+  virtual bool            frozen              () const = 0;          ///< Flag indicating playback from a frozen audio cache.
+  virtual bool            freeze              (bool onoff) = 0;      ///< Render the track into a frozen audio cache or discard it; emits `notify:frozen`.
 };
 
 /// Bits representing a selection of probe sample data features.
@@ -310,6 +324,9 @@ public:
   virtual bool            can_undo       () = 0;       ///< Check if any undo steps have been recorded.
   virtual void            redo           () = 0;       ///< Redo the last undo modification.
   virtual bool            can_redo       () = 0;       ///< Check if any redo steps have been recorded.
+  virtual int64           undo_memory    () const = 0; ///< Memory in bytes occupied by undo and redo steps.
+  virtual int64           undo_budget    () const = 0; ///< Memory limit for undo and redo steps.
+  virtual void            undo_budget    (int64 bytes) = 0; ///< Set memory limit, evicts the oldest undo steps.
   static ProjectP         last_project   ();
 };
 
@@ -2,6 +2,7 @@
 #include "clapdevice.hh"
 #include "clapplugin.hh"
 #include "project.hh"
+#include "track.hh"
 #include "processor.hh"
 #include "compress.hh"
 #include "properties.hh"
@@ -106,6 +107,8 @@ public:
   bool
   set_value (const Value &val) override
   {
+    if (TrackImpl *track = dynamic_cast<TrackImpl*> (device_->_track()))
+      track->freeze_invalidate();
     return device_->handle_->param_set_value (param_id, val.as_double());
   }
 };
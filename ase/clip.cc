@@ -36,7 +36,7 @@ ClipImpl::ClipImpl (TrackImpl &parent)
   track_ = &parent;
   notifytrack_ = on_event ("notify", [this] (const Event &event) {
     if (track_)
-      track_->update_clips();
+      track_->update_clip (*this);
   });
 }
 
@@ -66,7 +66,7 @@ ClipImpl::serialize (WritNode &xs)
   if (xs.in_save())
     {
       xs["ppq"] << TRANSPORT_PPQN;
-      OrderedEventsP event_vector = notes_.ordered_events<OrderedEventsV>();
+      OrderedEventsP event_vector = tick_events();
       for (ClipNote cnote : *event_vector)
         {
           WritNode xn = xs["notes"].push();
@@ -93,7 +93,7 @@ ClipImpl::serialize (WritNode &xs)
           note.tick = llrintl (note.tick * ppqfactor);
           note.duration = llrintl (note.duration * ppqfactor);
           note.selected = false;
-          notes_.insert (note);
+          note_insert (note);
         }
       emit_notify ("notes");
       emit_notify ("all_notes");
@@ -148,73 +148,157 @@ ClipImpl::all_notes () const
 ClipImpl::OrderedEventsP
 ClipImpl::tick_events () const
 {
-  return const_cast<ClipImpl*> (this)->notes_.ordered_events<OrderedEventsV> ();
+  if (!ordered_)
+    ordered_ = std::make_shared<const OrderedEventsV> (tick_notes_); // shares all chunks
+  return ordered_;
 }
 
-ClipImpl::EventImage::EventImage (const ClipNoteS &clipnotes)
+/// Insert or replace `note` (by id) into the id and tick indices.
+bool
+ClipImpl::note_insert (const ClipNote &note, ClipNote *replaced)
 {
-  const size_t clipnotes_bytes = clipnotes.size() * sizeof (clipnotes[0]);
-  cbuffer = zstd_compress (clipnotes.data(), clipnotes_bytes, 4);
-  assert_return (cbuffer.size() > 0);
-  ProjectImpl::undo_mem_counter += sizeof (*this) + cbuffer.size();
-  UDEBUG ("ClipImpl: store undo (notes=%d): %d->%d (%f%%)", clipnotes.size(),
-          clipnotes_bytes, cbuffer.size(), cbuffer.size() * 100.0 / clipnotes_bytes);
+  ClipNote old;
+  const bool existing = notes_.insert (note, &old);
+  if (undo_delta_)
+    undo_delta_->record (note.id, existing ? &old : nullptr);
+  if (existing)
+    tick_notes_.remove (old);
+  tick_notes_.insert (note);
+  ordered_ = nullptr;
+  if (existing && replaced)
+    *replaced = old;
+  return existing;
 }
 
-ClipImpl::EventImage::~EventImage()
+/// Remove `note` (by id) from the id and tick indices.
+bool
+ClipImpl::note_remove (const ClipNote &note)
 {
-  ProjectImpl::undo_mem_counter -= sizeof (*this) + cbuffer.size();
-  UDEBUG ("ClipImpl: free undo mem: %d\n", sizeof (*this) + cbuffer.size());
+  ClipNote old;
+  if (!notes_.remove (note, &old))
+    return false;
+  if (undo_delta_)
+    undo_delta_->record (old.id, &old);
+  tick_notes_.remove (old);
+  ordered_ = nullptr;
+  return true;
 }
 
 void
-ClipImpl::push_undo (const ClipNoteS &clipnotes, const String &undogroup)
+ClipImpl::notes_clear ()
+{
+  notes_.clear();
+  tick_notes_.clear();
+  ordered_ = nullptr;
+}
+
+/// Record the state of note `id` before its first change, `prior` is NULL for inserted notes.
+void
+ClipImpl::UndoDelta::record (int32 id, const ClipNote *prior)
+{
+  if (!seen.insert (id).second)
+    return;     // only the first change of a note matters
+  if (prior)
+    notes.push_back (*prior);
+  else
+    ids.push_back (id);
+}
+
+/// Finish recording, compress large note deltas and release bookkeeping memory.
+void
+ClipImpl::UndoDelta::seal ()
+{
+  std::unordered_set<int32>().swap (seen);
+  n_notes = notes.size();
+  const size_t notes_bytes = n_notes * sizeof (notes[0]);
+  if (notes_bytes >= 4096)
+    {
+      cbuffer = zstd_compress (notes.data(), notes_bytes, 4);
+      if (cbuffer.size() > 0 && cbuffer.size() < notes_bytes)
+        ClipNoteS().swap (notes);
+      else
+        String().swap (cbuffer);
+    }
+  else
+    notes.shrink_to_fit();
+  ids.shrink_to_fit();
+  cbuffer.shrink_to_fit();
+  UDEBUG ("ClipImpl: store undo (notes=%d ids=%d): %d->%d bytes", n_notes, ids.size(), notes_bytes, memory());
+}
+
+/// Exact number of bytes held by this delta.
+size_t
+ClipImpl::UndoDelta::memory () const
+{
+  return sizeof (*this) + notes.capacity() * sizeof (notes[0]) + ids.capacity() * sizeof (ids[0]) + cbuffer.capacity();
+}
+
+/// Retrieve prior note states, uncompressing if needed.
+ClipNoteS
+ClipImpl::UndoDelta::prior_notes () const
+{
+  if (cbuffer.empty())
+    return notes;
+  ClipNoteS onotes (n_notes);
+  const ssize_t osize = n_notes * sizeof (onotes[0]);
+  const ssize_t rsize = zstd_uncompress (cbuffer, onotes.data(), osize);
+  assert_return (rsize == osize, {});
+  return onotes;
+}
+
+void
+ClipImpl::push_undo (UndoDeltaP deltap, const String &undogroup)
 {
   auto thisp = shared_ptr_from (this);
-  EventImageP imagep = std::make_shared<EventImage> (clipnotes);
-  undo_scope (undogroup) += [thisp, imagep, undogroup] () { thisp->apply_undo (*imagep, undogroup); };
+  deltap->seal();
+  auto undofunc = [thisp, deltap, undogroup] () { thisp->apply_undo (*deltap, undogroup); };
+  const size_t mem = deltap->memory() + sizeof (undofunc) + undogroup.capacity();
+  undo_scope (undogroup).add (undofunc, mem);
 }
 
 void
-ClipImpl::apply_undo (const EventImage &image, const String &undogroup)
+ClipImpl::apply_undo (const UndoDelta &delta, const String &undogroup)
 {
-  push_undo (notes_.copy(), undogroup);
-  ClipNoteS onotes;
-  const ssize_t osize = zstd_target_size (image.cbuffer);
-  assert_return (osize >= 0 && osize == sizeof (onotes[0]) * (osize / sizeof (onotes[0])));
-  onotes.resize (osize / sizeof (onotes[0]));
-  const ssize_t rsize = zstd_uncompress (image.cbuffer, onotes.data(), osize);
-  assert_return (rsize == osize);
-  notes_.clear_silently();
-  for (const ClipNote &note : onotes)
-    notes_.insert (note);
+  // record the inverse delta while applying the undo step, that yields redo
+  UndoDeltaP redop = std::make_shared<UndoDelta>();
+  undo_delta_ = redop.get();
+  for (int32 id : delta.ids)
+    note_remove (ClipNote { .id = id });
+  for (const ClipNote &note : delta.prior_notes())
+    note_insert (note);
+  undo_delta_ = nullptr;
+  push_undo (redop, undogroup);
   emit_notify ("notes");
   emit_notify ("all_notes");
 }
 
+/// Remove notes at the same tick, key and channel as the notes in `batch`, preserving newer notes.
 size_t
-ClipImpl::collapse_notes (EventsById &inotes, const bool preserve_selected)
+ClipImpl::collapse_notes (const ClipNoteS &batch, const bool preserve_selected)
 {
-  ClipNoteS copies = inotes.copy();
   size_t collapsed = 0;
-  // sort notes by tick, keep order; delete from lhs, preserve newer entries on rhs
-  std::stable_sort (copies.begin(), copies.end(), [] (const ClipNote &a, const ClipNote &b) {
-    return a.tick < b.tick;
-  });
-  // remove duplicates at the same tick
-  for (size_t i = 0; i < copies.size(); i++) {
-    const ClipNote &note = copies[i];
-    for (size_t j = i + 1; j < copies.size(); j++) {
-      if (note.tick != copies[j].tick)
-        break;
-      if (note.key == copies[j].key && note.channel == copies[j].channel) {
-        if (note.selected != copies[j].selected && preserve_selected)
-          continue;
-        // note has a successor at same tick, with same key, channel
-        collapsed += inotes.remove (note);
-      }
+  ClipNoteS group;
+  for (const ClipNote &bnote : batch)
+    {
+      if (bnote.duration == 0 || bnote.channel < 0)
+        continue;
+      // gather notes at the same tick with same key and channel
+      group.clear();
+      const ClipNote first = { .channel = bnote.channel, .key = bnote.key, .tick = bnote.tick };
+      for (auto it = tick_notes_.lower_bound (first); it != tick_notes_.end(); ++it)
+        if (it->tick == bnote.tick && it->key == bnote.key && it->channel == bnote.channel)
+          group.push_back (*it);
+        else
+          break;
+      // delete notes that have a newer successor
+      for (const ClipNote &note : group)
+        for (const ClipNote &other : group)
+          if (other.id > note.id && (other.selected == note.selected || !preserve_selected))
+            {
+              collapsed += note_remove (note);
+              break;
+            }
     }
-  }
   return collapsed;
 }
 
@@ -222,19 +306,20 @@ int32
 ClipImpl::change_batch (const ClipNoteS &batch, const String &undogroup)
 {
   bool changes = false, selections = false;
-  // save undo image
-  const ClipNoteS orig_notes = notes_.copy();
+  // record undo delta
+  UndoDeltaP deltap = std::make_shared<UndoDelta>();
+  undo_delta_ = deltap.get();
   // delete existing notes
   for (const auto &note : batch)
     if (note.id > 0 && (note.duration == 0 || note.channel < 0)) {
-      changes |= notes_.remove (note);
+      changes |= note_remove (note);
       CDEBUG ("%s: delete notes: %d\n", __func__, note.id);
     }
   // modify *existing* notes
   for (const auto &note : batch)
     if (note.id > 0 && note.duration > 0 && note.channel >= 0) {
       ClipNote replaced;
-      if (notes_.replace (note, &replaced) && !(note == replaced)) {
+      if (notes_.lookup (note) && note_insert (note, &replaced) && !(note == replaced)) {
         replaced.selected = !replaced.selected;
         if (note == replaced)
           selections = true; // only selection changed
@@ -250,21 +335,22 @@ ClipImpl::change_batch (const ClipNoteS &batch, const String &undogroup)
       ClipNote ev = note;
       ev.id = next_noteid++;    // automatic id allocation for new notes
       assert_warn (ev.id >= MIDI_NOTE_ID_FIRST && ev.id <= MIDI_NOTE_ID_LAST);
-      const bool replaced = notes_.insert (ev);
+      const bool replaced = note_insert (ev);
       changes |= !replaced;
       CDEBUG ("%s: insert: %s%s\n", __func__, stringify_clip_note (ev), replaced ? " (REPLACED?)" : "");
     }
   // collapse overlapping notes
   if (changes || selections) {
-    const size_t collapsed = collapse_notes (notes_, true);
+    const size_t collapsed = collapse_notes (batch, true);
     changes = changes || collapsed;
     if (collapsed) CDEBUG ("%s: collapsed=%d\n", __func__, collapsed);
   }
+  undo_delta_ = nullptr;
   // queue undo
-  if (!notes_.equals (orig_notes)) {
+  if (changes || selections) {
     if (changes)
-      push_undo (orig_notes, undogroup.empty() ? "Change Notes" : undogroup);
-    if (changes) CDEBUG ("%s: notes=%d undo_size: %fMB\n", __func__, notes_.size(), project()->undo_size_guess() / (1024. * 1024));
+      push_undo (deltap, undogroup.empty() ? "Change Notes" : undogroup);
+    if (changes) CDEBUG ("%s: notes=%d undo_size: %fMB\n", __func__, notes_.size(), project()->undo_memory() / (1024. * 1024));
     emit_notify ("notes");
     emit_notify ("all_notes");
   }
@@ -330,61 +416,6 @@ ClipImpl::Generator::jumpto (int64 target_tick)
     }
 }
 
-/// Advance tick and call `receiver` for generated events.
-int64
-ClipImpl::Generator::generate (int64 target_tick, const Receiver &receiver)
-{
-  if (0)
-    printerr ("generate: %d < %d (%+d) && %d > %d (%+d) (loop: %d %d) i=%d\n", xtick_, last_, xtick_ < last_,
-              target_tick, xtick_, target_tick > xtick_,
-              loop_start_, loop_end_, itick_);
-  const int64 old_xtick = xtick_;
-  return_unless (xtick_ < last_ && target_tick > xtick_, xtick_ - old_xtick);
-  int64 ticks = std::min (target_tick, last_) - xtick_;
-  // consume delay
-  if (xtick_ < 0)
-    {
-      const int64 delta = std::min (ticks, -xtick_);
-      ticks -= delta;
-      xtick_ += delta;
-      itick_ += delta;
-      if (itick_ == 0)
-        itick_ = start_offset_;
-    }
-  // here: ticks == 0 || xtick_ >= 0
-  while (ticks > 0)
-    {
-      // advance
-      const int64 delta = itick_ < loop_end_ ? std::min (ticks, loop_end_ - itick_) : ticks;
-      ticks -= delta;
-      const int64 x = xtick_;
-      xtick_ += delta;
-      const int64 a = itick_;
-      itick_ += delta;
-      const int64 b = itick_;
-      if (itick_ == loop_end_)
-        itick_ = loop_start_;
-      // generate notes within [a,b)
-      if (receiver && !muted_)
-        {
-          ClipNote index = { .tick = a };
-          const ClipNote *event = events_->lookup_after (index);
-          while (event && event->tick < b)
-            {
-              MidiEvent midievent = make_note_on (event->channel, event->key, event->velocity, event->fine_tune, event->id);
-              const int64 noteon_tick = x + event->tick - a;
-              receiver (noteon_tick, midievent);
-              midievent.type = MidiEvent::NOTE_OFF;
-              receiver (noteon_tick + event->duration, midievent);
-              event++;
-              if (event == &*events_->end())
-                break;
-            }
-        }
-    }
-  return xtick_ - old_xtick;
-}
-
 String
 stringify_clip_note (const ClipNote &n)
 {
@@ -395,3 +426,68 @@ stringify_clip_note (const ClipNote &n)
 }
 
 } // Ase
+
+#include "testing.hh"
+
+namespace { // Anon
+using namespace Ase;
+
+TEST_INTEGRITY (clip_undo_tests);
+static void
+clip_undo_tests()
+{
+  ProjectImplP project = ProjectImpl::create ("UndoTest");
+  TrackP track = project->create_track();
+  ClipP clip = track->launcher_clips()[0];
+  TASSERT (clip && clip->all_notes().empty());
+  // insert notes, enough to exceed the compression threshold
+  ClipNoteS batch;
+  for (int i = 0; i < 300; i++)
+    batch.push_back ({ .id = -1, .key = int8 (36 + i % 48), .tick = i * 480, .duration = 240, .velocity = 0.5 });
+  clip->change_batch (batch);
+  const ClipNoteS inserted = clip->all_notes();
+  TASSERT (inserted.size() == batch.size() && project->can_undo());
+  // modify a single note
+  ClipNoteS changed = { inserted[7] };
+  changed[0].key += 1;
+  clip->change_batch (changed);
+  const ClipNoteS modified = clip->all_notes();
+  TASSERT (modified != inserted);
+  // modify all notes and delete one
+  ClipNoteS all = modified;
+  for (auto &note : all)
+    note.velocity = 0.75;
+  all[3].duration = 0;
+  clip->change_batch (all);
+  const ClipNoteS edited = clip->all_notes();
+  TASSERT (edited.size() == inserted.size() - 1);
+  const int64 memory = project->undo_memory();
+  TASSERT (memory > 0);
+  // delta undo restores each prior state
+  project->undo();
+  TASSERT (clip->all_notes() == modified);
+  project->undo();
+  TASSERT (clip->all_notes() == inserted);
+  project->undo();
+  TASSERT (clip->all_notes().empty() && !project->can_undo() && project->can_redo());
+  // redo replays all deltas
+  project->redo();
+  TASSERT (clip->all_notes() == inserted);
+  project->redo();
+  TASSERT (clip->all_notes() == modified);
+  project->redo();
+  TASSERT (clip->all_notes() == edited && !project->can_redo());
+  TCMP (project->undo_memory(), ==, memory);
+  // exceeding the budget evicts the oldest groups, the newest is kept
+  project->undo_budget (1);
+  TCMP (project->undo_budget(), ==, 1);
+  TCMP (project->undo_memory(), <, memory);
+  TASSERT (project->can_undo());
+  project->undo();
+  TASSERT (clip->all_notes() == modified && !project->can_undo());
+  project->redo();
+  TASSERT (clip->all_notes() == edited);
+  project->discard();
+}
+
+} // Anon
@@ -5,6 +5,7 @@
 #include <ase/project.hh>
 #include <ase/eventlist.hh>
 #include <ase/midievent.hh>
+#include <unordered_set>
 
 namespace Ase {
 
@@ -17,21 +18,34 @@ class ClipImpl : public GadgetImpl, public virtual Clip {
 public:
   struct CmpNoteTicks { int operator() (const ClipNote &a, const ClipNote &b) const; };
   struct CmpNoteIds   { int operator() (const ClipNote &a, const ClipNote &b) const; };
-  using EventsById = EventList<ClipNote,CmpNoteIds>;
+  using EventsById = ChunkedEventList<ClipNote,CmpNoteIds>;
+  using OrderedEventsV = ChunkedEventList<ClipNote,CmpNoteTicks>;
 private:
   int64 starttick_ = 0, stoptick_ = 0, endtick_ = 0;
-  EventsById notes_;
+  EventsById notes_;                    // notes indexed by id
+  OrderedEventsV tick_notes_;           // notes indexed by tick
+  mutable OrderedEventsV::ConstP ordered_;  // cached snapshot of tick_notes_
   Connection notifytrack_;
-  using OrderedEventsV = OrderedEventList<ClipNote,CmpNoteTicks>;
-  struct EventImage {
-    String cbuffer;
+  struct UndoDelta {
+    ClipNoteS         notes;    // prior state of modified or removed notes
+    std::vector<int32> ids;     // ids of inserted notes
+    String            cbuffer;  // zstd compressed `notes`
+    size_t            n_notes = 0;
+    std::unordered_set<int32> seen;
     static_assert (std::is_trivially_copyable<ClipNoteS::value_type>::value);
-    EventImage (const ClipNoteS &clipnotes);
-    ~EventImage();
+    void   record   (int32 id, const ClipNote *prior);
+    void   seal     ();
+    size_t memory   () const;
+    ClipNoteS prior_notes () const;
   };
-  using EventImageP = std::shared_ptr<EventImage>;
-  void          apply_undo     (const EventImage &image, const String &undogroup);
-  static size_t collapse_notes (EventsById &notes, bool preserve_selected);
+  using UndoDeltaP = std::shared_ptr<UndoDelta>;
+  UndoDelta    *undo_delta_ = nullptr;  // records note changes while set
+  void          apply_undo     (const UndoDelta &delta, const String &undogroup);
+  void          push_undo      (UndoDeltaP deltap, const String &undogroup);
+  size_t        collapse_notes (const ClipNoteS &batch, bool preserve_selected);
+  bool          note_insert    (const ClipNote &note, ClipNote *replaced = nullptr);
+  bool          note_remove    (const ClipNote &note);
+  void          notes_clear    ();
 public:
   class Generator;
 protected:
@@ -45,7 +59,6 @@ public:
   using OrderedEventsP = OrderedEventsV::ConstP;
   OrderedEventsP tick_events    () const;
   ProjectImpl*   project        () const;
-  void           push_undo      (const ClipNoteS &clipnotes, const String &undogroup);
   UndoScope      undo_scope     (const String &scopename) { return project()->undo_scope (scopename); }
   int64          start_tick     () const override { return starttick_; }
   int64          stop_tick      () const override { return stoptick_; }
@@ -71,12 +84,11 @@ class ClipImpl::Generator {
   bool   muted_ = false;
   friend class ClipImpl;
 public:
-  /// Handler for generated MIDI events.
-  using Receiver = std::function<void (int64 tick, MidiEvent &event)>;
   explicit Generator  () = default;
   void  setup         (const ClipImpl &clip);
   void  jumpto        (int64 target_tick);
-  int64 generate      (int64 target_tick, const Receiver &receiver);
+  template<class Receiver>
+  int64 generate      (int64 target_tick, Receiver &&receiver);
   /// Mute MIDI note generation.
   bool  muted         () const { return muted_; }
   /// Assign muted state.
@@ -128,6 +140,58 @@ ClipImpl::CmpNoteTicks::operator() (const ClipNote &a, const ClipNote &b) const
 
 String stringify_clip_note (const ClipNote &n);
 
+/// Advance tick and call `receiver (int64 tick, MidiEvent &event)` for generated events.
+template<class Receiver> inline int64
+ClipImpl::Generator::generate (int64 target_tick, Receiver &&receiver)
+{
+  if (0)
+    printerr ("generate: %d < %d (%+d) && %d > %d (%+d) (loop: %d %d) i=%d\n", xtick_, last_, xtick_ < last_,
+              target_tick, xtick_, target_tick > xtick_,
+              loop_start_, loop_end_, itick_);
+  const int64 old_xtick = xtick_;
+  ASE_RETURN_UNLESS (xtick_ < last_ && target_tick > xtick_, xtick_ - old_xtick);
+  int64 ticks = std::min (target_tick, last_) - xtick_;
+  // consume delay
+  if (xtick_ < 0)
+    {
+      const int64 delta = std::min (ticks, -xtick_);
+      ticks -= delta;
+      xtick_ += delta;
+      itick_ += delta;
+      if (itick_ == 0)
+        itick_ = start_offset_;
+    }
+  // here: ticks == 0 || xtick_ >= 0
+  while (ticks > 0)
+    {
+      // advance
+      const int64 delta = itick_ < loop_end_ ? std::min (ticks, loop_end_ - itick_) : ticks;
+      ticks -= delta;
+      const int64 x = xtick_;
+      xtick_ += delta;
+      const int64 a = itick_;
+      itick_ += delta;
+      const int64 b = itick_;
+      if (itick_ == loop_end_)
+        itick_ = loop_start_;
+      // generate notes within [a,b)
+      if (!muted_)
+        {
+          ClipNote index = { .tick = a };
+          const auto end = events_->end();
+          for (auto event = events_->lower_bound (index); event != end && event->tick < b; ++event)
+            {
+              MidiEvent midievent = make_note_on (event->channel, event->key, event->velocity, event->fine_tune, event->id);
+              const int64 noteon_tick = x + event->tick - a;
+              receiver (noteon_tick, midievent);
+              midievent.type = MidiEventType::NOTE_OFF;
+              receiver (noteon_tick + event->duration, midievent);
+            }
+        }
+    }
+  return xtick_ - old_xtick;
+}
+
 } // Ase
 
 #endif // __ASE_CLIP_HH__
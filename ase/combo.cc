@@ -2,6 +2,7 @@
 #include "combo.hh"
 #include "randomhash.hh"
 #include "server.hh"
+#include "main.hh"
 #include "internal.hh"
 
 #define PDEBUG(...)     Ase::debug ("combo", __VA_ARGS__)
@@ -176,6 +177,8 @@ uint
 AudioChain::schedule_children()
 {
   last_output_ = nullptr;
+  if (frozen_)
+    return 0; // children are replaced by the frozen cache
   uint level = schedule_processor (*inlet_);
   for (auto procp : processors_)
     {
@@ -190,6 +193,17 @@ AudioChain::schedule_children()
 
 void
 AudioChain::render (uint n_frames)
+{
+  if (frozen_)
+    render_frozen (n_frames);
+  else
+    render_children (n_frames);
+  if (ASE_UNLIKELY (freeze_recorder_))
+    record_frozen (n_frames);
+}
+
+void
+AudioChain::render_children (uint n_frames)
 {
   // make the last processor output the chain output
   const size_t nlastchannels = last_output_ ? last_output_->n_ochannels (OUT1) : 0;
@@ -208,7 +222,9 @@ AudioChain::render (uint n_frames)
         {
           const float *cblock = last_output_->ofloats (OUT1, std::min (c, nlastchannels - 1));
           redirect_oblock (OUT1, c, cblock);
-          if (probes)
+          if (probes && cblock == const_float_zeros)
+            (*probes)[c].dbspl = -192;
+          else if (probes)
             {
               // SPL = 20 * log10 (root_mean_square (p) / p0) dB        ; https://en.wikipedia.org/wiki/Sound_pressure#Sound_pressure_level
               // const float sqrsig = square_sum (n_frames, cblock) / n_frames; // * 1.0 / p0^2
@@ -222,6 +238,126 @@ AudioChain::render (uint n_frames)
   // FIXME: assign obus if no children are present
 }
 
+static void
+freeze_recorder_done (AudioChain::FreezeRecorder *recorder)
+{
+  if (recorder->done)
+    recorder->done (*recorder);
+  delete recorder;
+}
+
+/// Start capturing the chain output from tick 0 on, for `recorder->n_frames`.
+/// Ownership of `recorder` is passed back to the main thread once capturing is done,
+/// a previous `recorder` is canceled.
+void
+AudioChain::freeze_record (FreezeRecorder *recorder)
+{
+  assert_return (AudioEngine::thread_is_engine());
+  if (recorder)
+    assert_return (recorder->n_channels >= 1 && recorder->n_channels <= 2);
+  if (freeze_recorder_)
+    {
+      freeze_recorder_->failed = true;
+      main_rt_jobs += RtCall (freeze_recorder_done, freeze_recorder_);
+    }
+  freeze_recorder_ = recorder;
+}
+
+/// Replace rendering of the chain children by playback of `cache` or unfreeze if `cache==nullptr`.
+/// The previous cache is swapped into `cache`, so it can be released outside of the engine thread.
+void
+AudioChain::freeze_playback (FrozenCacheP &cache)
+{
+  assert_return (AudioEngine::thread_is_engine());
+  if (cache)
+    assert_return (cache->n_channels >= n_ochannels (OUT1));
+  std::swap (frozen_, cache);
+  if (!frozen_ != !cache)
+    reschedule();
+}
+
+void
+AudioChain::record_frozen (uint n_frames)
+{
+  FreezeRecorder &recorder = *freeze_recorder_;
+  const AudioTransport &transport = this->transport();
+  return_unless (transport.running() && transport.current_tick >= 0);
+  const int64 start = transport.sample_from_tick (transport.current_tick);
+  const uint n_och = n_ochannels (OUT1), n_channels = recorder.n_channels;
+  float ibuffer[AUDIO_BLOCK_MAX_RENDER_SIZE * 2];
+  // pad initial gap, e.g. if playback started behind tick 0
+  for (int64 gap = recorder.n_written ? 0 : std::min (start, recorder.n_frames); gap > 0 && !recorder.failed; )
+    {
+      const uint n = std::min (int64 (AUDIO_BLOCK_FLOAT_ZEROS_SIZE / n_channels), gap);
+      recorder.failed |= recorder.writer->write (const_float_zeros, n) < 0;
+      recorder.n_written += n;
+      gap -= n;
+    }
+  const uint n = std::min (int64 (n_frames), recorder.n_frames - recorder.n_written);
+  if (n && !recorder.failed)
+    {
+      // interleave the writer channels, mono output is duplicated, missing channels are silent
+      for (uint c = 0; c < n_channels; c++)
+        {
+          const float *src = n_och ? ofloats (OUT1, std::min (c, n_och - 1)) : const_float_zeros;
+          for (uint i = 0; i < n; i++)
+            ibuffer[i * n_channels + c] = src[i];
+        }
+      recorder.failed |= recorder.writer->write (ibuffer, n) < 0;
+      recorder.n_written += n;
+    }
+  if (recorder.n_written >= recorder.n_frames || recorder.failed)
+    {
+      main_rt_jobs += RtCall (freeze_recorder_done, freeze_recorder_);
+      freeze_recorder_ = nullptr;
+    }
+}
+
+void
+AudioChain::render_frozen (uint n_frames)
+{
+  const FrozenCache &cache = *frozen_;
+  const AudioTransport &transport = this->transport();
+  const uint n_och = n_ochannels (OUT1);
+  if (!transport.running() || transport.current_tick < 0)
+    {
+      for (uint c = 0; c < n_och; c++)
+        redirect_oblock (OUT1, c, nullptr);
+      return;
+    }
+  // map transport position into the cache, the second loop period includes tails of the first
+  int64 tick = transport.current_tick;
+  const int64 wrap_tick = cache.intro_ticks + cache.period_ticks;
+  if (cache.period_ticks > 0 && tick >= wrap_tick)
+    tick = cache.intro_ticks + (tick - cache.intro_ticks) % cache.period_ticks;
+  const int64 wrap = cache.period_ticks > 0 ? transport.sample_from_tick (wrap_tick) : I63MAX;
+  const int64 restart = transport.sample_from_tick (cache.intro_ticks);
+  int64 start = transport.sample_from_tick (tick);
+  if (std::abs (start - frozen_pos_) <= 1)
+    start = frozen_pos_; // avoid tick rounding jitter between blocks
+  frozen_pos_ = start;
+  for (uint c = 0; c < n_och; c++)
+    {
+      float *output = oblock (OUT1, c);
+      int64 pos = start;
+      for (uint i = 0; i < n_frames; i++)
+        {
+          if (ASE_UNLIKELY (pos >= wrap))
+            pos = restart;
+          output[i] = pos < cache.n_frames ? cache.frames[pos * cache.n_channels + c] : 0;
+          pos++;
+        }
+      frozen_pos_ = pos;
+    }
+  std::array<Probe,2> *probes = n_och <= 2 ? probes_ : nullptr;
+  for (uint c = 0; probes && c < n_och; c++)
+    {
+      const float sqrsig = square_max (n_frames, ofloats (OUT1, c));
+      const float log2div = 3.01029995663981; // 20 / log2 (10) / 2.0
+      (*probes)[c].dbspl = ISLIKELY (sqrsig > 0.0) ? log2div * fast_log2 (sqrsig) : -192;
+    }
+}
+
 /// Reconnect AudioChain child processors at start and after.
 void
 AudioChain::reconnect (size_t index, bool insertion)
@@ -3,6 +3,8 @@
 #define __ASE_COMBO_HH__
 
 #include <ase/processor.hh>
+#include <ase/wave.hh>
+#include <ase/blob.hh>
 
 namespace Ase {
 
@@ -43,10 +45,41 @@ public:
   using ProbeArray = std::array<Probe,2>;
   ProbeArray* run_probes     (bool enable);
   static void static_info    (AudioProcessorInfo &info);
+  struct FreezeRecorder;
+  struct FrozenCache;
+  using FrozenCacheP = std::shared_ptr<FrozenCache>;
+  void        freeze_record   (FreezeRecorder *recorder);
+  void        freeze_playback (FrozenCacheP &cache);
 private:
   ProbeArray *probes_ = nullptr;
   bool        probes_enabled_ = false;
   FastMemory::Block probe_block_;
+  FreezeRecorder *freeze_recorder_ = nullptr;
+  FrozenCacheP    frozen_;
+  int64           frozen_pos_ = 0;
+  void        render_children (uint n_frames);
+  void        record_frozen   (uint n_frames);
+  void        render_frozen   (uint n_frames);
+};
+
+/// Capture of the AudioChain output during playback, used to freeze a Track.
+struct AudioChain::FreezeRecorder {
+  AsyncWaveWriterP writer;
+  uint             n_channels = 2;      ///< Number of interleaved channels per frame of `writer`.
+  int64            n_frames = 0;        ///< Number of frames to capture, starting at tick 0.
+  int64            n_written = 0;       ///< Number of frames captured so far.
+  bool             failed = false;      ///< Capture was canceled or lost frames.
+  std::function<void (FreezeRecorder&)> done; ///< Main thread notification after capturing.
+};
+
+/// Frozen AudioChain output, replaces rendering of the chain children.
+struct AudioChain::FrozenCache {
+  Blob         blob;                    ///< Interleaved float32 samples.
+  const float *frames = nullptr;
+  int64        n_frames = 0;
+  uint         n_channels = 0;
+  int64        intro_ticks = 0;         ///< Ticks until the loop period starts repeating.
+  int64        period_ticks = 0;        ///< Length of the loop period in ticks, 0 if playback does not loop.
 };
 
 } // Ase
@@ -0,0 +1,139 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#include "denormals.hh"
+#include "processor.hh"
+#include "strings.hh"
+#include "platform.hh"
+#include "internal.hh"
+#include "testing.hh"
+#include <typeinfo>
+
+namespace Ase {
+namespace Denormals {
+
+std::atomic<bool> check_enabled_ = false;
+
+static constexpr uint MAX_RECORDS = 64;
+static constexpr uint MAX_PROCESSORS = 256;
+
+struct Record {
+  std::atomic<bool> ready = false;
+  size_t            n_denormals = 0;
+  size_t            n_values = 0;
+  const std::type_info *processor = nullptr; // typeid() of the processor, named in report()
+};
+
+// All state is static, recording happens in render threads
+static std::array<Record,MAX_RECORDS> records;
+static std::atomic<uint> n_records = 0;                         // slots claimed by render threads
+static std::atomic<uint> n_reported = 0;                        // slots reported by report()
+static std::atomic<uint64> denormal_count = 0;
+static std::array<std::atomic<uintptr_t>,MAX_PROCESSORS> processors; // processors already recorded
+
+// Insert `proc` into the set of recorded processors, returns false for duplicates
+static bool
+processor_add (const AudioProcessor *proc)
+{
+  const uintptr_t key = uintptr_t (proc);
+  const uintptr_t hash = key >> 4;
+  for (uint i = 0; i < MAX_PROCESSORS; i++)
+    {
+      std::atomic<uintptr_t> &slot = processors[(hash + i) % MAX_PROCESSORS];
+      uintptr_t prev = 0;
+      if (slot.compare_exchange_strong (prev, key) || prev == key)
+        return prev == 0;
+    }
+  return false; // table full, stop recording
+}
+
+static void ASE_NOINLINE
+record (const AudioProcessor &proc, size_t n_denormals, size_t n_values)
+{
+  if (!processor_add (&proc))
+    return;
+  const uint index = n_records++;
+  if (index < MAX_RECORDS)
+    {
+      Record &r = records[index];
+      r.n_denormals = n_denormals;
+      r.n_values = n_values;
+      r.processor = &typeid (proc); // debug_name() would allocate
+      r.ready = true;
+    }
+}
+
+/// Count denormals in the output `values` of `proc`, processors producing denormals are recorded once.
+void
+scan_outputs (const AudioProcessor &proc, const float *values, size_t n_values)
+{
+  size_t n_denormals = 0;
+  for (size_t i = 0; i < n_values; i++)
+    {
+      const uint32 bits = __builtin_bit_cast (uint32, values[i]);
+      n_denormals += (bits & 0x7f800000) == 0 && (bits & 0x007fffff) != 0;
+    }
+  if (ASE_UNLIKELY (n_denormals))
+    {
+      denormal_count += n_denormals;
+      record (proc, n_denormals, n_values);
+    }
+}
+
+void
+enable_check (bool onoff)
+{
+  assert_return (this_thread_is_ase());
+  check_enabled_ = onoff; // render threads adjust their flushing mode before the next render()
+}
+
+uint64
+n_denormals ()
+{
+  return denormal_count;
+}
+
+bool
+pending ()
+{
+  return std::min (n_records.load(), MAX_RECORDS) > n_reported;
+}
+
+String
+report ()
+{
+  String s;
+  assert_return (this_thread_is_ase(), s);
+  const uint n = std::min (n_records.load(), MAX_RECORDS);
+  for (; n_reported < n && records[n_reported].ready; n_reported++)
+    {
+      const Record &r = records[n_reported];
+      s += string_format ("## Denormal Output\n`%s` produced %u denormal samples in %u output values\n",
+                          string_demangle_cxx (r.processor->name()), r.n_denormals, r.n_values);
+    }
+  if (n_records.load() > MAX_RECORDS)
+    s += string_format ("(%u more processors with denormal output omitted)\n", n_records.load() - MAX_RECORDS);
+  return s;
+}
+
+} // Denormals
+} // Ase
+
+namespace { // Anon
+using namespace Ase;
+
+TEST_INTEGRITY (denormals_flush_test);
+static void
+denormals_flush_test()
+{
+#if defined __SSE__
+  const uint csr = _mm_getcsr();
+  _mm_setcsr (csr & ~ASE_MXCSR_FTZ_DAZ);
+  volatile float tiny = FLT_MIN;
+  TASSERT (tiny * 0.5f != 0);                   // denormal result
+  TASSERT (Denormals::flush_to_zero() == true);
+  TASSERT (Denormals::flush_to_zero() == false);
+  TASSERT (tiny * 0.5f == 0);                   // flushed to zero
+  _mm_setcsr (csr);
+#endif
+}
+
+} // Anon
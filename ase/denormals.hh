@@ -0,0 +1,61 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#ifndef __ASE_DENORMALS_HH__
+#define __ASE_DENORMALS_HH__
+
+#include <ase/defs.hh>
+#include <atomic>
+#if defined __SSE__
+#include <xmmintrin.h>
+#endif
+
+#define ASE_MXCSR_FTZ_DAZ       0x8040  // flush-to-zero (bit 15) and denormals-are-zero (bit 6)
+
+namespace Ase {
+
+/** Denormal (subnormal) float handling for the render path.
+ * Arithmetic on denormals is very slow on most CPUs, e.g. in decaying reverb tails. The engine
+ * and render worker threads flush denormals to zero (FTZ and DAZ on x86, FZ on ARM), the setting
+ * is reapplied per render cycle by those threads, other threads are left untouched.
+ * Once the check is enabled, flushing is turned off and output buffers are scanned for denormals,
+ * so processors that produce them are reported once with their type name.
+ */
+namespace Denormals {
+
+void   enable_check (bool onoff);       ///< Start/stop checking, needs to be called from the main thread.
+bool   pending      ();                 ///< Check for unreported processors.
+String report       ();                 ///< Format unreported processors, needs to be called from the main thread.
+uint64 n_denormals  ();                 ///< Total number of denormal samples seen so far.
+void   scan_outputs (const AudioProcessor &proc, const float *values, size_t n_values);
+
+extern std::atomic<bool> check_enabled_;
+
+/// Flush denormals to zero on the calling thread (unless checking), returns true if the state was changed.
+inline bool
+flush_to_zero ()
+{
+  const bool flush = !check_enabled_.load (std::memory_order_relaxed);
+#if defined __SSE__
+  const uint csr = _mm_getcsr();
+  const uint want = flush ? csr | ASE_MXCSR_FTZ_DAZ : csr & ~ASE_MXCSR_FTZ_DAZ;
+  if (ASE_ISLIKELY (csr == want))
+    return false;
+  _mm_setcsr (want);
+  return true;
+#elif defined __aarch64__
+  constexpr uint64 FZ = 1 << 24;
+  uint64 fpcr;
+  __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+  const uint64 want = flush ? fpcr | FZ : fpcr & ~FZ;
+  if (ASE_ISLIKELY (fpcr == want))
+    return false;
+  __asm__ __volatile__ ("msr fpcr, %0" : : "r" (want));
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // Denormals
+} // Ase
+
+#endif // __ASE_DENORMALS_HH__
@@ -5,6 +5,7 @@
 #include "project.hh"
 #include "jsonipc/jsonipc.hh"
 #include "serialize.hh"
+#include "server.hh"
 #include "internal.hh"
 
 namespace Ase {
@@ -83,6 +84,33 @@ Device::remove_self ()
     device->remove_device (*this);
 }
 
+/// Enable DSP load measurements for this device and return the current measurements.
+DspLoad
+Device::dsp_load ()
+{
+  AudioProcessorP proc = _audio_processor();
+  assert_return (proc, {});
+  proc->dsp_load_stats();
+  return proc->dsp_load();
+}
+
+/// Enable DSP load measurements for this device and return the telemetry locations.
+TelemetryFieldS
+Device::dsp_telemetry ()
+{
+  AudioProcessorP proc = _audio_processor();
+  TelemetryFieldS v;
+  assert_return (proc, v);
+  AudioProcessor::DspLoadStats *stats = proc->dsp_load_stats();
+  assert_return (stats, v);
+  v.push_back (telemetry_field ("last", &stats->load.last));
+  v.push_back (telemetry_field ("mean", &stats->load.mean));
+  v.push_back (telemetry_field ("p99", &stats->load.p99));
+  v.push_back (telemetry_field ("max", &stats->load.max));
+  v.push_back (telemetry_field ("blocks", &stats->load.blocks));
+  return v;
+}
+
 Track*
 Device::_track () const
 {
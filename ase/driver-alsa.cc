@@ -5,6 +5,7 @@
 #include "internal.hh"
 #include <limits.h> // LONG_MAX
 #include <atomic>
+#include <thread>
 #include <cmath>
 
 #define PDEBUG(...)             Ase::debug ("alsa", "PCM: " __VA_ARGS__)
@@ -737,6 +738,17 @@ class AlsaSeqMidiDriver : public MidiDriver {
   snd_midi_event_t *evparser_ = nullptr;
   PortSubscribe     subs_;
   bool              mdebug_ = false;
+  // constant latency input
+  struct StampedEvent { uint64 ns = 0; MidiEvent event; };
+  static constexpr uint64 RING_SIZE = 1024;     // power of 2
+  std::unique_ptr<StampedEvent[]> ring_;
+  alignas (64) std::atomic<uint64> rhead_ = 0;  // events fetched by engine
+  alignas (64) std::atomic<uint64> rtail_ = 0;  // events stamped by input thread
+  std::atomic<uint64> n_overflows_ = 0;
+  std::atomic<bool> iquit_ = false;
+  std::thread       ithread_;
+  MidiBlockClock    bclock_;                    // engine thread only
+  MidiTimingStats   tstats_;                    // engine thread only
   PortSubscribe
   make_port_subscribe (snd_seq_port_subscribe_t *other = nullptr)
   {
@@ -1064,6 +1076,7 @@ public:
   void
   cleanup()
   {
+    stop_input_thread();
     if (total_fds_ > 0)
       {
         total_fds_ = 0;
@@ -1135,92 +1148,197 @@ public:
     const bool pull_fifo = true;
     return snd_seq_event_input_pending (seq_, pull_fifo) > 0;
   }
-  uint
-  fetch_events (MidiEventOutput &estream, double samplerate) override
+  static bool
+  convert_event (const snd_seq_event_t *ev, MidiEvent &event)
   {
-    assert_return (!!evparser_, 0);
-    const size_t old_size = estream.size();
-    // receive
-    snd_seq_event_t *ev = nullptr;
-    const double now = queue_now();
     const auto mkid = [] (uint note, uint channel) {
       return (channel + 1) * 128 + note;
     };
-    bool must_sort = false;
-    const auto add = [&] (MidiEventOutput &estream, const snd_seq_event_t *ev, const MidiEvent &event) {
-      const double t = ev->time.time.tv_sec + 1e-9 * ev->time.time.tv_nsec;
-      const double diff = t - now;
-      int64_t frames = diff * samplerate;
-      if (event.type == event.NOTE_OFF)
-        {                                               // guard against devices with out-of-order events
-          const auto last_frame = estream.last_frame();
-          frames = std::max (frames, last_frame);
-        }
-      int16_t frame_delay = CLAMP (frames, -2048, 0);   // ignore future scheduling, only account for delays
-      must_sort |= estream.append_unsorted (frame_delay, event);
-    };
-    int r;
-    while (r = snd_seq_event_input (seq_, &ev), r >= 0)
-      switch (ev->type)
-        {
-        case SND_SEQ_EVENT_NOTEON:
-          add (estream, ev,
-               make_note_on (ev->data.note.channel, ev->data.note.note,
-                             ev->data.note.velocity * (1.0 / 127.0), 0,
-                             mkid (ev->data.note.note, ev->data.note.channel)));
-          break;
-        case SND_SEQ_EVENT_NOTEOFF:
-          add (estream, ev,
-               make_note_off (ev->data.note.channel, ev->data.note.note,
+    switch (ev->type)
+      {
+      case SND_SEQ_EVENT_NOTEON:
+        event = make_note_on (ev->data.note.channel, ev->data.note.note,
                               ev->data.note.velocity * (1.0 / 127.0), 0,
-                              mkid (ev->data.note.note, ev->data.note.channel)));
-          break;
-        case SND_SEQ_EVENT_KEYPRESS:
-          add (estream, ev,
-               make_aftertouch (ev->data.note.channel, ev->data.note.note,
-                                ev->data.note.velocity * (1.0 / 127.0), 0,
-                                mkid (ev->data.note.note, ev->data.note.channel)));
-          break;
-        case SND_SEQ_EVENT_CONTROLLER:
-          add (estream, ev,
-               make_control8 (ev->data.control.channel, ev->data.control.param,
-                              ev->data.control.value));
-          break;
-        case SND_SEQ_EVENT_PGMCHANGE:
-          add (estream, ev,
-               make_program (ev->data.control.channel, ev->data.control.value));
-          break;
-        case SND_SEQ_EVENT_CHANPRESS:
-          add (estream, ev,
-               make_pressure (ev->data.control.channel, ev->data.control.value * (1.0 / 127.0)));
-          break;
-        case SND_SEQ_EVENT_PITCHBEND:
-          add (estream, ev,
-               make_pitch_bend (ev->data.control.channel,
-                                ev->data.control.value *
-                                (ev->data.control.value < 0 ? 1.0 / 8192.0 : 1.0 / 8191.0)));
-          break;
-        case SND_SEQ_EVENT_SYSEX:
-          MDEBUG ("%+4d ch=%-2u SYSEX: %s",
-                  int (samplerate * (ev->time.time.tv_sec + 1e-9 * ev->time.time.tv_nsec - now)),
-                  ev->data.control.channel, hex_str (ev->data.ext.len, (const uint8*) ev->data.ext.ptr));
-          break;
-        case SND_SEQ_EVENT_CLOCK:
-          // skip debug message
-          break;
-        case SND_SEQ_EVENT_CONTROL14:
-        case SND_SEQ_EVENT_NONREGPARAM:
-        case SND_SEQ_EVENT_REGPARAM:
-        case SND_SEQ_EVENT_NOTE:  // unhandled, duration usually too long for MidiEvent.frame
-        default:
-          MDEBUG ("%+4d ch=%-2u SND_SEQ_EVENT_... %u",
-                  int (samplerate * (ev->time.time.tv_sec + 1e-9 * ev->time.time.tv_nsec - now)),
-                  ev->data.control.channel, ev->type);
-          break;
-          // DEPRECATED: snd_seq_free_event (ev);
-        }
-    if (r < 0 && r != -EAGAIN) // -ENOSPC - sequencer FIFO overran
-      MDEBUG ("SndSeq: %s: snd_seq_event_input: %s", devid_, snd_strerror (r));
+                              mkid (ev->data.note.note, ev->data.note.channel));
+        return true;
+      case SND_SEQ_EVENT_NOTEOFF:
+        event = make_note_off (ev->data.note.channel, ev->data.note.note,
+                               ev->data.note.velocity * (1.0 / 127.0), 0,
+                               mkid (ev->data.note.note, ev->data.note.channel));
+        return true;
+      case SND_SEQ_EVENT_KEYPRESS:
+        event = make_aftertouch (ev->data.note.channel, ev->data.note.note,
+                                 ev->data.note.velocity * (1.0 / 127.0), 0,
+                                 mkid (ev->data.note.note, ev->data.note.channel));
+        return true;
+      case SND_SEQ_EVENT_CONTROLLER:
+        event = make_control8 (ev->data.control.channel, ev->data.control.param,
+                               ev->data.control.value);
+        return true;
+      case SND_SEQ_EVENT_PGMCHANGE:
+        event = make_program (ev->data.control.channel, ev->data.control.value);
+        return true;
+      case SND_SEQ_EVENT_CHANPRESS:
+        event = make_pressure (ev->data.control.channel, ev->data.control.value * (1.0 / 127.0));
+        return true;
+      case SND_SEQ_EVENT_PITCHBEND:
+        event = make_pitch_bend (ev->data.control.channel,
+                                 ev->data.control.value *
+                                 (ev->data.control.value < 0 ? 1.0 / 8192.0 : 1.0 / 8191.0));
+        return true;
+      case SND_SEQ_EVENT_SYSEX:
+        MDEBUG ("ch=%-2u SYSEX: %s", ev->data.control.channel,
+                hex_str (ev->data.ext.len, (const uint8*) ev->data.ext.ptr));
+        return false;
+      case SND_SEQ_EVENT_CLOCK:
+        // skip debug message
+        return false;
+      case SND_SEQ_EVENT_CONTROL14:
+      case SND_SEQ_EVENT_NONREGPARAM:
+      case SND_SEQ_EVENT_REGPARAM:
+      case SND_SEQ_EVENT_NOTE:  // unhandled, duration usually too long for MidiEvent.frame
+      default:
+        MDEBUG ("ch=%-2u SND_SEQ_EVENT_... %u", ev->data.control.channel, ev->type);
+        return false;
+        // DEPRECATED: snd_seq_free_event (ev);
+      }
+  }
+  void
+  input_thread_loop (std::vector<struct pollfd> pfds)
+  {
+    this_thread_set_name ("AseMidiInput"); // max 16 chars
+    sched_fast_priority (this_thread_gettid());
+    while (!iquit_)
+      {
+        if (poll (pfds.data(), pfds.size(), 50) <= 0)
+          continue;
+        // map kernel arrival times onto the engine clock
+        const uint64 now_ns = timestamp_benchmark();
+        const double qnow = queue_now();
+        snd_seq_event_t *ev = nullptr;
+        int r;
+        while (r = snd_seq_event_input (seq_, &ev), r >= 0)
+          {
+            MidiEvent event;
+            if (!convert_event (ev, event))
+              continue;
+            const double t = ev->time.time.tv_sec + 1e-9 * ev->time.time.tv_nsec;
+            const uint64 age_ns = CLAMP (qnow - t, 0.0, 1.0) * 1e9;
+            const uint64 tail = rtail_.load (std::memory_order_relaxed);
+            if (ASE_UNLIKELY (tail - rhead_.load (std::memory_order_acquire) >= RING_SIZE))
+              {
+                n_overflows_ += 1;
+                continue;
+              }
+            StampedEvent &sev = ring_[tail & (RING_SIZE - 1)];
+            sev.ns = now_ns - std::min (now_ns, age_ns);
+            sev.event = event;
+            rtail_.store (tail + 1, std::memory_order_release);
+          }
+        if (r < 0 && r != -EAGAIN) // -ENOSPC - sequencer FIFO overran
+          MDEBUG ("SndSeq: %s: snd_seq_event_input: %s", devid_, snd_strerror (r));
+      }
+  }
+  void
+  stop_input_thread ()
+  {
+    return_unless (ithread_.joinable());
+    iquit_ = true;
+    ithread_.join();
+    iquit_ = false;
+  }
+  bool
+  constant_latency (bool enable) override
+  {
+    assert_return (opened(), false);
+    if (!enable)
+      {
+        stop_input_thread();
+        return true;
+      }
+    return_unless (!ithread_.joinable(), true);
+    std::vector<struct pollfd> pfds (std::max (0, snd_seq_poll_descriptors_count (seq_, POLLIN)));
+    if (pfds.empty() || snd_seq_poll_descriptors (seq_, pfds.data(), pfds.size(), POLLIN) <= 0)
+      return false;
+    if (!ring_)
+      ring_.reset (new StampedEvent[RING_SIZE]);
+    rhead_ = 0;
+    rtail_ = 0;
+    bclock_ = {};
+    ithread_ = std::thread (&AlsaSeqMidiDriver::input_thread_loop, this, pfds);
+    MDEBUG ("SndSeq: %s: constant latency input thread started", devid_);
+    return true;
+  }
+  bool
+  timing_stats (MidiTimingStats &stats) const override
+  {
+    return_unless (ithread_.joinable(), false);
+    stats = tstats_;
+    stats.n_overflows = n_overflows_;
+    return true;
+  }
+  bool
+  fetch_stamped (MidiEventOutput &estream, double samplerate, uint n_frames)
+  {
+    bclock_.start_block (timestamp_benchmark(), samplerate, n_frames, tstats_);
+    // events that arrived during the last block period are placed at their exact offset in this block
+    const uint64 window = bclock_.window_ns();
+    const uint64 tail = rtail_.load (std::memory_order_acquire);
+    uint64 head = rhead_.load (std::memory_order_relaxed);
+    bool must_sort = false;
+    for (; head < tail; head++)
+      {
+        const StampedEvent &sev = ring_[head & (RING_SIZE - 1)];
+        if (bclock_.pending (sev.ns))
+          break;                // arrived during the current block, deliver with the next
+        int64_t frame = bclock_.frame (sev.ns, samplerate, n_frames);
+        if (ASE_ISLIKELY (sev.ns >= window))
+          tstats_.n_events += 1;
+        else
+          {
+            tstats_.n_late += 1;
+            tstats_.late_by[MidiTimingStats::bucket ((window - sev.ns) / 1000)] += 1;
+          }
+        if (sev.event.type == MidiEvent::NOTE_OFF)     // guard against devices with out-of-order events
+          frame = std::max (frame, estream.last_frame());
+        must_sort |= estream.append_unsorted (frame, sev.event);
+      }
+    rhead_.store (head, std::memory_order_release);
+    return must_sort;
+  }
+  uint
+  fetch_events (MidiEventOutput &estream, double samplerate, uint n_frames) override
+  {
+    assert_return (!!evparser_, 0);
+    const size_t old_size = estream.size();
+    bool must_sort = false;
+    if (ithread_.joinable())
+      must_sort = fetch_stamped (estream, samplerate, n_frames);
+    else
+      {
+        // receive
+        snd_seq_event_t *ev = nullptr;
+        const double now = queue_now();
+        int r;
+        while (r = snd_seq_event_input (seq_, &ev), r >= 0)
+          {
+            MidiEvent event;
+            if (!convert_event (ev, event))
+              continue;
+            const double t = ev->time.time.tv_sec + 1e-9 * ev->time.time.tv_nsec;
+            const double diff = t - now;
+            int64_t frames = diff * samplerate;
+            if (event.type == MidiEvent::NOTE_OFF)
+              {                                         // guard against devices with out-of-order events
+                const auto last_frame = estream.last_frame();
+                frames = std::max (frames, last_frame);
+              }
+            int16_t frame_delay = CLAMP (frames, -2048, 0); // ignore future scheduling, only account for delays
+            must_sort |= estream.append_unsorted (frame_delay, event);
+          }
+        if (r < 0 && r != -EAGAIN) // -ENOSPC - sequencer FIFO overran
+          MDEBUG ("SndSeq: %s: snd_seq_event_input: %s", devid_, snd_strerror (r));
+      }
     if (ASE_UNLIKELY (mdebug_))
       for (size_t i = old_size; i < estream.size(); i++)
         MDEBUG ("%s", (estream.begin() + i)->to_string());
@@ -400,7 +400,7 @@ public:
     return false;
   }
   uint
-  fetch_events (MidiEventOutput&, double) override
+  fetch_events (MidiEventOutput&, double, uint) override
   {
     return 0; // FIXME: needed?
   }
@@ -420,6 +420,37 @@ public:
 
 static const String null_midi_driverid = MidiDriver::register_driver ("null", NullMidiDriver::create, NullMidiDriver::list_drivers);
 
+// == MidiBlockClock ==
+/// Advance the clock to a new block that starts at `now_ns`.
+/// Block starts are smoothed, so wakeup jitter of the engine thread does not move events,
+/// large deviations (e.g. after xruns) re-synchronize the clock.
+void
+MidiBlockClock::start_block (uint64 now_ns, double samplerate, uint n_frames, MidiTimingStats &stats)
+{
+  const uint64 period = n_frames * 1e9 / samplerate;
+  const uint64 predicted = block_ns + period_ns;
+  const int64 err = now_ns - predicted;
+  const uint64 abserr = std::abs (err);
+  if (!block_ns || abserr > 2 * std::max (period, period_ns))
+    block_ns = now_ns;
+  else
+    {
+      block_ns = predicted + err / 16;
+      stats.block_jitter[MidiTimingStats::bucket (abserr / 1000)] += 1;
+    }
+  period_ns = period;
+}
+
+/// Map timestamp `ns` of an event from the previous block period to its frame offset in the current block.
+/// Events stamped before window_ns() missed their frame and are placed at frame 0.
+int64
+MidiBlockClock::frame (uint64 ns, double samplerate, uint n_frames) const
+{
+  const uint64 window = window_ns();
+  return_unless (ns >= window, 0);
+  return std::min (int64 ((ns - window) * samplerate / 1e9), int64 (n_frames) - 1);
+}
+
 } // Ase
 
 // == jackdriver.so ==
@@ -440,3 +471,56 @@ try_load_libasejack ()
 }
 
 static bool *asejack_loaded = Ase::register_driver_loader ("asejack", try_load_libasejack);
+
+// == Tests ==
+#include "testing.hh"
+
+namespace { // Anon
+using namespace Ase;
+
+TEST_INTEGRITY (midi_block_clock_test);
+static void
+midi_block_clock_test()
+{
+  const double samplerate = 48000;
+  const uint n_frames = 480;                    // 10ms blocks
+  const uint64 period = 10 * 1000000;
+  MidiTimingStats stats;
+  MidiBlockClock clock;
+  // first block synchronizes
+  uint64 t = 1000000000;
+  clock.start_block (t, samplerate, n_frames, stats);
+  TCMP (clock.block_ns, ==, t);
+  TCMP (clock.window_ns(), ==, t - period);
+  TCMP (clock.frame (t - period, samplerate, n_frames), ==, 0);
+  TCMP (clock.frame (t - period / 2, samplerate, n_frames), ==, 240);
+  TCMP (clock.frame (t - 1, samplerate, n_frames), ==, 479);
+  TCMP (clock.frame (t - period - 1, samplerate, n_frames), ==, 0);  // late
+  TASSERT (!clock.pending (t - 1) && clock.pending (t));
+  // wakeup jitter is smoothed
+  t += period + 1600000;
+  clock.start_block (t, samplerate, n_frames, stats);
+  TCMP (clock.block_ns, ==, 1000000000 + period + 100000);
+  TCMP (stats.block_jitter[MidiTimingStats::bucket (1600)], ==, 1);
+  // xruns re-synchronize
+  t += 1000000000;
+  clock.start_block (t, samplerate, n_frames, stats);
+  TCMP (clock.block_ns, ==, t);
+  // with regular blocks, events are rendered exactly one block after their arrival
+  uint64 arrival = t + 1234567;
+  for (size_t i = 0; i < 200; i++)
+    {
+      t += period;
+      clock.start_block (t, samplerate, n_frames, stats);
+      for (; arrival < clock.block_ns; arrival += 3456789)
+        {
+          const int64 frame = clock.frame (arrival, samplerate, n_frames);
+          TASSERT (frame >= 0 && frame < int64 (n_frames));
+          const double played = clock.block_ns + frame * 1e9 / samplerate;
+          const double latency = played - arrival;
+          TASSERT (latency >= period - 1e9 / samplerate - 1 && latency <= period + 1);
+        }
+    }
+}
+
+} // Anon
@@ -5,6 +5,7 @@
 #include <ase/api.hh>
 #include <ase/midievent.hh>
 #include <functional>
+#include <array>
 
 namespace Ase {
 
@@ -69,6 +70,30 @@ public:
 };
 using DriverP = Driver::DriverP;
 
+/// Timing statistics for MIDI input with constant latency.
+struct MidiTimingStats {
+  static constexpr uint NBUCKETS = 16;
+  using Histogram = std::array<uint64,NBUCKETS>; ///< Bucket `i` counts values in [2^(i-1), 2^i) µs, bucket 0 counts values < 1µs.
+  uint64    n_events = 0;           ///< Events placed at their exact frame offset.
+  uint64    n_late = 0;             ///< Events that arrived too late and were placed at frame 0.
+  uint64    n_overflows = 0;        ///< Events dropped due to a full input ring.
+  Histogram block_jitter = {};      ///< Deviation of block start times from the smoothed engine clock.
+  Histogram late_by = {};           ///< Lateness of events that missed their frame.
+  static uint bucket (uint64 usecs) { return std::min (NBUCKETS - 1, uint (usecs ? 64 - __builtin_clzll (usecs) : 0)); }
+};
+
+/// Smoothed engine block clock, maps MIDI input timestamps to frames with a constant latency of one block.
+struct MidiBlockClock {
+  uint64 block_ns = 0;              ///< Smoothed start time of the current block, 0 if unsynchronized.
+  uint64 period_ns = 0;             ///< Duration of the current block.
+  void   start_block (uint64 now_ns, double samplerate, uint n_frames, MidiTimingStats &stats);
+  int64  frame       (uint64 ns, double samplerate, uint n_frames) const;
+  /// Start of the previous block period, events stamped since then are placed into the current block.
+  uint64 window_ns   () const       { return block_ns - std::min (block_ns, period_ns); }
+  /// Check if an event arrived during the current block period and is due with the next block.
+  bool   pending     (uint64 ns) const { return ns >= block_ns; }
+};
+
 class MidiDriver : public Driver {
 protected:
   explicit           MidiDriver      (const String &driver, const String &devid);
@@ -77,7 +102,11 @@ public:
   typedef std::shared_ptr<MidiDriver> MidiDriverP;
   static MidiDriverP open            (const String &devid, IODir iodir, Ase::Error *ep);
   virtual bool       has_events      () = 0;
-  virtual uint       fetch_events    (MidiEventOutput &estream, double samplerate) = 0;
+  virtual uint       fetch_events    (MidiEventOutput &estream, double samplerate, uint n_frames) = 0;
+  /// Timestamp input from a dedicated thread and deliver events with a constant latency of one block.
+  virtual bool       constant_latency (bool enable)        { return false; }
+  /// Retrieve timing statistics for constant latency input.
+  virtual bool       timing_stats    (MidiTimingStats &stats) const { return false; }
   static EntryVec    list_drivers    ();
   static String      register_driver (const String &driverid,
                                       const std::function<MidiDriverP (const String&)> &create,
@@ -11,6 +11,8 @@
 #include "wave.hh"
 #include "main.hh"      // main_loop_autostop_mt
 #include "memory.hh"
+#include "rtcheck.hh"
+#include "denormals.hh"
 #include "internal.hh"
 
 #define EDEBUG(...)             Ase::debug ("engine", __VA_ARGS__)
@@ -20,31 +22,121 @@ namespace Ase {
 constexpr const uint FIXED_N_CHANNELS = 2;
 constexpr const uint FIXED_SAMPLE_RATE = 48000;
 constexpr const uint FIXED_N_MIDI_DRIVERS = 4;
+constexpr const uint CAPTURE_RING_SECONDS = 2;
 
 // == decls ==
 using VoidFunc = std::function<void()>;
 using StartQueue = AsyncBlockingQueue<char>;
 ASE_CLASS_DECLS (EngineMidiInput);
 static void apply_driver_preferences ();
+static String midi_timing_stats_string (const EngineMidiInput &midi_proc);
 
 // == EngineJobImpl ==
-struct EngineJobImpl {
-  VoidFunc func;
-  std::atomic<EngineJobImpl*> next = nullptr;
-  explicit EngineJobImpl (const VoidFunc &jobfunc) : func (jobfunc) {}
-};
 static inline std::atomic<EngineJobImpl*>&
 atomic_next_ptrref (EngineJobImpl *j)
 {
   return j->next;
 }
 
+/// Counters for engine job queueing.
+struct JobStats {
+  std::atomic<uint64> n_queued = 0;     // jobs submitted
+  std::atomic<uint64> n_done = 0;       // jobs executed
+  std::atomic<uint64> n_heap = 0;       // jobs allocated outside the job pool
+  std::atomic<uint64> max_depth = 0;    // maximum number of jobs pending execution
+  uint64              latency_sum_ns = 0;
+  uint64              latency_max_ns = 0;
+};
+
+// == RenderWorker ==
+struct RenderWorker {
+  enum : uint { IDLE, QUEUED, BUSY };
+  std::atomic<uint> state = IDLE;
+  uint              participant = 0;
+  ScopedSemaphore   sem;
+  std::thread       thread;
+};
+
+// == RenderGraph ==
+/// Dependency graph of scheduled processors, a node becomes ready once all its inputs are rendered.
+struct RenderGraph {
+  std::vector<AudioProcessor*> nodes;         // topologically sorted
+  std::vector<uint32>          ndeps;         // number of inputs per node
+  std::vector<uint32>          succ_offsets;  // successors of node i are succs[succ_offsets[i]..succ_offsets[i+1]]
+  std::vector<uint32>          succs;
+  std::vector<uint32>          rank;          // node -> ready bit, ordered by critical path
+  std::vector<uint32>          order;         // ready bit -> node
+  std::vector<uint64>          ready0;        // ready bits at block start
+  std::unique_ptr<std::atomic<uint32>[]> pending; // per node, inputs yet to be rendered
+  std::unique_ptr<AtomicU64[]> ready;         // bit set for every node that may be rendered
+  size_t                       npending = 0, nready = 0;
+  alignas (64) std::atomic<uint32> done = 0;
+  void
+  reset ()
+  {
+    for (size_t i = 0; i < nodes.size(); i++)
+      pending[i].store (ndeps[i], std::memory_order_relaxed);
+    for (size_t u = 0; u < ready0.size(); u++)
+      ready[u].store (ready0[u], std::memory_order_relaxed);
+    done.store (0, std::memory_order_release);
+  }
+  /// Claim the ready node with the longest critical path, returns -1 if none is ready.
+  ssize_t
+  claim ()
+  {
+    for (size_t u = 0; u < ready0.size(); u++)
+      {
+        uint64 bits = ready[u].load (std::memory_order_relaxed);
+        while (bits)
+          {
+            const uint64 bit = bits & -bits;
+            const uint64 prev = ready[u].fetch_and (~bit, std::memory_order_acquire);
+            if (prev & bit)
+              return order[u * 64 + __builtin_ctzll (bit)];
+            bits = prev & ~bit;
+          }
+      }
+    return -1;
+  }
+  /// Mark `node` as rendered and release successors that have no pending inputs left.
+  void
+  release (size_t node)
+  {
+    for (size_t j = succ_offsets[node]; j < succ_offsets[node + 1]; j++)
+      {
+        const uint32 s = succs[j];
+        if (pending[s].fetch_sub (1, std::memory_order_acq_rel) == 1)
+          ready[rank[s] >> 6].fetch_or (uint64 (1) << (rank[s] & 63), std::memory_order_release);
+      }
+    done.fetch_add (1, std::memory_order_release);
+  }
+};
+
+struct RenderStats {
+  std::atomic<uint64> blocks = 0, render_ns = 0, sched_ns = 0, wait_ns = 0;
+};
+
+static inline void
+render_spin_pause (uint &spins)
+{
+  if (ASE_UNLIKELY (++spins >= 4096))
+    {
+      spins = 0;
+      std::this_thread::yield();
+    }
+#if defined __i386__ || defined __x86_64__
+  else
+    __builtin_ia32_pause();
+#endif
+}
+
 struct DriverSet {
   PcmDriverP  null_pcm_driver;
   String      pcm_name;
   PcmDriverP  pcm_driver;
   StringS     midi_names;
   MidiDriverS midi_drivers;
+  bool        midi_constant_latency = false;
 };
 
 // == AudioEngineThread ==
@@ -57,19 +149,37 @@ public:
   float                        chbuffer_data_[MAX_BUFFER_SIZE * fixed_n_channels] = { 0, };
   uint64                       write_stamp_ = 0;
   std::vector<AudioProcessor*> schedule_;
+  std::vector<std::pair<AudioProcessor*,AudioProcessor*>> schedule_deps_; // (input, processor)
+  RenderGraph                  render_graph_;
+  RenderStats                  render_stats_;
+  uint                         render_nparts_ = 1;      // participants of parallel rendering
+  uint                         render_nworkers_ = 0;    // worker threads usable by the engine
+  uint64                       render_target_stamp_ = 0;
+  std::vector<std::unique_ptr<RenderWorker>> render_workers_; // owned by main_loop thread
+  std::atomic<bool>            render_quit_ = false;
   EngineMidiInputP             midi_proc_;
+  static constexpr size_t      MIDI_ARENA_SIZE = 32768; // MidiEvent slots per block
+  MidiEventArena               midi_arena_ { MIDI_ARENA_SIZE };
   bool                         schedule_invalid_ = true;
   bool                         output_needsrunning_ = false;
   AtomicIntrusiveStack<EngineJobImpl> async_jobs_, const_jobs_, trash_jobs_;
+  static constexpr size_t      JOB_POOL_SIZE = 1024;
+  std::unique_ptr<EngineJobImpl[]> job_pool_mem_;
+  MpmcStack<EngineJobImpl>     job_pool_;
+  JobStats                     job_stats_;
   const VoidF                  owner_wakeup_;
   std::thread                 *thread_ = nullptr;
   MainLoopP                    event_loop_ = MainLoop::create();
   AudioProcessorS              oprocs_;
   ProjectImplP                 project_;
-  WaveWriterP                  wwriter_;
+  AsyncWaveWriterP             wwriter_;
+  static constexpr size_t      MAX_PACE_WRITERS = 16;
+  std::vector<AsyncWaveWriterP> pace_writers_;  // reserved MAX_PACE_WRITERS, pace freewheeling
   FastMemory::Block            transport_block_;
   DriverSet                    driver_set_ml; // accessed by main_loop thread
   std::atomic<uint64>          autostop_ = U64MAX;
+  std::atomic<bool>            freewheel_ = false;
+  std::atomic<float>           dsp_load_ = 0;
   struct UserNoteJob {
     std::atomic<UserNoteJob*> next = nullptr;
     UserNote note;
@@ -80,8 +190,14 @@ public:
   explicit        AudioEngineThread      (const VoidF&, uint, SpeakerArrangement, const FastMemory::Block&);
   void            schedule_clear         ();
   void            schedule_add           (AudioProcessor &aproc, uint level);
+  void            schedule_depend        (AudioProcessor &iproc, AudioProcessor &aproc);
   void            schedule_queue_update  ();
   void            schedule_render        (uint64 frames);
+  void            schedule_plan          ();
+  void            render_parallel        (uint64 target_stamp);
+  void            render_nodes           (uint64 target_stamp);
+  void            render_worker          (RenderWorker *worker);
+  void            update_render_workers_ml (uint n_workers);
   void            enable_output          (AudioProcessor &aproc, bool onoff);
   void            wakeup_thread_mt       ();
   void            capture_start          (const String &filename, bool needsrunning);
@@ -89,6 +205,8 @@ public:
   bool            ipc_pending            ();
   void            ipc_dispatch           ();
   AudioProcessorP get_event_source       ();
+  EngineJobImpl*  alloc_job_mt           ();
+  void            release_job            (EngineJobImpl *job);
   void            add_job_mt             (EngineJobImpl *aejob, const AudioEngine::JobQueue *jobqueue);
   bool            pcm_check_write        (bool write_buffer, int64 *timeout_usecs_p = nullptr);
   bool            driver_dispatcher      (const LoopState &state);
@@ -106,6 +224,13 @@ public:
 
 static std::thread::id audio_engine_thread_id = {};
 const ThreadId &AudioEngine::thread_id = audio_engine_thread_id;
+static thread_local bool audio_engine_render_thread = false;
+
+bool
+AudioEngine::thread_is_engine ()
+{
+  return audio_engine_render_thread || std::this_thread::get_id() == thread_id;
+}
 
 static inline std::atomic<AudioEngineThread::UserNoteJob*>&
 atomic_next_ptrref (AudioEngineThread::UserNoteJob *j)
@@ -113,6 +238,32 @@ atomic_next_ptrref (AudioEngineThread::UserNoteJob *j)
   return j->next;
 }
 
+// Print and post realtime violations, formatting allocates so this runs in the main thread
+static std::atomic<bool> rtcheck_report_queued = false;
+static void
+rtcheck_report ()
+{
+  rtcheck_report_queued = false;
+  const String report = RtCheck::report();
+  if (report.empty())
+    return;
+  printerr ("%s", report);
+  ASE_SERVER.user_note (report, "engine.rtcheck", UserNote::APPEND);
+}
+
+// Print and post processors with denormal output, runs in the main thread like rtcheck_report()
+static std::atomic<bool> denormals_report_queued = false;
+static void
+denormals_report ()
+{
+  denormals_report_queued = false;
+  const String report = Denormals::report();
+  if (report.empty())
+    return;
+  printerr ("%s", report);
+  ASE_SERVER.user_note (report, "engine.denormals", UserNote::APPEND);
+}
+
 template<int ADDING> static void
 interleaved_stereo (const size_t n_frames, float *buffer, AudioProcessor &proc, OBusId obus)
 {
@@ -174,6 +325,7 @@ AudioEngineThread::schedule_clear()
           proc->sched_next_ = nullptr;
         }
     }
+  schedule_deps_.clear();
   schedule_invalid_ = true;
 }
 
@@ -191,21 +343,26 @@ AudioEngineThread::schedule_add (AudioProcessor &aproc, uint level)
     aproc.reset_state (render_stamp_);
 }
 
+void
+AudioEngineThread::schedule_depend (AudioProcessor &iproc, AudioProcessor &aproc)
+{
+  schedule_deps_.push_back ({ &iproc, &aproc });
+}
+
 void
 AudioEngineThread::schedule_render (uint64 frames)
 {
   assert_return (0 == (frames & (8 - 1)));
+  RtCheck::Scope rtcheck_scope (nullptr);
+  Denormals::flush_to_zero(); // engine jobs may have called into plugins
+  const uint64 t0 = timestamp_benchmark();
   // render scheduled AudioProcessor nodes
   const uint64 target_stamp = render_stamp_ + frames;
-  for (size_t l = 0; l < schedule_.size(); l++)
-    {
-      AudioProcessor *proc = schedule_[l];
-      while (proc)
-        {
-          proc->render_block (target_stamp);
-          proc = proc->sched_next_;
-        }
-    }
+  if (render_nparts_ > 1)
+    render_parallel (target_stamp);
+  else
+    for (AudioProcessor *proc : render_graph_.nodes)
+      proc->render_block (target_stamp);
   // render output buffer interleaved
   constexpr auto MAIN_OBUS = OBusId (1);
   size_t n = 0;
@@ -222,6 +379,214 @@ AudioEngineThread::schedule_render (uint64 frames)
     floatfill (chbuffer_data_, 0.0, buffer_size_ * fixed_n_channels);
   render_stamp_ = target_stamp;
   transport_.advance (frames);
+  midi_arena_.reset(); // MidiEventOutput contents are valid for a single block
+  // track the fraction of the block duration spent rendering, rise fast and decay slowly
+  const double block_ns = frames * 1000000000.0 / transport_.samplerate;
+  const float load = freewheel_ ? 0 : (timestamp_benchmark() - t0) / block_ns;
+  const float last_load = dsp_load_.load (std::memory_order_relaxed);
+  dsp_load_.store (load > last_load ? load : last_load + (load - last_load) * 0.05f, std::memory_order_relaxed);
+}
+
+/// Build the dependency graph of all scheduled processors from `schedule_` and `schedule_deps_`.
+void
+AudioEngineThread::schedule_plan ()
+{
+  RenderGraph &graph = render_graph_;
+  const size_t old_size = graph.nodes.size();
+  graph.nodes.clear();
+  size_t widest = 0;
+  for (size_t l = 0; l < schedule_.size(); l++) // levels yield a topological order
+    {
+      const size_t b = graph.nodes.size();
+      for (AudioProcessor *proc = schedule_[l]; proc; proc = proc->sched_next_)
+        {
+          proc->sched_index_ = graph.nodes.size();
+          graph.nodes.push_back (proc);
+        }
+      widest = std::max (widest, graph.nodes.size() - b);
+    }
+  const size_t n_nodes = graph.nodes.size();
+  // dependency edges, inputs are revisited for every consumer
+  std::vector<std::pair<uint32,uint32>> edges;
+  edges.reserve (schedule_deps_.size());
+  for (const auto &dep : schedule_deps_)
+    if (dep.first->flags_ & dep.second->flags_ & AudioProcessor::SCHEDULED)
+      edges.push_back ({ dep.first->sched_index_, dep.second->sched_index_ });
+  std::sort (edges.begin(), edges.end());
+  edges.erase (std::unique (edges.begin(), edges.end()), edges.end());
+  graph.ndeps.assign (n_nodes, 0);
+  graph.succ_offsets.assign (n_nodes + 1, 0);
+  graph.succs.resize (edges.size());
+  for (size_t j = 0; j < edges.size(); j++)
+    {
+      assert_paranoid (edges[j].first < edges[j].second);
+      graph.succ_offsets[edges[j].first + 1] += 1;
+      graph.succs[j] = edges[j].second;
+      graph.ndeps[edges[j].second] += 1;
+    }
+  for (size_t i = 0; i < n_nodes; i++)
+    graph.succ_offsets[i + 1] += graph.succ_offsets[i];
+  // critical path, number of nodes along the longest chain of successors
+  std::vector<uint32> critical (n_nodes, 1);
+  for (ssize_t i = n_nodes - 1; i >= 0; i--)
+    for (size_t j = graph.succ_offsets[i]; j < graph.succ_offsets[i + 1]; j++)
+      critical[i] = std::max (critical[i], 1 + critical[graph.succs[j]]);
+  graph.order.resize (n_nodes);
+  for (size_t i = 0; i < n_nodes; i++)
+    graph.order[i] = i;
+  std::stable_sort (graph.order.begin(), graph.order.end(), [&critical] (uint32 a, uint32 b) {
+    return critical[a] > critical[b];
+  });
+  graph.rank.resize (n_nodes);
+  for (size_t k = 0; k < n_nodes; k++)
+    graph.rank[graph.order[k]] = k;
+  graph.ready0.assign ((n_nodes + 63) / 64, 0);
+  for (size_t i = 0; i < n_nodes; i++)
+    if (graph.ndeps[i] == 0)
+      graph.ready0[graph.rank[i] >> 6] |= uint64 (1) << (graph.rank[i] & 63);
+  if (graph.npending < n_nodes)
+    {
+      graph.npending = std::max (n_nodes, 2 * graph.npending);
+      graph.pending.reset (new std::atomic<uint32>[graph.npending]);
+    }
+  if (graph.nready < graph.ready0.size())
+    {
+      graph.nready = std::max (graph.ready0.size(), 2 * graph.nready);
+      graph.ready.reset (new AtomicU64[graph.nready]);
+    }
+  render_nparts_ = std::max (size_t (1), std::min (size_t (1 + render_nworkers_), widest));
+  if (old_size != n_nodes)
+    EDEBUG ("AudioEngineThread::%s: %u processors, %u dependencies, critical path: %u\n", __func__,
+            n_nodes, edges.size(), n_nodes ? critical[graph.order[0]] : 0);
+}
+
+/// Render `render_graph_` with the engine thread and `render_nparts_ - 1` workers.
+void
+AudioEngineThread::render_parallel (uint64 target_stamp)
+{
+  const uint64 t0 = timestamp_benchmark();
+  render_graph_.reset();
+  render_target_stamp_ = target_stamp;
+  for (uint p = 1; p < render_nparts_; p++)
+    {
+      RenderWorker &worker = *render_workers_[p - 1];
+      worker.state.store (RenderWorker::QUEUED, std::memory_order_release);
+      worker.sem.post();
+    }
+  render_stats_.sched_ns += timestamp_benchmark() - t0;
+  render_nodes (target_stamp);
+  // revoke workers that did not wake up in time, wait for busy ones
+  for (uint p = 1; p < render_nparts_; p++)
+    {
+      RenderWorker &worker = *render_workers_[p - 1];
+      uint expected = RenderWorker::QUEUED, spins = 0;
+      if (!worker.state.compare_exchange_strong (expected, RenderWorker::IDLE))
+        while (worker.state.load (std::memory_order_acquire) != RenderWorker::IDLE)
+          render_spin_pause (spins);
+    }
+  render_stats_.blocks += 1;
+}
+
+/// Render ready nodes until all nodes of `render_graph_` are done.
+void
+AudioEngineThread::render_nodes (const uint64 target_stamp)
+{
+  RenderGraph &graph = render_graph_;
+  const uint32 n_nodes = graph.nodes.size();
+  uint64 render_ns = 0, sched_ns = 0, wait_ns = 0, idle_since = 0;
+  uint64 last = timestamp_benchmark();
+  uint spins = 0;
+  while (graph.done.load (std::memory_order_acquire) < n_nodes)
+    {
+      const ssize_t node = graph.claim();
+      if (node < 0)
+        {
+          if (!idle_since)
+            idle_since = timestamp_benchmark();
+          render_spin_pause (spins);
+          continue;
+        }
+      const uint64 start = timestamp_benchmark();
+      if (idle_since)
+        {
+          wait_ns += start - idle_since;
+          sched_ns += idle_since - last;
+          idle_since = 0;
+        }
+      else
+        sched_ns += start - last;
+      graph.nodes[node]->render_block (target_stamp);
+      last = timestamp_benchmark();
+      render_ns += last - start;
+      graph.release (node);
+    }
+  const uint64 end = timestamp_benchmark();
+  if (idle_since)
+    {
+      wait_ns += end - idle_since;
+      sched_ns += idle_since - last;
+    }
+  else
+    sched_ns += end - last;
+  render_stats_.render_ns += render_ns;
+  render_stats_.sched_ns += sched_ns;
+  render_stats_.wait_ns += wait_ns;
+}
+
+void
+AudioEngineThread::render_worker (RenderWorker *worker)
+{
+  this_thread_set_name (string_format ("AudioEngine-%u", worker->participant)); // max 16 chars
+  audio_engine_render_thread = true;
+  sched_fast_priority (this_thread_gettid());
+  Denormals::flush_to_zero();
+  for (;;)
+    {
+      worker->sem.wait();
+      if (render_quit_)
+        break;
+      uint expected = RenderWorker::QUEUED;
+      if (!worker->state.compare_exchange_strong (expected, RenderWorker::BUSY))
+        continue; // revoked by engine thread
+      Denormals::flush_to_zero(); // follow enable_check() changes
+      render_nodes (render_target_stamp_);
+      worker->state.store (RenderWorker::IDLE, std::memory_order_release);
+    }
+}
+
+/// Replace the pool of render worker threads, `n_workers` may be 0.
+void
+AudioEngineThread::update_render_workers_ml (uint n_workers)
+{
+  assert_return (this_thread_is_ase()); // main_loop thread
+  if (n_workers == render_workers_.size())
+    return;
+  // detach workers from rendering
+  synchronized_jobs += [this] () {
+    render_nworkers_ = 0;
+    render_nparts_ = 1;
+    schedule_queue_update();
+  };
+  render_quit_ = true;
+  for (auto &worker : render_workers_)
+    worker->sem.post();
+  for (auto &worker : render_workers_)
+    worker->thread.join();
+  render_workers_.clear();
+  render_quit_ = false;
+  // spawn new workers
+  for (uint i = 0; i < n_workers; i++)
+    {
+      render_workers_.push_back (std::make_unique<RenderWorker>());
+      RenderWorker *worker = render_workers_.back().get();
+      worker->participant = 1 + i;
+      worker->thread = std::thread (&AudioEngineThread::render_worker, this, worker);
+    }
+  synchronized_jobs += [this, n_workers] () {
+    render_nworkers_ = n_workers;
+    schedule_queue_update();
+  };
+  EDEBUG ("AudioEngineThread::%s: using %u render worker threads\n", __func__, n_workers);
 }
 
 void
@@ -250,26 +615,30 @@ AudioEngineThread::capture_start (const String &filename, bool needsrunning)
   const uint sample_rate = transport_.samplerate;
   capture_stop();
   output_needsrunning_ = needsrunning;
+  WaveWriterP wwriter;
   if (string_endswith (filename, ".wav"))
     {
-      wwriter_ = wave_writer_create_wav (sample_rate, fixed_n_channels, filename);
-      if (!wwriter_)
+      wwriter = wave_writer_create_wav (sample_rate, fixed_n_channels, filename);
+      if (!wwriter)
         printerr ("%s: failed to open file: %s\n", filename, strerror (errno));
     }
   else if (string_endswith (filename, ".opus"))
     {
-      wwriter_ = wave_writer_create_opus (sample_rate, fixed_n_channels, filename);
-      if (!wwriter_)
+      wwriter = wave_writer_create_opus (sample_rate, fixed_n_channels, filename);
+      if (!wwriter)
         printerr ("%s: failed to open file: %s\n", filename, strerror (errno));
     }
   else if (string_endswith (filename, ".flac"))
     {
-      wwriter_ = wave_writer_create_flac (sample_rate, fixed_n_channels, filename);
-      if (!wwriter_)
+      wwriter = wave_writer_create_flac (sample_rate, fixed_n_channels, filename);
+      if (!wwriter)
         printerr ("%s: failed to open file: %s\n", filename, strerror (errno));
     }
   else if (!filename.empty())
     printerr ("%s: unknown sample file: %s\n", filename, strerror (ENOSYS));
+  // encode and write files outside the engine thread
+  if (wwriter)
+    wwriter_ = wave_writer_create_async (wwriter, fixed_n_channels, CAPTURE_RING_SECONDS * sample_rate);
 }
 
 void
@@ -277,8 +646,9 @@ AudioEngineThread::capture_stop()
 {
   if (wwriter_)
     {
-      wwriter_->close();
+      AsyncWaveWriterP wwriter = wwriter_;
       wwriter_ = nullptr;
+      main_jobs += [wwriter] () { wwriter->close(); }; // flushing may take a while
     }
 }
 
@@ -294,7 +664,9 @@ AudioEngineThread::run (StartQueue *sq)
   // FIXME: assert owner_wakeup and free trash
   this_thread_set_name ("AudioEngine-0"); // max 16 chars
   audio_engine_thread_id = std::this_thread::get_id();
+  audio_engine_render_thread = true;
   sched_fast_priority (this_thread_gettid());
+  Denormals::flush_to_zero();
   event_loop_->exec_dispatcher (std::bind (&AudioEngineThread::driver_dispatcher, this, std::placeholders::_1));
   sq->push ('R'); // StartQueue becomes invalid after this call
   sq = nullptr;
@@ -305,34 +677,58 @@ bool
 AudioEngineThread::process_jobs (AtomicIntrusiveStack<EngineJobImpl> &joblist)
 {
   EngineJobImpl *const jobs = joblist.pop_reversed(), *last = nullptr;
+  return_unless (jobs, false);
+  const uint64 now = timestamp_benchmark();
+  uint64 n_jobs = 0;
   for (EngineJobImpl *job = jobs; job; last = job, job = job->next)
-    job->func();
-  if (last)
     {
-      if (trash_jobs_.push_chain (jobs, last))
-        owner_wakeup_();
+      const uint64 latency = now > job->stamp ? now - job->stamp : 0;
+      job_stats_.latency_sum_ns += latency;
+      job_stats_.latency_max_ns = std::max (job_stats_.latency_max_ns, latency);
+      n_jobs++;
+      job->call();
+      if (job->sem) // blocking job, owner may continue after post()
+        std::exchange (job->sem, nullptr)->post();
     }
-  return last != nullptr;
+  job_stats_.n_done.fetch_add (n_jobs, std::memory_order_relaxed);
+  // closures are destroyed in the main thread
+  if (trash_jobs_.push_chain (jobs, last))
+    owner_wakeup_();
+  return true;
 }
 
 bool
 AudioEngineThread::pcm_check_write (bool write_buffer, int64 *timeout_usecs_p)
 {
   int64 timeout_usecs = INT64_MAX;
-  const bool can_write = pcm_driver_->pcm_check_io (&timeout_usecs) || timeout_usecs == 0;
+  const bool freewheel = freewheel_;
+  bool can_write;
+  if (freewheel) // render back-to-back, paced only by the capture and pace writers
+    {
+      can_write = !wwriter_ || wwriter_->writable() >= buffer_size_;
+      for (size_t i = 0; i < pace_writers_.size() && can_write; i++)
+        can_write = pace_writers_[i]->writable() >= buffer_size_;
+      timeout_usecs = can_write ? 0 : 1000;
+    }
+  else
+    can_write = pcm_driver_->pcm_check_io (&timeout_usecs) || timeout_usecs == 0;
   if (timeout_usecs_p)
     *timeout_usecs_p = timeout_usecs;
   if (!write_buffer)
     return can_write;
   if (!can_write || write_stamp_ >= render_stamp_)
     return false;
-  pcm_driver_->pcm_write (buffer_size_ * fixed_n_channels, chbuffer_data_);
+  if (!freewheel)
+    pcm_driver_->pcm_write (buffer_size_ * fixed_n_channels, chbuffer_data_);
   if (wwriter_ && fixed_n_channels == 2 && write_stamp_ < autostop_ &&
       (!output_needsrunning_ || transport_.running()))
     wwriter_->write (chbuffer_data_, buffer_size_);
   write_stamp_ += buffer_size_;
   if (write_stamp_ >= autostop_)
-    main_loop_autostop_mt();
+    {
+      freewheel_ = false; // resume driver pacing
+      main_loop_autostop_mt();
+    }
   assert_warn (write_stamp_ == render_stamp_);
   return false;
 }
@@ -365,10 +761,15 @@ AudioEngineThread::driver_dispatcher (const LoopState &state)
               schedule_clear();
               for (AudioProcessorP &proc : oprocs_)
                 proc->schedule_processor();
+              schedule_plan();
               schedule_invalid_ = false;
             }
           if (render_stamp_ <= write_stamp_) // async jobs may have adjusted stamps
             schedule_render (buffer_size_);
+          if (ASE_UNLIKELY (RtCheck::pending()) && !rtcheck_report_queued.exchange (true))
+            main_rt_jobs += RtCall (rtcheck_report);
+          if (ASE_UNLIKELY (Denormals::pending()) && !denormals_report_queued.exchange (true))
+            main_rt_jobs += RtCall (denormals_report);
           pcm_check_write (true); // minimize drop outs
         }
       if (!const_jobs_.empty()) {   // owner may be blocking for const_jobs_ execution
@@ -416,10 +817,36 @@ AudioEngineThread::ipc_dispatch ()
     {
       EngineJobImpl *old = job;
       job = job->next;
-      delete old;
+      release_job (old);
     }
 }
 
+/// Fetch an EngineJobImpl from the preallocated job pool, falls back to the heap if exhausted.
+EngineJobImpl*
+AudioEngineThread::alloc_job_mt ()
+{
+  EngineJobImpl *job = job_pool_.pop();
+  if (ASE_UNLIKELY (!job))
+    {
+      job = new EngineJobImpl();
+      job_stats_.n_heap.fetch_add (1, std::memory_order_relaxed);
+    }
+  return job;
+}
+
+/// Destroy the closure of `job` and return it to the job pool.
+void
+AudioEngineThread::release_job (EngineJobImpl *job)
+{
+  job->clear();
+  job->next = nullptr;
+  job->stamp = 0;
+  if (job->pooled)
+    job_pool_.push (job);
+  else
+    delete job;
+}
+
 void
 AudioEngineThread::wakeup_thread_mt()
 {
@@ -434,6 +861,7 @@ AudioEngineThread::start_threads_ml()
   assert_return (thread_ == nullptr);
   assert_return (midi_proc_ == nullptr);
   schedule_.reserve (8192);
+  schedule_deps_.reserve (8192);
   create_processors_ml();
   update_drivers ("null", 0, {}); // create drivers
   null_pcm_driver_ = driver_set_ml.null_pcm_driver;
@@ -450,6 +878,7 @@ AudioEngineThread::stop_threads_ml()
 {
   assert_return (this_thread_is_ase()); // main_loop thread
   assert_return (thread_ != nullptr);
+  update_render_workers_ml (0);
   event_loop_->quit (0);
   thread_->join();
   audio_engine_thread_id = {};
@@ -466,10 +895,17 @@ AudioEngineThread::add_job_mt (EngineJobImpl *job, const AudioEngine::JobQueue *
   // engine not running, run job right away
   if (!engine.thread_)
     {
-      job->func();
-      delete job;
+      job->call();
+      release_job (job);
       return;
     }
+  // account queue depth and latency
+  job->stamp = timestamp_benchmark();
+  const uint64 depth = 1 + job_stats_.n_queued.fetch_add (1, std::memory_order_relaxed) -
+                       job_stats_.n_done.load (std::memory_order_relaxed);
+  uint64 max_depth = job_stats_.max_depth.load (std::memory_order_relaxed);
+  while (depth > max_depth && !job_stats_.max_depth.compare_exchange_weak (max_depth, depth, std::memory_order_relaxed))
+    {}
   // enqueue async_jobs
   if (jobqueue == &async_jobs)  // non-blocking, via async_jobs_ queue
     { // run asynchronously
@@ -478,14 +914,9 @@ AudioEngineThread::add_job_mt (EngineJobImpl *job, const AudioEngine::JobQueue *
         wakeup_thread_mt();
       return;
     }
-  // blocking jobs, queue wrapper that synchronizes via Semaphore
+  // blocking jobs, synchronize via Semaphore
   ScopedSemaphore sem;
-  VoidFunc jobfunc = job->func;
-  std::function<void()> wrapper = [&sem, jobfunc] () {
-    jobfunc();
-    sem.post();
-  };
-  job->func = wrapper;
+  job->sem = &sem;
   bool need_wakeup;
   if (jobqueue == &const_jobs)  // blocking, via const_jobs_ queue
     need_wakeup = engine.const_jobs_.push (job);
@@ -528,6 +959,30 @@ AudioEngineThread::engine_stats_string (uint64_t stats) const
     });
     s += string_format ("%s: %s (MUST_SCHEDULE)\n", pinfo.label, oprocs_[i]->debug_name());
   }
+  if (wwriter_)
+    {
+      const AsyncWaveWriter::Stats wstats = wwriter_->stats();
+      s += string_format ("Capture: %s: %u frames, ring: %u/%u frames high-water, %u overflows, %u frames dropped, %u frames failed\n",
+                          wwriter_->name(), wstats.n_frames, wstats.high_water, wstats.capacity,
+                          wstats.n_overflows, wstats.n_dropped, wstats.n_failed);
+    }
+  if (midi_proc_)
+    s += midi_timing_stats_string (*midi_proc_);
+  const MidiEventArena::Stats astats = midi_arena_.stats();
+  s += string_format ("MidiEventArena: %u/%u events high-water, last block: %u, %u blocks, %u exhausted, %u heap allocations\n",
+                      astats.high_water, astats.capacity, astats.last_block, astats.n_blocks,
+                      astats.n_exhausted, astats.n_heap);
+  const uint64 n_done = job_stats_.n_done, n_queued = job_stats_.n_queued;
+  s += string_format ("Jobs: %u executed, %u pending (max %u), latency avg=%.1fus max=%.1fus, %u heap allocations\n",
+                      n_done, n_queued - std::min (n_queued, n_done), uint64 (job_stats_.max_depth),
+                      job_stats_.latency_sum_ns * 0.001 / std::max (uint64 (1), n_done),
+                      job_stats_.latency_max_ns * 0.001, uint64 (job_stats_.n_heap));
+  const uint64 blocks = std::max (uint64 (1), uint64 (render_stats_.blocks));
+  s += string_format ("Render: %u processors, %u dependencies, %u threads\n",
+                      render_graph_.nodes.size(), render_graph_.succs.size(), render_nparts_);
+  s += string_format ("Render: %u parallel blocks, per block: render=%.1fus scheduling=%.1fus waiting=%.1fus\n",
+                      uint64 (render_stats_.blocks), render_stats_.render_ns * 0.001 / blocks,
+                      render_stats_.sched_ns * 0.001 / blocks, render_stats_.wait_ns * 0.001 / blocks);
   return s;
 }
 
@@ -539,6 +994,8 @@ AudioEngineThread::get_project ()
 
 AudioEngineThread::~AudioEngineThread ()
 {
+  while (job_pool_.pop())
+    {} // MpmcStack must be empty for destruction
   FastMemory::Block transport_block = transport_block_; // keep alive until after ~AudioEngine
   main_jobs += [transport_block] () { ServerImpl::instancep()->telemem_release (transport_block); };
 }
@@ -550,6 +1007,13 @@ AudioEngineThread::AudioEngineThread (const VoidF &owner_wakeup, uint sample_rat
 {
   render_stamp_ = MAX_BUFFER_SIZE; // enforce non-0 start offset for all modules
   oprocs_.reserve (16);
+  pace_writers_.reserve (MAX_PACE_WRITERS);
+  job_pool_mem_ = std::make_unique<EngineJobImpl[]> (JOB_POOL_SIZE);
+  for (size_t i = 0; i < JOB_POOL_SIZE; i++)
+    {
+      job_pool_mem_[i].pooled = true;
+      job_pool_.push (&job_pool_mem_[i]);
+    }
   assert_return (transport_.samplerate == 48000);
 }
 
@@ -582,6 +1046,14 @@ AudioEngine::engine_stats (uint64_t stats) const
   return strstats;
 }
 
+/// Per-block allocator for MidiEventOutput [MT-Safe].
+MidiEventArena&
+AudioEngine::midi_event_arena ()
+{
+  AudioEngineThread &impl = static_cast<AudioEngineThread&> (*this);
+  return impl.midi_arena_;
+}
+
 uint64
 AudioEngine::block_size() const
 {
@@ -596,6 +1068,53 @@ AudioEngine::set_autostop (uint64_t nsamples)
   impl.autostop_ = nsamples;
 }
 
+/// Render blocks back-to-back without PCM driver pacing or output, e.g. for offline bouncing.
+/// Freewheeling ends automatically once the autostop position has been written.
+void
+AudioEngine::set_freewheel (bool onoff)
+{
+  AudioEngineThread &impl = static_cast<AudioEngineThread&> (*this);
+  impl.freewheel_ = onoff;
+  impl.wakeup_thread_mt();
+}
+
+/// Pace freewheel rendering by the ring space of `writer`, like the capture writer.
+/// Renders stall until `writer` can take another block, so writers fed from render() lose no frames.
+void
+AudioEngine::pace_freewheel (AsyncWaveWriterP writer, bool onoff)
+{
+  assert_return (writer != nullptr);
+  AudioEngineThread &impl = static_cast<AudioEngineThread&> (*this);
+  auto job = [&impl, writer, onoff] () {
+    std::vector<AsyncWaveWriterP> &writers = impl.pace_writers_;
+    const auto it = std::find (writers.begin(), writers.end(), writer);
+    if (onoff && it == writers.end())
+      {
+        if (writers.size() < AudioEngineThread::MAX_PACE_WRITERS)
+          writers.push_back (writer); // capacity is reserved
+      }
+    else if (!onoff && it != writers.end())
+      writers.erase (it); // `writer` in the job closure is released in the main thread
+  };
+  async_jobs += job;
+}
+
+bool
+AudioEngine::freewheel () const
+{
+  const AudioEngineThread &impl = static_cast<const AudioEngineThread&> (*this);
+  return impl.freewheel_;
+}
+
+/// Fraction of the block duration spent rendering, 1.0 means no headroom left.
+/// The value follows increases immediately and decays slowly, it is 0 during freewheeling.
+float
+AudioEngine::dsp_load () const
+{
+  const AudioEngineThread &impl = static_cast<const AudioEngineThread&> (*this);
+  return impl.dsp_load_.load (std::memory_order_relaxed);
+}
+
 void
 AudioEngine::schedule_queue_update()
 {
@@ -610,6 +1129,13 @@ AudioEngine::schedule_add (AudioProcessor &aproc, uint level)
   impl.schedule_add (aproc, level);
 }
 
+void
+AudioEngine::schedule_depend (AudioProcessor &iproc, AudioProcessor &aproc)
+{
+  AudioEngineThread &impl = static_cast<AudioEngineThread&> (*this);
+  impl.schedule_depend (iproc, aproc);
+}
+
 void
 AudioEngine::enable_output (AudioProcessor &aproc, bool onoff)
 {
@@ -698,16 +1224,24 @@ AudioEngine::JobQueue::JobQueue (AudioEngine &aet) :
   assert_return (ptrdiff_t (this) < 256 + ptrdiff_t (&aet));
 }
 
+EngineJobImpl*
+AudioEngine::JobQueue::job_alloc ()
+{
+  AudioEngine *audio_engine = reinterpret_cast<AudioEngine*> (ptrdiff_t (this) - queue_tag_);
+  AudioEngineThread &audio_engine_thread = static_cast<AudioEngineThread&> (*audio_engine);
+  return audio_engine_thread.alloc_job_mt();
+}
+
 void
-AudioEngine::JobQueue::operator+= (const std::function<void()> &job)
+AudioEngine::JobQueue::job_submit (EngineJobImpl *job)
 {
   AudioEngine *audio_engine = reinterpret_cast<AudioEngine*> (ptrdiff_t (this) - queue_tag_);
   AudioEngineThread &audio_engine_thread = static_cast<AudioEngineThread&> (*audio_engine);
-  return audio_engine_thread.add_job_mt (new EngineJobImpl (job), this);
+  return audio_engine_thread.add_job_mt (job, this);
 }
 
 bool
-AudioEngine::update_drivers (const String &pcm_name, uint latency_ms, const StringS &midi_prefs)
+AudioEngine::update_drivers (const String &pcm_name, uint latency_ms, const StringS &midi_prefs, bool midi_constant_latency)
 {
   AudioEngineThread &engine_thread = static_cast<AudioEngineThread&> (*this);
   DriverSet &dset = engine_thread.driver_set_ml;
@@ -752,6 +1286,10 @@ AudioEngine::update_drivers (const String &pcm_name, uint latency_ms, const Stri
           break;
         }
   // MIDI Drivers
+  if (dset.midi_constant_latency != midi_constant_latency) {
+    dset.midi_constant_latency = midi_constant_latency;
+    dset.midi_names.clear(); // reopen, the input mode is fixed before a driver is used by the engine
+  }
   dset.midi_names.resize (midis.size());
   dset.midi_drivers.resize (dset.midi_names.size());
   for (size_t i = 0; i < dset.midi_drivers.size(); i++) {
@@ -769,6 +1307,8 @@ AudioEngine::update_drivers (const String &pcm_name, uint latency_ms, const Stri
       engine_thread.queue_user_note ("driver.midi", UserNote::CLEAR, errmsg);
       printerr ("%s\n", string_replace (errmsg, "\n", " "));
     }
+    if (dset.midi_drivers[i] && dset.midi_constant_latency && !dset.midi_drivers[i]->constant_latency (true))
+      EDEBUG ("AudioEngine::%s: MIDI device #%u lacks constant latency support: %s\n", __func__, 1 + i, dset.midi_names[i]);
   }
   // Update running engine
   if (must_update) {
@@ -801,7 +1341,7 @@ class EngineMidiInput : public AudioProcessor {
     estream.clear();
     for (size_t i = 0; i < midi_drivers_.size(); i++)
       if (midi_drivers_[i])
-        midi_drivers_[i]->fetch_events (estream, sample_rate());
+        midi_drivers_[i]->fetch_events (estream, sample_rate(), n_frames);
   }
 public:
   MidiDriverS midi_drivers_;
@@ -810,6 +1350,30 @@ public:
   {}
 };
 
+static String
+midi_timing_stats_string (const EngineMidiInput &midi_proc)
+{
+  String s;
+  for (size_t i = 0; i < midi_proc.midi_drivers_.size(); i++)
+    {
+      MidiTimingStats mstats;
+      if (!midi_proc.midi_drivers_[i] || !midi_proc.midi_drivers_[i]->timing_stats (mstats))
+        continue;
+      auto histogram = [] (const MidiTimingStats::Histogram &h) {
+        String b;
+        for (size_t j = 0; j < h.size(); j++)
+          if (h[j])
+            b += string_format (" <%uus:%u", 1 << j, h[j]);
+        return b.empty() ? String (" -") : b;
+      };
+      s += string_format ("MIDI#%u: %s: %u events, %u late, %u overflows\n", 1 + i, midi_proc.midi_drivers_[i]->devid(),
+                          mstats.n_events, mstats.n_late, mstats.n_overflows);
+      s += string_format ("MIDI#%u: block jitter:%s\n", 1 + i, histogram (mstats.block_jitter));
+      s += string_format ("MIDI#%u: late by:%s\n", 1 + i, histogram (mstats.late_by));
+    }
+  return s;
+}
+
 void
 AudioEngineThread::create_processors_ml ()
 {
@@ -919,6 +1483,22 @@ static Preference synth_latency_pref =
         String ("descr=") + _("Processing duration between input and output of a single sample, smaller values increase CPU load"), } },
     [] (const CString&,const Value&) { apply_driver_preferences(); });
 
+static Preference render_threads_pref =
+  Preference ({
+      "driver.pcm.render_threads", _("Render Threads"), "", 0, "",
+      MinMaxStep { 0, 64, 1 }, STANDARD, {
+        String ("descr=") + _("Number of threads used for parallel synthesis of independent tracks, 0 selects a value based on the number of CPU cores"), } },
+    [] (const CString&,const Value&) { apply_driver_preferences(); });
+
+static uint
+render_threads_from_pref ()
+{
+  const int n_threads = render_threads_pref.getn();
+  if (n_threads > 0)
+    return n_threads;
+  return CLAMP (this_thread_online_cpus() / 2, 1, 16);
+}
+
 static Preference midi1_driver_pref =
   Preference ({
       "driver.midi1.devid", _("MIDI Controller (1)"), "", "auto", "ms",
@@ -944,6 +1524,13 @@ static Preference midi4_driver_pref =
         String ("descr=") + _("MIDI controller device to be used for MIDI input"), } },
     [] (const CString&,const Value&) { apply_driver_preferences(); });
 
+static Preference midi_constant_latency_pref =
+  Preference ({
+      "driver.midi.constant_latency", _("Constant MIDI Latency"), "", false, "",
+      {}, STANDARD + String (":toggle"), {
+        String ("descr=") + _("Timestamp MIDI input in a dedicated thread and play events at their exact offset one block later, instead of at the next block start"), } },
+    [] (const CString&,const Value&) { apply_driver_preferences(); });
+
 static void
 apply_driver_preferences ()
 {
@@ -951,7 +1538,11 @@ apply_driver_preferences ()
   main_loop->exec_once (97, &engine_driver_set_timerid,
                         []() {
                           StringS midis = { midi1_driver_pref.gets(), midi2_driver_pref.gets(), midi3_driver_pref.gets(), midi4_driver_pref.gets(), };
-                          main_config.engine->update_drivers (pcm_driver_pref.gets(), synth_latency_pref.getn(), midis);
+                          const String pcm_driver = main_config.freewheel ? "null" : pcm_driver_pref.gets();
+                          main_config.engine->update_drivers (pcm_driver, synth_latency_pref.getn(), midis, midi_constant_latency_pref.getb());
+                          AudioEngineThread &engine_thread = static_cast<AudioEngineThread&> (*main_config.engine);
+                          if (engine_thread.thread_)
+                            engine_thread.update_render_workers_ml (render_threads_from_pref() - 1);
                         });
 }
 
@@ -4,11 +4,14 @@
 
 #include <ase/transport.hh>
 #include <ase/platform.hh>
+#include <ase/wave.hh>
 #include <atomic>
 
 namespace Ase {
 
 class AudioEngineThread;
+class MidiEventArena;
+struct EngineJobImpl;
 
 /** Main handle for AudioProcessor administration and audio rendering.
  * Use make_audio_engine() to create a new engine and start_threads() to run
@@ -29,6 +32,7 @@ protected:
   void     enable_output         (AudioProcessor &aproc, bool onoff);
   void     schedule_queue_update ();
   void     schedule_add          (AudioProcessor &aproc, uint level);
+  void     schedule_depend       (AudioProcessor &iproc, AudioProcessor &aproc);
 public:
   // Owner-Thread API
   void            start_threads    ();
@@ -42,25 +46,33 @@ public:
   // MT-Safe API
   uint64_t               frame_counter       () const           { return render_stamp_; }
   uint64_t               block_size          () const;
+  MidiEventArena&        midi_event_arena    ();
   const AudioTransport&  transport           () const           { return transport_; }
   uint                   sample_rate         () const ASE_CONST { return transport().samplerate; }
   uint                   nyquist             () const ASE_CONST { return transport().nyquist; }
   double                 inyquist            () const ASE_CONST { return transport().inyquist; }
   SpeakerArrangement     speaker_arrangement () const           { return transport().speaker_arrangement; }
   void                   set_autostop        (uint64_t nsamples);
+  void                   set_freewheel       (bool onoff);
+  bool                   freewheel           () const;
+  void                   pace_freewheel      (AsyncWaveWriterP writer, bool onoff);
+  float                  dsp_load            () const;
   void                   queue_capture_start (CallbackS&, const String &filename, bool needsrunning);
   void                   queue_capture_stop  (CallbackS&);
-  bool                   update_drivers      (const String &pcm, uint latency_ms, const StringS &midis);
+  bool                   update_drivers      (const String &pcm, uint latency_ms, const StringS &midis, bool midi_constant_latency = false);
   String                 engine_stats        (uint64_t stats) const;
-  static bool            thread_is_engine    () { return std::this_thread::get_id() == thread_id; }
+  static bool            thread_is_engine    (); ///< True for the engine thread and its render workers.
   static const ThreadId &thread_id;
   // JobQueues
   class JobQueue {
     friend class AudioEngine;
     const uint8_t        queue_tag_;
     explicit             JobQueue (AudioEngine&);
+    EngineJobImpl*       job_alloc  ();
+    void                 job_submit (EngineJobImpl *job);
   public:
-    void                 operator+= (const std::function<void()> &job);
+    template<class F>
+    void                 operator+= (F &&job);
   };
   JobQueue               async_jobs;    ///< Executed asynchronously, may modify AudioProcessor objects
   JobQueue               const_jobs;    ///< Blocks during execution, must treat AudioProcessor objects read-only
@@ -70,6 +82,51 @@ protected:
 
 AudioEngine& make_audio_engine (const VoidF &owner_wakeup, uint sample_rate, SpeakerArrangement speakerarrangement);
 
+/// Engine job closure, preallocated by the engine and storing small captures inline.
+struct EngineJobImpl {
+  static constexpr size_t INLINE_SIZE = 96;
+  alignas (16) char            mem_[INLINE_SIZE];
+  void                       (*invoke_) (EngineJobImpl&) = nullptr;
+  void                       (*destroy_) (EngineJobImpl&) = nullptr;
+  std::atomic<EngineJobImpl*>  next = nullptr;          // job queue link
+  std::atomic<EngineJobImpl*>  intr_ptr_ = nullptr;     // job pool link
+  ScopedSemaphore             *sem = nullptr;           // posted after execution of blocking jobs
+  uint64_t                     stamp = 0;               // enqueue time for latency measurements
+  bool                         pooled = false;          // owned by the engine job pool
+  template<class F> void       assign   (F &&f);
+  void                         call     ()      { invoke_ (*this); }
+  void                         clear    ()      { if (destroy_) destroy_ (*this); invoke_ = destroy_ = nullptr; }
+};
+
+template<class F> void
+EngineJobImpl::assign (F &&f)
+{
+  using Func = std::decay_t<F>;
+  static_assert (std::is_invocable_r<void, Func&>::value);
+  if constexpr (sizeof (Func) <= INLINE_SIZE && alignof (Func) <= 16)
+    {
+      new (mem_) Func (std::forward<F> (f));
+      invoke_ = [] (EngineJobImpl &job) { (*std::launder (reinterpret_cast<Func*> (job.mem_))) (); };
+      destroy_ = [] (EngineJobImpl &job) { std::launder (reinterpret_cast<Func*> (job.mem_))->~Func(); };
+    }
+  else // oversized captures need a heap allocation
+    {
+      *reinterpret_cast<Func**> (mem_) = new Func (std::forward<F> (f));
+      invoke_ = [] (EngineJobImpl &job) { (**reinterpret_cast<Func**> (job.mem_)) (); };
+      destroy_ = [] (EngineJobImpl &job) { delete *reinterpret_cast<Func**> (job.mem_); };
+    }
+}
+
+/// Queue `job` for execution by the engine thread, see AudioEngine for the semantics of each queue.
+/// The closure is copied into preallocated memory and destroyed later on in the main thread.
+template<class F> void
+AudioEngine::JobQueue::operator+= (F &&job)
+{
+  EngineJobImpl *const ejob = job_alloc();
+  ejob->assign (std::forward<F> (job));
+  job_submit (ejob);
+}
+
 /// Helper to modify const struct contents, e.g. asyn job lambda members.
 template<class T>
 struct Mutable {
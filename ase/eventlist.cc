@@ -1,6 +1,7 @@
 // This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
 #include "eventlist.hh"
 #include "utils.hh"
+#include "randomhash.hh"
 #include "testing.hh"
 #include "internal.hh"
 
@@ -68,3 +69,64 @@ event_list_tests()
   cnote = notes.lookup_after (Note (17, 0)); TASSERT (cnote && cnote->key == 1);
   cnote = notes.lookup_after (Note (0, 0)); TASSERT (cnote && cnote == &notes.front());
 }
+
+TEST_INTEGRITY (chunked_event_list_tests);
+static void
+chunked_event_list_tests()
+{
+  struct Item {
+    int key = 0, value = 0;
+  };
+  struct CompareKey { int operator() (const Item &a, const Item &b) const { return Ase::Aux::compare_lesser (a.key, b.key); } };
+  using ItemList = Ase::ChunkedEventList<Item,CompareKey>;
+  ItemList items;
+  std::map<int,int> shadow;
+  Ase::FastRng rng (4711);
+  ItemList::ConstP snapshot;
+  std::map<int,int> snapshot_shadow;
+  for (int i = 0; i < 20000; i++)
+    {
+      const int key = rng.next() % 3000;
+      if (rng.next() % 3)
+        {
+          const bool replaced = items.insert (Item { key, i });
+          TASSERT (replaced == shadow.count (key));
+          shadow[key] = i;
+        }
+      else
+        {
+          Item removed;
+          const bool found = items.remove (Item { key }, &removed);
+          TASSERT (found == shadow.count (key));
+          TASSERT (!found || removed.value == shadow[key]);
+          shadow.erase (key);
+        }
+      if (i == 10000)
+        {
+          snapshot = std::make_shared<const ItemList> (items);
+          snapshot_shadow = shadow;
+        }
+    }
+  TASSERT (items.size() == shadow.size());
+  auto sit = shadow.begin();
+  for (const Item &item : items)
+    {
+      TASSERT (sit != shadow.end() && item.key == sit->first && item.value == sit->second);
+      ++sit;
+    }
+  TASSERT (sit == shadow.end());
+  // snapshots are unaffected by later modifications
+  TASSERT (snapshot->size() == snapshot_shadow.size());
+  TASSERT (std::equal (snapshot->begin(), snapshot->end(), snapshot_shadow.begin(), snapshot_shadow.end(),
+                       [] (const Item &a, const auto &b) { return a.key == b.first && a.value == b.second; }));
+  // lookups
+  for (int key = -1; key <= 3000; key += 7)
+    {
+      const Item *item = items.lookup (Item { key });
+      TASSERT ((item != nullptr) == shadow.count (key));
+      auto it = items.lower_bound (Item { key });
+      auto sb = shadow.lower_bound (key);
+      TASSERT ((it == items.end()) == (sb == shadow.end()));
+      TASSERT (it == items.end() || it->key == sb->first);
+    }
+}
@@ -52,6 +52,52 @@ private:
   static void        nop          (const Event&, int) {}
 };
 
+/** Sorted array of unique `Event` structures, split into shared chunks.
+ * Lookups, insertions and removals are O(log n) plus a bounded move within a chunk.
+ * Copies share all chunks and chunks are copied on write, so a copy serves as cheap
+ * read-only snapshot, e.g. for another thread. Iteration is linear within chunks.
+ */
+template<class Event, class Compare>
+class ChunkedEventList {
+  using Chunk = std::vector<Event>;
+  using ChunkP = std::shared_ptr<Chunk>;
+  static constexpr size_t CHUNK_SIZE = 256;     // chunks are split at 2 * CHUNK_SIZE
+  std::vector<ChunkP> chunks_;                  // sorted, never contains empty chunks
+  size_t              size_ = 0;
+  Compare             compare_;
+  size_t              find_chunk (const Event &event) const;
+  Chunk&              writable   (size_t c);
+public:
+  using ConstP = std::shared_ptr<const ChunkedEventList>;
+  class const_iterator {
+    const ChunkP *chunk_ = nullptr;
+    size_t        index_ = 0;
+  public:
+    using difference_type = ssize_t;
+    using value_type = Event;
+    using pointer = const Event*;
+    using reference = const Event&;
+    using iterator_category = std::forward_iterator_tag;
+    explicit        const_iterator (const ChunkP *chunk = nullptr, size_t index = 0) : chunk_ (chunk), index_ (index) {}
+    reference       operator*      () const { return (**chunk_)[index_]; }
+    pointer         operator->     () const { return &(**chunk_)[index_]; }
+    bool            operator==     (const const_iterator &o) const { return chunk_ == o.chunk_ && index_ == o.index_; }
+    const_iterator& operator++     () { if (++index_ >= (*chunk_)->size()) { ++chunk_; index_ = 0; } return *this; }
+    const_iterator  operator++     (int) { const_iterator copy (*this); ++*this; return copy; }
+  };
+  explicit       ChunkedEventList (const Compare &c = {}) : compare_ (c) {}
+  bool           insert      (const Event &event, Event *replaced = nullptr); ///< Insert or replace `event`, returns true if replaced.
+  bool           remove      (const Event &event, Event *removed = nullptr);  ///< Return true if `event` was removed.
+  const Event*   lookup      (const Event &event) const; ///< Return pointer to matching `event` or nullptr.
+  const_iterator lower_bound (const Event &event) const; ///< Return iterator to the first element >= `event`.
+  const_iterator begin       () const   { return const_iterator (chunks_.data()); }
+  const_iterator end         () const   { return const_iterator (chunks_.data() + chunks_.size()); }
+  size_t         size        () const   { return size_; }
+  bool           empty       () const   { return size_ == 0; }
+  void           clear       ()         { chunks_.clear(); size_ = 0; }
+  std::vector<Event> copy    () const   { return std::vector<Event> (begin(), end()); }
+};
+
 // == Implementation Details ==
 template<class Event, class Compare> inline
 EventList<Event,Compare>::EventList (const Notify &n, const Compare &c) :
@@ -218,6 +264,109 @@ OrderedEventList<Event,CompareOrder>::lookup_after (const Event &event) const
   return it != this->end() ? &*it : nullptr;
 }
 
+// Find index of the first chunk with `back() >= event` or chunks_.size()
+template<class Event, class Compare> inline size_t
+ChunkedEventList<Event,Compare>::find_chunk (const Event &event) const
+{
+  size_t lo = 0, hi = chunks_.size();
+  while (lo < hi)
+    {
+      const size_t m = (lo + hi) >> 1;
+      if (compare_ (chunks_[m]->back(), event) < 0)
+        lo = m + 1;
+      else
+        hi = m;
+    }
+  return lo;
+}
+
+// Provide chunk `c` for modifications, copy it if it is shared with a snapshot
+template<class Event, class Compare> inline typename ChunkedEventList<Event,Compare>::Chunk&
+ChunkedEventList<Event,Compare>::writable (size_t c)
+{
+  if (chunks_[c].use_count() > 1)
+    chunks_[c] = std::make_shared<Chunk> (*chunks_[c]);
+  return *chunks_[c];
+}
+
+template<class Event, class Compare> inline bool
+ChunkedEventList<Event,Compare>::insert (const Event &event, Event *replaced)
+{
+  if (chunks_.empty())
+    {
+      chunks_.push_back (std::make_shared<Chunk> (1, event));
+      size_ = 1;
+      return false;
+    }
+  const size_t c = std::min (find_chunk (event), chunks_.size() - 1);
+  Chunk &chunk = writable (c);
+  auto insmatch = Aux::binary_lookup_insertion_pos (chunk.begin(), chunk.end(), compare_, event);
+  if (insmatch.second == true)  // exact match
+    {
+      if (replaced)
+        *replaced = *insmatch.first;
+      *insmatch.first = event;
+      return true;
+    }
+  chunk.insert (insmatch.first, event);
+  size_ += 1;
+  if (chunk.size() >= 2 * CHUNK_SIZE)
+    {
+      ChunkP tail = std::make_shared<Chunk> (chunk.begin() + CHUNK_SIZE, chunk.end());
+      chunk.erase (chunk.begin() + CHUNK_SIZE, chunk.end());
+      chunks_.insert (chunks_.begin() + c + 1, tail);
+    }
+  return false;
+}
+
+template<class Event, class Compare> inline bool
+ChunkedEventList<Event,Compare>::remove (const Event &event, Event *removed)
+{
+  const size_t c = find_chunk (event);
+  if (c >= chunks_.size())
+    return false;
+  const Chunk &cchunk = *chunks_[c];
+  auto it = Aux::binary_lookup (cchunk.begin(), cchunk.end(), compare_, event);
+  if (it == cchunk.end())
+    return false;
+  const size_t index = it - cchunk.begin();
+  if (removed)
+    *removed = *it;
+  Chunk &chunk = writable (c);
+  chunk.erase (chunk.begin() + index);
+  size_ -= 1;
+  if (chunk.empty())
+    chunks_.erase (chunks_.begin() + c);
+  else if (c + 1 < chunks_.size() && chunk.size() + chunks_[c + 1]->size() <= CHUNK_SIZE)
+    { // merge small neighbours
+      chunk.insert (chunk.end(), chunks_[c + 1]->begin(), chunks_[c + 1]->end());
+      chunks_.erase (chunks_.begin() + c + 1);
+    }
+  return true;
+}
+
+template<class Event, class Compare> inline const Event*
+ChunkedEventList<Event,Compare>::lookup (const Event &event) const
+{
+  const size_t c = find_chunk (event);
+  if (c >= chunks_.size())
+    return nullptr;
+  const Chunk &chunk = *chunks_[c];
+  auto it = Aux::binary_lookup (chunk.begin(), chunk.end(), compare_, event);
+  return it != chunk.end() ? &*it : nullptr;
+}
+
+template<class Event, class Compare> inline typename ChunkedEventList<Event,Compare>::const_iterator
+ChunkedEventList<Event,Compare>::lower_bound (const Event &event) const
+{
+  const size_t c = find_chunk (event);
+  if (c >= chunks_.size())
+    return end();
+  const Chunk &chunk = *chunks_[c];
+  auto it = Aux::binary_lookup_insertion_pos (chunk.begin(), chunk.end(), compare_, event).first;
+  return const_iterator (chunks_.data() + c, it - chunk.begin()); // it != end, since back() >= event
+}
+
 } // Ase
 
 #endif // __ASE_EVENTLIST_HH__
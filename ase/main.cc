@@ -9,6 +9,8 @@
 #include "project.hh"
 #include "loft.hh"
 #include "compress.hh"
+#include "rtcheck.hh"
+#include "denormals.hh"
 #include "internal.hh"
 #include "testing.hh"
 
@@ -88,6 +90,46 @@ main_rt_jobs_process()
 }
 
 // == MainConfig and arguments ==
+/// Report offline rendering speed once autostop exits the program.
+static void
+freewheel_report_start ()
+{
+  static uint64 freewheel_start = 0;
+  static std::function<void()> freewheel_report = [] () {
+    const double elapsed = (timestamp_realtime() - freewheel_start) * 0.000001;
+    printout ("%s: rendered %.3f seconds in %.3f seconds, realtime factor: %.2f\n", main_config.outputfile,
+              main_config.play_autostop, elapsed, main_config.play_autostop / std::max (elapsed, 0.000001));
+  };
+  freewheel_start = timestamp_realtime();
+  atquit_add (&freewheel_report);
+}
+
+/// Enable realtime safety checks of the render path and summarize violations at exit.
+static void
+check_rt_start ()
+{
+  static std::function<void()> check_rt_report = [] () {
+    const uint64 n = RtCheck::n_violations();
+    if (n)
+      warning ("%s: detected %u realtime violations during rendering", "--check-rt", n);
+  };
+  RtCheck::enable (true);
+  atquit_add (&check_rt_report);
+}
+
+/// Disable denormal flushing during rendering and report processors that output denormals.
+static void
+check_denormals_start ()
+{
+  static std::function<void()> check_denormals_report = [] () {
+    const uint64 n = Denormals::n_denormals();
+    if (n)
+      warning ("%s: detected %u denormal samples in processor outputs", "--check-denormals", n);
+  };
+  Denormals::enable_check (true);
+  atquit_add (&check_denormals_report);
+}
+
 static void
 print_usage (bool help)
 {
@@ -99,6 +141,8 @@ print_usage (bool help)
     }
   printout ("Usage: %s [OPTIONS] [project.anklang]\n", executable_name());
   printout ("  --check          Run integrity tests\n");
+  printout ("  --check-denormals Report processors with denormal output\n");
+  printout ("  --check-rt       Report allocations and locks during rendering\n");
   printout ("  --class-tree     Print exported class tree\n");
   printout ("  --disable-randomization Test mode for deterministic tests\n");
   printout ("  --embed <fd>     Parent process socket for embedding\n");
@@ -111,6 +155,7 @@ print_usage (bool help)
   printout ("  -o wavfile       Capture output to OPUS/FLAC/WAV file\n");
   printout ("  --play-autostart Automatically start playback of `project.anklang`\n");
   printout ("  --rand64         Produce 64bit random numbers on stdout\n");
+  printout ("  --render <file>  Render `project.anklang` to OPUS/FLAC/WAV file (needs -t)\n");
   printout ("  -t <time>        Automatically play and stop after <time> has passed\n"); // -t <time>[{,|;}tailtime]
   printout ("  --version        Print program version\n");
 }
@@ -155,6 +200,10 @@ parse_args (int *argcp, char **argv)
               fwrite (buffer, sizeof (buffer[0]), N, stdout);
             }
         }
+      else if (strcmp ("--check-rt", argv[i]) == 0)
+        config.check_rt = true;
+      else if (strcmp ("--check-denormals", argv[i]) == 0)
+        config.check_denormals = true;
       else if (strcmp ("--check", argv[i]) == 0)
         {
           config.mode = MainConfig::CHECK_INTEGRITY_TESTS;
@@ -201,6 +250,13 @@ parse_args (int *argcp, char **argv)
           argv[i++] = nullptr;
           config.outputfile = argv[i];
         }
+      else if (argv[i] == String ("--render") && i + 1 < size_t (argc))
+        {
+          argv[i++] = nullptr;
+          config.outputfile = argv[i];
+          config.freewheel = true;
+          config.play_autostart = true;
+        }
       else if (argv[i] == String ("--play-autostart"))
         {
           config.play_autostart = true;
@@ -231,6 +287,8 @@ parse_args (int *argcp, char **argv)
           }
       *argcp = e;
     }
+  if (config.freewheel && config.play_autostop >= D64MAX)
+    fatal_error ("missing render duration, use: --render %s -t <time>", config.outputfile);
   // load preferences unless --norc was given
   if (!norc)
     Preference::load_preferences (true);
@@ -465,6 +523,10 @@ main (int argc, char *argv[])
   AudioEngine &audio_engine = make_audio_engine (main_loop_wakeup, 48000, SpeakerArrangement::STEREO);
   main_config_.engine = &audio_engine;
   audio_engine.start_threads ();
+  if (config.check_rt)
+    check_rt_start();
+  if (config.check_denormals)
+    check_denormals_start();
   /*const uint loopdispatcherid =*/
   main_loop->exec_dispatcher ([&audio_engine] (const LoopState &state) -> bool {
     switch (state.phase)
@@ -505,7 +567,7 @@ main (int argc, char *argv[])
   const int xport = embedding_fd >= 0 ? 0 : 1777;
   const String subprotocol = xport ? "" : make_auth_string();
   jsonapi_require_auth (subprotocol);
-  if (main_config.mode == MainConfig::SYNTHENGINE)
+  if (main_config.mode == MainConfig::SYNTHENGINE && !config.freewheel)
     wss->listen ("127.0.0.1", xport, [] () { main_loop->quit (-1); });
   const String url = wss->url() + (subprotocol.empty() ? "" : "?subprotocol=" + subprotocol);
   if (embedding_fd < 0 && !url.empty())
@@ -562,7 +624,16 @@ main (int argc, char *argv[])
 
   // start auto play
   if (config.play_autostart && preload_project)
-    main_loop->exec_idle ([preload_project] () { preload_project->start_playback (config.play_autostop); });
+    main_loop->exec_idle ([preload_project] () {
+      preload_project->start_playback (config.play_autostop);
+      if (config.freewheel)
+        {
+          freewheel_report_start();
+          config.engine->async_jobs += [] () { config.engine->set_freewheel (true); }; // queued after playback start
+        }
+    });
+  else if (config.freewheel)
+    fatal_error ("%s: no project to render", config.outputfile);
 
   // run main event loop and catch SIGUSR2
   const int exitcode = main_loop->run();
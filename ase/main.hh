@@ -22,6 +22,9 @@ struct MainConfig {
   bool   allow_randomization = true;
   bool   list_drivers = false;
   bool   play_autostart = false;
+  bool   freewheel = false;
+  bool   check_rt = false;
+  bool   check_denormals = false;
   double play_autostop = D64MAX;
   enum ModeT { SYNTHENGINE, CHECK_INTEGRITY_TESTS };
   ModeT  mode = SYNTHENGINE;
@@ -2,6 +2,7 @@
 #include "ase/midievent.hh"
 #include "internal.hh"
 #include "sortnet.hh"
+#include "testing.hh"
 
 #define EDEBUG(...)     Ase::debug ("event", __VA_ARGS__)
 
@@ -173,10 +174,124 @@ make_param_value (uint param, double pvalue)
   return ev;
 }
 
+// == MidiEventArena ==
+MidiEventArena::MidiEventArena (size_t capacity) :
+  capacity_ (capacity), events_ (new MidiEvent[capacity])
+{}
+
+/// Allocate `n` consecutive events for the current block, returns NULL if exhausted [MT-Safe, RT-Safe].
+MidiEvent*
+MidiEventArena::allocate (size_t n)
+{
+  const size_t offset = used_.fetch_add (n, std::memory_order_relaxed);
+  if (ASE_UNLIKELY (offset + n > capacity_))
+    {
+      n_exhausted_.fetch_add (1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  return &events_[offset];
+}
+
+/// Grow `block` from `n_old` to `n_new` events if it is the last allocation [MT-Safe, RT-Safe].
+bool
+MidiEventArena::extend (MidiEvent *block, size_t n_old, size_t n_new)
+{
+  const size_t offset = block - &events_[0];
+  size_t expected = offset + n_old;
+  return_unless (offset + n_new <= capacity_, false);
+  return used_.compare_exchange_strong (expected, offset + n_new, std::memory_order_relaxed);
+}
+
+/// Release all events after a block has been rendered, invalidates all MidiEventOutput contents.
+void
+MidiEventArena::reset ()
+{
+  last_block_ = std::min (used_.load (std::memory_order_relaxed), capacity_);
+  high_water_ = std::max (high_water_, last_block_);
+  n_blocks_ += 1;
+  used_.store (0, std::memory_order_relaxed);
+  generation_.fetch_add (1, std::memory_order_release);
+}
+
+/// Retrieve allocation statistics, needs the engine thread.
+MidiEventArena::Stats
+MidiEventArena::stats () const
+{
+  Stats s;
+  s.capacity = capacity_;
+  s.high_water = high_water_;
+  s.last_block = last_block_;
+  s.n_blocks = n_blocks_;
+  s.n_exhausted = n_exhausted_;
+  s.n_heap = n_heap_;
+  return s;
+}
+
 // == MidiEventOutput ==
 MidiEventOutput::MidiEventOutput ()
 {}
 
+/// Allocate events from `arena`, or from the heap if NULL.
+void
+MidiEventOutput::arena (MidiEventArena *arena)
+{
+  arena_ = arena;
+  events_ = nullptr;
+  size_ = capacity_ = 0;
+  unsorted_ = ~0u;
+  generation_ = 0;
+}
+
+/// Guarantee capacity for `n` events in every block, allocated at the first append.
+void
+MidiEventOutput::reserve (size_t n)
+{
+  min_capacity_ = std::max (size_t (min_capacity_), n);
+  if (!arena_)
+    grow();
+}
+
+void
+MidiEventOutput::grow ()
+{
+  if (!current())
+    {                                           // events of a previous block are gone
+      events_ = nullptr;
+      size_ = capacity_ = 0;
+      unsorted_ = ~0u;
+      generation_ = arena_->generation();
+    }
+  const uint32 n_new = std::max (min_capacity_, capacity_ * 2);
+  if (arena_)
+    {
+      const bool on_heap = events_ && events_ == heap_.data();
+      if (events_ && !on_heap && arena_->extend (events_, capacity_, n_new))
+        {
+          capacity_ = n_new;
+          return;
+        }
+      MidiEvent *block = arena_->allocate (n_new);
+      if (ASE_ISLIKELY (block))
+        {
+          std::copy (events_, events_ + size_, block);
+          events_ = block;
+          capacity_ = n_new;
+          return;
+        }
+      arena_->note_heap();
+    }
+  // heap fallback, unavoidably allocates
+  if (events_ != heap_.data())
+    {
+      heap_.resize (std::max (size_t (n_new), heap_.size()));
+      std::copy (events_, events_ + size_, heap_.data());
+    }
+  else if (heap_.size() < n_new)
+    heap_.resize (n_new);
+  events_ = heap_.data();
+  capacity_ = heap_.size();
+}
+
 /// Append an MidiEvent with conscutive `frame` time stamp.
 void
 MidiEventOutput::append (int16_t frame, const MidiEvent &event)
@@ -185,34 +300,77 @@ MidiEventOutput::append (int16_t frame, const MidiEvent &event)
   assert_return (!out_of_order_event);
 }
 
-/// Dangerous! Append a MidiEvent while ignoring sort order, violates constraints.
-/// Returns if ensure_order() must be called due to adding an out-of-order event.
-bool
-MidiEventOutput::append_unsorted (int16_t frame, const MidiEvent &event)
-{
-  // we discard timing information by ignoring negative frame offsets here (#26)
-  // when we implement recording, we might want to preserve the exact timestamp
-  frame = std::max<int16_t> (frame, 0);
-  const int64_t last_event_stamp = !events_.empty() ? events_.back().frame : 0;
-  events_.push_back (event);
-  events_.back().frame = frame;
-  return frame < last_event_stamp;
-}
-
 /// Fix event order after append_unsorted() returned `true`.
 void
 MidiEventOutput::ensure_order ()
 {
-  fixed_sort (events_.begin(), events_.end(), [] (const MidiEvent &a, const MidiEvent &b) -> bool {
-    return a.frame < b.frame;
-  });
+  const size_t n = size();
+  return_unless (unsorted_ < n);
+  // the prefix before unsorted_ is in order, insertion sort is stable and cheap for a few stragglers
+  if (n - unsorted_ <= 16)
+    for (size_t i = unsorted_; i < n; i++)
+      {
+        const MidiEvent ev = events_[i];
+        size_t j = i;
+        for (; j > 0 && events_[j - 1].frame > ev.frame; j--)
+          events_[j] = events_[j - 1];
+        events_[j] = ev;
+      }
+  else
+    fixed_sort (events_, events_ + n, [] (const MidiEvent &a, const MidiEvent &b) -> bool {
+      return a.frame < b.frame;
+    });
+  unsorted_ = ~0u;
 }
 
 /// Fetch the latest event stamp, can be used to enforce order.
 int64_t
 MidiEventOutput::last_frame () const
 {
-  return !events_.empty() ? events_.back().frame : 0;
+  return !empty() ? events_[size_ - 1].frame : 0;
 }
 
 } // Ase
+
+namespace { // Anon
+using namespace Ase;
+
+TEST_INTEGRITY (midi_event_output_tests);
+static void
+midi_event_output_tests()
+{
+  MidiEventArena arena (256);
+  MidiEventOutput out1, out2;
+  out1.arena (&arena);
+  out2.arena (&arena);
+  out1.reserve (8);
+  out2.reserve (8);
+  // interleaved growth, out1 must move while out2 extends in place
+  for (uint i = 0; i < 40; i++)
+    {
+      out1.append (i, make_note_on (0, 60, 1.0));
+      out2.append (i, make_note_off (0, 60, 1.0));
+    }
+  TASSERT (out1.size() == 40 && out2.size() == 40);
+  for (uint i = 0; i < 40; i++)
+    TASSERT ((out1.begin() + i)->frame == i && (out2.begin() + i)->type == MidiEvent::NOTE_OFF);
+  // out-of-order appends
+  bool must_sort = out1.append_unsorted (3, make_program (0, 1));
+  must_sort |= out1.append_unsorted (1, make_program (0, 2));
+  TASSERT (must_sort == true);
+  out1.ensure_order();
+  for (const MidiEvent *ev = out1.begin() + 1; ev < out1.end(); ev++)
+    TASSERT (ev[-1].frame <= ev->frame);
+  // exhaustion falls back to the heap
+  for (uint i = 0; i < 300; i++)
+    out2.append (40 + i, make_note_on (0, 61, 1.0));
+  TASSERT (out2.size() == 340 && arena.stats().n_heap > 0);
+  // reset invalidates all outputs
+  arena.reset();
+  TASSERT (out1.empty() && out2.empty());
+  out1.append (7, make_note_on (0, 62, 1.0));
+  TASSERT (out1.size() == 1 && out1.last_frame() == 7);
+  TASSERT (arena.stats().high_water == 256);
+}
+
+} // Anon
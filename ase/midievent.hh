@@ -5,6 +5,7 @@
 #include <ase/memory.hh>
 #include <ase/queuemux.hh>
 #include <ase/mathutils.hh>
+#include <atomic>
 
 namespace Ase {
 
@@ -92,46 +93,121 @@ MidiEvent make_program     (uint16 chnl, uint prgrm);
 MidiEvent make_pitch_bend  (uint16 chnl, float val);
 MidiEvent make_param_value (uint param, double pvalue);
 
+/// Per-block bump allocator for MidiEvent structures, reset by the engine after each block.
+class MidiEventArena {
+  const size_t                 capacity_ = 0;
+  std::unique_ptr<MidiEvent[]> events_;
+  alignas (64) std::atomic<size_t> used_ = 0;
+  std::atomic<uint64>          generation_ = 1;
+  std::atomic<uint64>          n_exhausted_ = 0, n_heap_ = 0;
+  size_t                       high_water_ = 0, last_block_ = 0;
+  uint64                       n_blocks_ = 0;
+  ASE_CLASS_NON_COPYABLE (MidiEventArena);
+public:
+  struct Stats {
+    size_t capacity = 0;        ///< Number of MidiEvent slots per block.
+    size_t high_water = 0;      ///< Maximum number of slots used in a single block.
+    size_t last_block = 0;      ///< Number of slots used in the last block.
+    uint64 n_blocks = 0;        ///< Number of blocks rendered.
+    uint64 n_exhausted = 0;     ///< Number of failed allocations.
+    uint64 n_heap = 0;          ///< Number of heap allocations by MidiEventOutput after arena exhaustion.
+  };
+  explicit   MidiEventArena (size_t capacity);
+  MidiEvent* allocate       (size_t n);
+  bool       extend         (MidiEvent *block, size_t n_old, size_t n_new);
+  void       reset          ();
+  Stats      stats          () const;
+  void       note_heap      ()          { n_heap_.fetch_add (1, std::memory_order_relaxed); }
+  uint64     generation     () const    { return generation_.load (std::memory_order_relaxed); }
+};
+
+/// Read-only view of a sorted MidiEvent sequence.
+struct MidiEventRange {
+  const MidiEvent *first = nullptr, *last = nullptr;
+  /*ctor*/         MidiEventRange () = default;
+  /*ctor*/         MidiEventRange (const MidiEvent *b, const MidiEvent *e) : first (b), last (e) {}
+  /*ctor*/         MidiEventRange (const std::vector<MidiEvent> &v) : first (v.data()), last (v.data() + v.size()) {}
+  const MidiEvent* begin          () const noexcept { return first; }
+  const MidiEvent* end            () const noexcept { return last; }
+  size_t           size           () const noexcept { return last - first; }
+};
+
 /// A stream of writable MidiEvent structures.
+/// Events are allocated from the engine MidiEventArena and are valid for the current block only.
 class MidiEventOutput {
-  std::vector<MidiEvent> events_; // TODO: use O(1) allocator
+  MidiEvent      *events_ = nullptr;
+  uint32          size_ = 0, capacity_ = 0;
+  uint32          min_capacity_ = 64;       // guaranteed first allocation per block
+  uint32          unsorted_ = ~0u;          // index of first out-of-order event
+  uint64          generation_ = 0;
+  MidiEventArena *arena_ = nullptr;
+  std::vector<MidiEvent> heap_;             // used without arena or after arena exhaustion
+  bool             current         () const noexcept { return !arena_ || generation_ == arena_->generation(); }
+  void             grow            ();
 public:
   explicit         MidiEventOutput ();
   void             append          (int16_t frame, const MidiEvent &event);
-  const MidiEvent* begin           () const noexcept { return &*events_.begin(); }
-  const MidiEvent* end             () const noexcept { return &*events_.end(); }
-  size_t           size            () const noexcept { return events_.size(); }
-  bool             empty           () const noexcept { return events_.empty(); }
-  void             clear           () noexcept       { events_.clear(); }
+  const MidiEvent* begin           () const noexcept { return events_; }
+  const MidiEvent* end             () const noexcept { return events_ + size(); }
+  size_t           size            () const noexcept { return ASE_ISLIKELY (current()) ? size_ : 0; }
+  bool             empty           () const noexcept { return size() == 0; }
+  void             clear           () noexcept       { size_ = 0; unsorted_ = ~0u; }
   bool             append_unsorted (int16_t frame, const MidiEvent &event);
   void             ensure_order    ();
   int64_t          last_frame      () const ASE_PURE;
-  size_t           capacity        () const noexcept    { return events_.capacity(); }
-  void             reserve         (size_t n)           { events_.reserve (n); }
-  std::vector<MidiEvent>
-  const&           vector          () { return events_; }
+  size_t           capacity        () const noexcept { return current() ? capacity_ : 0; }
+  void             reserve         (size_t n);
+  void             arena           (MidiEventArena *arena);
+  MidiEventRange   range           () const noexcept { return { begin(), end() }; }
 };
 
-/// An in-order MidiEvent reader for multiple MidiEvent sources.
+/// An in-order MidiEvent reader that merges up to MAXQUEUES MidiEvent sources.
+/// A few sources are merged by a linear scan, many sources are k-way merged with O(log k) per event.
 template<size_t MAXQUEUES>
-class MidiEventReader : QueueMultiplexer<MAXQUEUES,std::vector<MidiEvent>::const_iterator> {
-  using Base = QueueMultiplexer<MAXQUEUES,std::vector<MidiEvent>::const_iterator>;
+class MidiEventReader : std::conditional_t<(MAXQUEUES <= 8),
+                                           QueueMultiplexer<MAXQUEUES,const MidiEvent*>,
+                                           QueueMerger<MAXQUEUES,const MidiEvent*>> {
+  using Base = std::conditional_t<(MAXQUEUES <= 8),
+                                  QueueMultiplexer<MAXQUEUES,const MidiEvent*>,
+                                  QueueMerger<MAXQUEUES,const MidiEvent*>>;
   ASE_CLASS_NON_COPYABLE (MidiEventReader);
 public:
   using iterator = typename Base::iterator;
   using Base::assign;
+  using Base::clear;
+  bool     add             (const MidiEventRange &range) { return this->Base::add (range.begin(), range.end()); }
   size_t   events_pending  () const { return this->count_pending(); }
   iterator begin           ()       { return this->Base::begin(); }
   iterator end             ()       { return this->Base::end(); }
-  using VectorArray = std::array<const std::vector<MidiEvent>*, MAXQUEUES>;
-  /*ctor*/ MidiEventReader (const VectorArray &midi_event_vector_array = VectorArray());
+  using RangeArray = std::array<const MidiEventRange*, MAXQUEUES>;
+  /*ctor*/ MidiEventReader (const RangeArray &midi_event_range_array = RangeArray());
 };
 
 // == MidiEventReader ==
 template<size_t MAXQUEUES>
-MidiEventReader<MAXQUEUES>::MidiEventReader (const VectorArray &midi_event_vector_array)
+MidiEventReader<MAXQUEUES>::MidiEventReader (const RangeArray &midi_event_range_array)
+{
+  assign (midi_event_range_array);
+}
+
+/// Append a MidiEvent, the fast path for events in order does not branch into allocations.
+inline bool
+MidiEventOutput::append_unsorted (int16_t frame, const MidiEvent &event)
 {
-  assign (midi_event_vector_array);
+  // we discard timing information by ignoring negative frame offsets here (#26)
+  // when we implement recording, we might want to preserve the exact timestamp
+  frame = std::max<int16_t> (frame, 0);
+  if (ASE_UNLIKELY (size_ >= capacity_ || !current()))
+    grow();
+  const int64_t last_event_stamp = size_ ? events_[size_ - 1].frame : 0;
+  MidiEvent &ev = events_[size_];
+  ev = event;
+  ev.frame = frame;
+  const bool out_of_order = frame < last_event_stamp;
+  if (ASE_UNLIKELY (out_of_order) && unsorted_ > size_)
+    unsorted_ = size_;
+  size_++;
+  return out_of_order;
 }
 
 inline int
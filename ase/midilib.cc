@@ -14,19 +14,46 @@ struct TickEvent {
   int64_t tick;
   MidiEvent event;
 };
-template<ssize_t DIR>
-struct CmpTickEvents {
-  int64_t
-  operator() (const TickEvent &a, const TickEvent &b) const
+/// Fixed capacity min-heap of future events, ordered by tick.
+class FutureEvents {
+  std::vector<TickEvent> heap_;
+  size_t                 capacity_ = 0;
+  static bool later (const TickEvent &a, const TickEvent &b) { return a.tick > b.tick; }
+public:
+  explicit FutureEvents (size_t capacity) : capacity_ (std::max (size_t (1), capacity)) { heap_.reserve (capacity_); }
+  bool             empty () const       { return heap_.empty(); }
+  bool             full  () const       { return heap_.size() >= capacity_; }
+  size_t           size  () const       { return heap_.size(); }
+  const TickEvent& top   () const       { return heap_.front(); }
+  auto             begin () const       { return heap_.begin(); }
+  auto             end   () const       { return heap_.end(); }
+  void             clear ()             { heap_.clear(); }
+  void
+  push (const TickEvent &tevent)        // needs !full()
+  {
+    heap_.push_back (tevent);
+    std::push_heap (heap_.begin(), heap_.end(), later);
+  }
+  TickEvent
+  pop ()                                // needs !empty()
   {
-    if (DIR > 0)
-      return int64_t (a.tick) - int64_t (b.tick);
-    else
-      return int64_t (b.tick) - int64_t (a.tick);
+    std::pop_heap (heap_.begin(), heap_.end(), later);
+    const TickEvent tevent = heap_.back();
+    heap_.pop_back();
+    return tevent;
   }
 };
-// static const CmpTickEvents<+1> forward_cmp_ticks;
-static const CmpTickEvents<-1> backward_cmp_ticks;
+
+/// Maximum number of pending NOTE_OFF events per MidiProducer, configurable via $ASE_DEBUG=midi-future-max=N.
+static size_t
+future_events_max ()
+{
+  static const size_t max_events = [] () {
+    const int64 n = string_to_int (debug_key_value ("midi-future-max"));
+    return n > 0 ? size_t (n) : size_t (1024);
+  } ();
+  return max_events;
+}
 
 // == MidiProducerImpl ==
 class MidiProducerImpl : public MidiProducerIface {
@@ -35,15 +62,15 @@ class MidiProducerImpl : public MidiProducerIface {
   Position *position_ = nullptr;
   int64 generator_start_ = -1;
   bool must_flush = false;
-  std::vector<TickEvent> future_stack; // newest events at back()
+  FutureEvents future_events_;          // pending NOTE_OFF events
+  uint64 future_overflows_ = 0;
   FastMemory::Block position_block_;
 public:
   MidiProducerImpl (const ProcessorSetup &psetup) :
-    MidiProducerIface (psetup)
+    MidiProducerIface (psetup), future_events_ (future_events_max())
   {
     position_block_ = SERVER->telemem_allocate (sizeof (Position));
     position_ = new (position_block_.block_start) Position {};
-    future_stack.reserve (64); // likely enough to avoid malloc
   }
   ~MidiProducerImpl()
   {
@@ -82,12 +109,23 @@ public:
       }
   }
   void
+  update_generator (size_t index, ClipGenerator &generator) override
+  {
+    return_unless (feed_ && index < feed_->generators.size());
+    ClipGenerator &current = feed_->generators[index];
+    const int64 last_play_position = current.play_position();
+    // swap generators so the old events are released in another thread
+    std::swap (current, generator);
+    if (position_->current == ssize_t (index))
+      current.jumpto (last_play_position);
+  }
+  void
   reset (uint64 target_stamp) override
   {
     position_->next = -1;
     position_->current = -1;
     position_->tick = -M52MAX;
-    future_stack.clear();
+    future_events_.clear();
     must_flush = false;
   }
   void
@@ -128,9 +166,8 @@ public:
     if (ASE_UNLIKELY (must_flush || bpm <= 0))
       {
         must_flush = false;
-        for (ssize_t i = future_stack.size() - 1; i >= 0; i--)
+        for (const TickEvent &tnote : future_events_)
           {
-            TickEvent tnote = future_stack[i];
             const int64 frame0 = 0;
             if (tnote.event.type == MidiEvent::NOTE_OFF)
               {
@@ -138,13 +175,12 @@ public:
                 MDEBUG ("FLUSH: t=%d ev=%s f=%d\n", tnote.tick, tnote.event.to_string(), frame0);
               }
           }
-        future_stack.resize (0);
+        future_events_.clear();
       }
     // enqueue pending NOTE_OFF events
-    while (future_stack.size() && future_stack.back().tick < end_tick)
+    while (!future_events_.empty() && future_events_.top().tick < end_tick)
       {
-        TickEvent tnote = future_stack.back();
-        future_stack.pop_back();
+        const TickEvent tnote = future_events_.pop();
         const int64 frame = transport.sample_from_tick (tnote.tick - begin_tick);
         assert_paranoid (frame >= 0 && frame <= 4095);
         MDEBUG ("POP: t=%d ev=%s f=%d\n", tnote.tick, tnote.event.to_string(), frame);
@@ -166,7 +202,7 @@ public:
                generator_start_ + feed_->generators[position_->current].play_position() < end_tick)
           {
             // handler for incoming events
-            auto qevent = [begin_tick, end_tick, &transport, &evout, this] (int64 cliptick, MidiEvent &event) {
+            auto qevent = [begin_tick, end_tick, n_frames, &transport, &evout, this] (int64 cliptick, MidiEvent &event) {
               const int64 etick = generator_start_ + cliptick; // Generator tick to Engine tick
               if (etick < end_tick)
                 {
@@ -178,8 +214,15 @@ public:
                 }
               else
                 {
-                  TickEvent future_event { etick, event };
-                  Aux::insert_sorted (future_stack, future_event, backward_cmp_ticks);
+                  if (ASE_UNLIKELY (future_events_.full()))
+                    {
+                      // overflow, deliver the earliest pending event at the end of this block
+                      const TickEvent early = future_events_.pop();
+                      evout.append_unsorted (n_frames - 1, early.event);
+                      future_overflows_++;
+                      MDEBUG ("OVERFLOW: t=%d ev=%s f=%d (%d)\n", early.tick, early.event.to_string(), n_frames - 1, future_overflows_);
+                    }
+                  future_events_.push ({ etick, event });
                   MDEBUG ("FUT: t=%d ev=%s f=%d\n", etick, event.to_string(), transport.sample_from_tick (etick - begin_tick));
                 }
             };
@@ -25,10 +25,11 @@ public:
     int    current = -1;
     double tick = -1;
   };
-  virtual void      update_feed (MidiFeedP &feed) = 0;
-  virtual Position* position    () const = 0; // MT-Safe
-  virtual void      start       () = 0;
-  virtual void      stop        (bool restart = false) = 0;
+  virtual void      update_feed      (MidiFeedP &feed) = 0;
+  virtual void      update_generator (size_t index, ClipImpl::Generator &generator) = 0;
+  virtual Position* position         () const = 0; // MT-Safe
+  virtual void      start            () = 0;
+  virtual void      stop             (bool restart = false) = 0;
   MidiProducerIface (const ProcessorSetup &psetup) : AudioProcessor (psetup) {}
 };
 
@@ -3,6 +3,7 @@
 #include "clapdevice.hh"
 #include "combo.hh"
 #include "project.hh"
+#include "track.hh"
 #include "jsonipc/jsonipc.hh"
 #include "serialize.hh"
 #include "internal.hh"
@@ -115,6 +116,8 @@ NativeDeviceImpl::remove_device (Device &sub)
   DeviceP childp = subp;
   assert_return (childp && nth >= 0);
   children_.erase (children_.begin() + nth);
+  if (TrackImpl *track = dynamic_cast<TrackImpl*> (_track()))
+    track->freeze_invalidate();
   AudioProcessorP sproc = childp->_audio_processor();
   if (sproc && combo_)
     {
@@ -140,6 +143,8 @@ NativeDeviceImpl::insert_device (const String &uri, Device *sibling, const Devic
     {
       devicep = create_processor_device (proc_->engine(), uri, false);
       return_unless (devicep, nullptr);
+      if (TrackImpl *track = dynamic_cast<TrackImpl*> (_track()))
+        track->freeze_invalidate();
       const ssize_t cpos = Aux::index_of (children_, [sibling] (const DeviceP &d) { return sibling == d.get(); });
       children_.insert (cpos < 0 ? children_.end() : children_.begin() + cpos, devicep);
       devicep->_set_parent (this);
@@ -2,9 +2,13 @@
 #include "processor.hh"
 #include "combo.hh"
 #include "device.hh"
+#include "track.hh"
 #include "main.hh"      // feature_toggle_find
 #include "utils.hh"
 #include "engine.hh"
+#include "server.hh"
+#include "rtcheck.hh"
+#include "denormals.hh"
 #include "internal.hh"
 #include <shared_mutex>
 
@@ -93,6 +97,123 @@ AudioParams::install (const AudioParams::Map &params)
   bits = new std::atomic<uint64_t>[u] ();       // a bit array causes vastly fewer cache misses
 }
 
+// == ParamQueue ==
+/** Lock-free single producer, single consumer ring for timestamped parameter changes.
+ * The main thread pushes changes, the engine thread converts them into frame accurate,
+ * sorted PARAM_VALUE events per block. A change supersedes older changes of the same
+ * parameter at the same or later stamps, so values are never applied out of order.
+ * Changes that find the ring full wait in order for flush(), keeping only the newest
+ * change per parameter. Engine thread memory is preallocated.
+ */
+struct AudioProcessor::ParamQueue {
+  struct Change {
+    uint64 stamp = 0;   // frame_counter() position
+    double value = 0;
+    uint32 id = 0;
+  };
+  static constexpr uint32 RING_SIZE = 128;              // power of 2
+  std::array<Change,RING_SIZE> ring_;
+  alignas (64) std::atomic<uint32> head_ = 0;           // read position, engine thread
+  alignas (64) std::atomic<uint32> tail_ = 0;           // write position, main thread
+  std::atomic<bool>            overflowed_ = false;     // overflow_ holds changes
+  std::vector<Change>          overflow_;               // changes waiting for ring space, main thread
+  std::array<Change,RING_SIZE> pending_;                // changes due after the current block
+  uint32                       n_pending_ = 0;
+  MidiEventVector              events_;                 // events of the current block
+  ParamQueue()
+  {
+    events_.reserve (2 * RING_SIZE); // n_pending_ + ring_ contents
+  }
+  /// Enqueue `change` [main-thread].
+  void
+  push (const Change &change)
+  {
+    if (flush() && try_push (change)) [[likely]]
+      return;
+    for (size_t i = 0; i < overflow_.size(); i++)
+      if (overflow_[i].id == change.id)
+        {
+          overflow_.erase (overflow_.begin() + i); // drop the older value
+          break;
+        }
+    overflow_.push_back (change);
+    overflowed_ = true;
+  }
+  /// Move waiting changes into the ring [main-thread], returns true if none are left.
+  bool
+  flush ()
+  {
+    return_unless (overflowed_.load (std::memory_order_relaxed), true);
+    size_t n = 0;
+    while (n < overflow_.size() && try_push (overflow_[n]))
+      n++;
+    overflow_.erase (overflow_.begin(), overflow_.begin() + n);
+    overflowed_ = !overflow_.empty();
+    return overflow_.empty();
+  }
+  /// Check if changes wait for flush() [engine-thread].
+  bool
+  overflowed () const
+  {
+    return overflowed_.load (std::memory_order_relaxed);
+  }
+  /// Collect the events for the block `[block_stamp,target_stamp)` [engine-thread].
+  const MidiEventVector*
+  fetch (uint64 block_stamp, uint64 target_stamp)
+  {
+    events_.clear();
+    const uint32 n_pending = n_pending_;
+    n_pending_ = 0;
+    for (uint32 i = 0; i < n_pending; i++)
+      place (pending_[i], block_stamp, target_stamp); // only compacts pending_
+    uint32 head = head_.load (std::memory_order_relaxed);
+    const uint32 tail = tail_.load (std::memory_order_acquire);
+    for (; head != tail && n_pending_ < RING_SIZE; head++)
+      place (ring_[head & (RING_SIZE - 1)], block_stamp, target_stamp);
+    head_.store (head, std::memory_order_release);
+    return events_.empty() ? nullptr : &events_;
+  }
+private:
+  bool
+  try_push (const Change &change)
+  {
+    const uint32 tail = tail_.load (std::memory_order_relaxed);
+    if (tail - head_.load (std::memory_order_acquire) >= RING_SIZE)
+      return false;
+    ring_[tail & (RING_SIZE - 1)] = change;
+    tail_.store (tail + 1, std::memory_order_release);
+    return true;
+  }
+  void
+  place (const Change &change, uint64 block_stamp, uint64 target_stamp)
+  {
+    // drop older changes of the same parameter that are due at or after `change`
+    uint32 n = 0;
+    for (uint32 i = 0; i < n_pending_; i++)
+      if (pending_[i].id != change.id || pending_[i].stamp < change.stamp)
+        pending_[n++] = pending_[i];
+    n_pending_ = n;
+    if (change.stamp >= target_stamp)
+      {
+        pending_[n_pending_++] = change;
+        return;
+      }
+    const uint frame = change.stamp > block_stamp ? change.stamp - block_stamp : 0;
+    n = 0;
+    for (uint32 i = 0; i < events_.size(); i++)
+      if (events_[i].param != change.id || events_[i].frame < frame)
+        events_[n++] = events_[i];
+    events_.erase (events_.begin() + n, events_.end());
+    // keep events_ sorted by frame
+    auto it = events_.end();
+    while (it != events_.begin() && (it - 1)->frame > frame)
+      --it;
+    MidiEvent ev = make_param_value (change.id, change.value);
+    ev.frame = frame;
+    events_.insert (it, ev); // within capacity, see constructor
+  }
+};
+
 // == AudioProcessor ==
 const String AudioProcessor::GUIONLY = ":G:r:w:";     ///< GUI READABLE WRITABLE
 const String AudioProcessor::STANDARD = ":G:S:r:w:";  ///< GUI STORAGE READABLE WRITABLE
@@ -115,6 +236,12 @@ AudioProcessor::~AudioProcessor ()
   MidiEventVector *t0events = nullptr;
   t0events = t0events_.exchange (t0events);
   delete t0events;
+  delete param_queue_.exchange (nullptr);
+  if (dsp_load_block_.block_start)
+    {
+      dsp_load_ = nullptr;
+      SERVER->telemem_release (dsp_load_block_);
+    }
 }
 
 /// Convert MIDI note to Hertz according to the current MusicalTuning.
@@ -213,6 +340,8 @@ AudioProcessor::install_params (const AudioParams::Map &params)
 {
   assert_return (this_thread_is_ase());
   params_.install (params);
+  if (!param_queue_ && params_.count)
+    param_queue_ = new ParamQueue();
   modify_t0events ([&] (std::vector<MidiEvent> &t0events) {
     for (size_t i = 0; i < params_.count; i++)
       t0events.push_back (make_param_value (params_.ids[i], params_.parameters[i]->initial().as_double()));
@@ -233,8 +362,11 @@ AudioProcessor::find_param (const String &identifier) const -> MaybeParamId
 }
 
 /// Set parameter `id` to `value` within `ParamInfo.get_minmax()`.
+/// The change is applied at engine frame_counter() position `stamp` for sample accurate
+/// automation, past stamps (e.g. 0) are applied at the start of the next render() block.
+/// A change supersedes earlier sent changes of `id` that are stamped at or after `stamp`.
 bool
-AudioProcessor::send_param (Id32 paramid, const double value)
+AudioProcessor::send_param (Id32 paramid, const double value, uint64 stamp)
 {
   assert_return (this_thread_is_ase(), false); // main_loop thread
   const ssize_t idx = params_.index (paramid.id);
@@ -244,15 +376,9 @@ AudioProcessor::send_param (Id32 paramid, const double value)
   double v = value;
   if (parameter)
     v = parameter->dconstrain (value);
-  modify_t0events ([&] (std::vector<MidiEvent> &t0events) {
-    for (auto &ev : t0events)
-      if (ev.type == MidiEvent::PARAM_VALUE &&
-          ev.param == params_.ids[idx]) {
-        ev.pvalue = v;
-        return; // re-assigned previous send_param event
-      }
-    t0events.push_back (make_param_value (params_.ids[idx], v));
-  });
+  ParamQueue *param_queue = param_queue_;
+  assert_return (param_queue, false); // created by install_params()
+  param_queue->push ({ stamp, v, params_.ids[idx] });
   return true;
 }
 
@@ -323,7 +449,7 @@ AudioProcessor::set_normalized (Id32 paramid, double normalized)
     normalized = 0;
   else if (!ASE_ISLIKELY (normalized <= 1.0))
     normalized = 1.0;
-  return send_param (paramid, value_from_normalized (paramid, normalized));
+  return send_param (paramid, value_from_normalized (paramid, normalized), engine_.frame_counter());
 }
 
 /** Format a parameter `paramid` value as text string.
@@ -469,6 +595,7 @@ AudioProcessor::prepare_event_output ()
     estreams_ = new EventStreams();
   assert_return (estreams_->has_event_output == false);
   estreams_->has_event_output = true;
+  estreams_->midi_event_output.arena (&engine_.midi_event_arena());
 }
 
 /// Disconnect event input if a connection is present.
@@ -765,6 +892,7 @@ AudioProcessor::reset_state (uint64 target_stamp)
     {
       if (estreams_)
         estreams_->midi_event_output.clear();
+      silent_frames_ = 0;
       reset (target_stamp);
       render_stamp_ = target_stamp;
     }
@@ -800,8 +928,91 @@ AudioProcessor::schedule_processor()
   return level + 1;
 }
 
+/// Schedule `iproc` as input dependency, `this` will only be rendered after `iproc`.
+uint
+AudioProcessor::schedule_processor (AudioProcessor &iproc)
+{
+  const uint level = iproc.schedule_processor();
+  engine_.schedule_depend (iproc, *this);
+  return level;
+}
+
+// == DspLoadStats ==
+static inline uint
+dsp_load_bucket (uint64 ns)
+{
+  const uint msb = 63 - __builtin_clzll (ns | 4);
+  return std::min (uint64 (127), (msb - 2) * 4 + ((ns >> (msb - 2)) & 3));
+}
+
+static inline uint64
+dsp_load_bucket_limit (uint bucket)
+{
+  const uint msb = bucket / 4 + 2, quarter = bucket & 3;
+  return (uint64 (4 + quarter + 1) << (msb - 2)) - 1;
+}
+
+/// Account a render duration, runs in the rendering thread.
+void
+AudioProcessor::DspLoadStats::record (uint64 ns)
+{
+  histogram[dsp_load_bucket (ns)] += 1;
+  sum_ns += ns;
+  load.blocks += 1;
+  load.last = ns * 0.001;
+  load.mean = sum_ns * 0.001 / load.blocks;
+  load.max = std::max (load.max, load.last);
+  if (ASE_UNLIKELY ((load.blocks & 63) == 0)) // update p99 every 64 blocks
+    {
+      uint64 total = 0;
+      for (uint i = 0; i < 128; i++)
+        total += histogram[i];
+      const uint64 tail = (total + 99) / 100;
+      uint64 count = 0;
+      for (int i = 127; i >= 0; i--)
+        {
+          count += histogram[i];
+          if (count >= tail)
+            {
+              load.p99 = std::min (dsp_load_bucket_limit (i) * 0.001, double (load.max));
+              break;
+            }
+        }
+      if (ASE_UNLIKELY ((load.blocks & 16383) == 0)) // let the histogram adapt
+        for (uint i = 0; i < 128; i++)
+          histogram[i] >>= 1;
+    }
+}
+
+/// Enable DSP load measurements and retrieve the statistics located in telemetry memory.
+AudioProcessor::DspLoadStats*
+AudioProcessor::dsp_load_stats ()
+{
+  assert_return (this_thread_is_ase(), nullptr); // main_loop thread
+  if (!dsp_load_block_.block_start)
+    {
+      dsp_load_block_ = SERVER->telemem_allocate (sizeof (DspLoadStats));
+      DspLoadStats *stats = new (dsp_load_block_.block_start) DspLoadStats{};
+      AudioProcessorP selfp = shared_from_this();
+      engine_.async_jobs += [selfp, stats] () { selfp->dsp_load_ = stats; };
+    }
+  return static_cast<DspLoadStats*> (dsp_load_block_.block_start);
+}
+
+/// Retrieve DSP load measurements, dsp_load_stats() must have been called to enable measurements.
+DspLoad
+AudioProcessor::dsp_load () const
+{
+  DspLoad load;
+  const DspLoadStats *stats = static_cast<const DspLoadStats*> (dsp_load_block_.block_start);
+  if (stats)
+    engine_.const_jobs += [&] () { load = stats->load; };
+  return load;
+}
+
 struct AudioProcessor::RenderContext {
-  MidiEventVector *render_events = nullptr;
+  MidiEventVector       *render_events = nullptr;
+  const MidiEventVector *param_events = nullptr;
 };
 
 /** Method called for every audio buffer to be processed.
@@ -822,12 +1033,45 @@ AudioProcessor::render_block (uint64 target_stamp)
 {
   return_unless (render_stamp_ < target_stamp);
   return_unless (target_stamp - render_stamp_ <= AUDIO_BLOCK_MAX_RENDER_SIZE);
+  RtCheck::Scope rtcheck_scope (this);
   RenderContext rc;
   if (ASE_UNLIKELY (estreams_))
     estreams_->midi_event_output.clear();
   rc.render_events = t0events_.exchange (rc.render_events); // fetch t0events_ for rendering
+  ParamQueue *const param_queue = param_queue_.load (std::memory_order_acquire);
+  if (param_queue)
+    {
+      rc.param_events = param_queue->fetch (render_stamp_, target_stamp);
+      if (ASE_UNLIKELY (param_queue->overflowed()))
+        enotify_enqueue_mt (PARAMCHANGE); // ring has space now, flush() in enotify_dispatch()
+    }
+  if (tail_frames_ >= 0 && !rc.render_events && !rc.param_events && inputs_silent())
+    {
+      const uint64 n_frames = target_stamp - render_stamp_;
+      if (silent_frames_ >= uint64 (tail_frames_))
+        {
+          // idle, skip render() and hand out shared zero blocks
+          silence_outputs();
+          render_stamp_ = target_stamp;
+          return;
+        }
+      silent_frames_ += n_frames;
+    }
+  else
+    silent_frames_ = 0;
   render_context_ = &rc;
+  DspLoadStats *const dsp_load = dsp_load_;
+  const uint64 t0 = ASE_UNLIKELY (dsp_load) ? timestamp_benchmark() : 0;
   render (target_stamp - render_stamp_);
+  if (ASE_UNLIKELY (dsp_load))
+    dsp_load->record (timestamp_benchmark() - t0);
+  if (ASE_UNLIKELY (Denormals::check_enabled_.load (std::memory_order_relaxed)))
+    for (size_t i = output_offset_; i < iobuses_.size(); i++)
+      {
+        const IOBus &obus = iobuses_[i];
+        for (size_t c = 0; c < obus.fbuffer_count; c++)
+          Denormals::scan_outputs (*this, fbuffers_[obus.fbuffer_index + c].buffer, target_stamp - render_stamp_);
+      }
   render_context_ = nullptr;
   render_stamp_ = target_stamp;
   if (rc.render_events) // delete in main_thread
@@ -838,16 +1082,76 @@ AudioProcessor::render_block (uint64 target_stamp)
   }
 }
 
+/// Check if all audio inputs carry silence and no MidiEvent input is pending.
+bool
+AudioProcessor::inputs_silent () const
+{
+  if (estreams_ && estreams_->oproc && estreams_->oproc->estreams_ &&
+      !estreams_->oproc->estreams_->midi_event_output.empty())
+    return false;
+  for (size_t i = 0; i < output_offset_; i++)
+    {
+      const IOBus &ibus = iobuses_[i];
+      if (!ibus.oproc)
+        continue;
+      const AudioProcessor &oproc = *ibus.oproc;
+      const IOBus &obus = oproc.iobus (ibus.obusid);
+      for (size_t c = 0; c < obus.fbuffer_count; c++)
+        if (!oproc.fbuffers_[obus.fbuffer_index + c].silent())
+          return false;
+    }
+  return true;
+}
+
+/// Redirect all output channels to the shared zero block.
+void
+AudioProcessor::silence_outputs ()
+{
+  for (size_t i = output_offset_; i < iobuses_.size(); i++)
+    {
+      const IOBus &obus = iobuses_[i];
+      for (size_t c = 0; c < obus.fbuffer_count; c++)
+        fbuffers_[obus.fbuffer_index + c].buffer = const_float_zeros;
+    }
+}
+
+/// Declare the number of frames that render() produces output after all inputs fell silent.
+/// Once all audio inputs are silent, no MidiEvent inputs are pending and `n_frames` have
+/// been rendered, the engine skips render() calls and redirects all outputs to zeros
+/// (see FloatBuffer::silent()), until new input arrives.
+/// A tail of 0 reports the processor as idle, -1 (the default) disables skipping.
+void
+AudioProcessor::set_tail (int64 n_frames)
+{
+  tail_frames_ = std::max (int64 (-1), n_frames);
+}
+
 /// Access the current MidiEvent inputs during render(), needs prepare_event_input().
 AudioProcessor::MidiEventInput
 AudioProcessor::midi_event_input()
 {
-  MidiEventInput::VectorArray mev_array{};
+  MidiEventRange ranges[MIDI_EVENT_INPUT_SOURCES];
+  MidiEventInput::RangeArray mev_array{};
+  static_assert (std::size (ranges) == std::tuple_size<MidiEventInput::RangeArray>::value);
   size_t n = 0;
   if (estreams_ && estreams_->oproc && estreams_->oproc->estreams_)
-    mev_array[n++] = &estreams_->oproc->estreams_->midi_event_output.vector();
+    {
+      ranges[n] = estreams_->oproc->estreams_->midi_event_output.range();
+      mev_array[n] = &ranges[n];
+      n++;
+    }
+  if (render_context_->param_events)
+    {
+      ranges[n] = *render_context_->param_events;
+      mev_array[n] = &ranges[n];
+      n++;
+    }
   if (render_context_->render_events)
-    mev_array[n++] = render_context_->render_events;
+    {
+      ranges[n] = *render_context_->render_events;
+      mev_array[n] = &ranges[n];
+      n++;
+    }
   return MidiEventInput (mev_array);
 }
 
@@ -991,7 +1295,9 @@ public:
       v = proc->param_value_from_text (id_, value.as_string());
     else
       v = value.as_double();
-    proc->send_param (id_, v);
+    proc->send_param (id_, v, proc->engine().frame_counter()); // applies with the next block, after older changes
+    if (TrackImpl *track = dynamic_cast<TrackImpl*> (device_->_track()))
+      track->freeze_invalidate();
     inflight_value_ = v;
     inflight_stamp_ = proc->engine().frame_counter();
     inflight_stamp_ += 2 * proc->engine().block_size(); // wait until after the *next* job queue has been processed
@@ -1108,6 +1414,9 @@ AudioProcessor::enotify_dispatch ()
       assert_warn (old_nqueue_next != nullptr);
       const uint32 nflags = NOTIFYMASK & current->flags_.fetch_and (~NOTIFYMASK);
       assert_warn (procp != nullptr);
+      if (nflags & PARAMCHANGE)
+        if (ParamQueue *param_queue = current->param_queue_)
+          param_queue->flush();
       DeviceP devicep = current->get_device();
       if (devicep)
         {
@@ -1150,3 +1459,73 @@ AudioProcessor::enotify_pending ()
 }
 
 } // Ase
+
+#include "testing.hh"
+
+namespace { // Anon
+using namespace Ase;
+
+TEST_INTEGRITY (dsp_load_tests);
+
+static void
+dsp_load_tests()
+{
+  for (uint64 ns = 1; ns < 1000000000; ns = ns * 5 / 4 + 1)
+    TASSERT (ns <= dsp_load_bucket_limit (dsp_load_bucket (ns)));
+  std::unique_ptr<AudioProcessor::DspLoadStats> stats = std::make_unique<AudioProcessor::DspLoadStats>();
+  for (uint i = 0; i < 6400; i++)
+    stats->record (i % 100 == 99 ? 500000 : 20000); // 1% of blocks take 500us
+  TCMP (stats->load.blocks, ==, 6400);
+  TCMP (stats->load.last, ==, 500);
+  TCMP (stats->load.max, ==, 500);
+  TASSERT (stats->load.mean > 24.7 && stats->load.mean < 24.9);
+  TASSERT (stats->load.p99 >= 500 * 0.8 && stats->load.p99 <= 500);
+}
+
+TEST_INTEGRITY (param_queue_tests);
+static void
+param_queue_tests()
+{
+  using ParamQueue = AudioProcessor::ParamQueue;
+  std::unique_ptr<ParamQueue> pq = std::make_unique<ParamQueue>();
+  auto check = [] (const std::vector<MidiEvent> *events, const std::vector<std::tuple<uint,uint32,double>> &expected) {
+    TCMP (events ? events->size() : 0, ==, expected.size());
+    for (size_t i = 0; events && i < events->size(); i++)
+      {
+        const auto [frame, id, value] = expected[i];
+        TASSERT ((*events)[i].type == MidiEvent::PARAM_VALUE);
+        TCMP ((*events)[i].frame, ==, frame);
+        TCMP ((*events)[i].param, ==, id);
+        TCMP ((*events)[i].pvalue, ==, value);
+      }
+  };
+  // stamped changes apply at their frame offset, sorted by frame
+  pq->push ({ 1005, 0.5, 1 });
+  pq->push ({ 1200, 0.75, 1 });         // due in the next block
+  pq->push ({ 1003, 0.25, 2 });
+  pq->push ({ 0, 0.125, 3 });           // past stamps apply at frame 0
+  check (pq->fetch (1000, 1128), { { 0, 3, 0.125 }, { 3, 2, 0.25 }, { 5, 1, 0.5 } });
+  check (pq->fetch (1128, 1256), { { 72, 1, 0.75 } });
+  check (pq->fetch (1256, 1384), {});
+  // newer changes supersede older ones at the same or later frames
+  pq->push ({ 2050, 0.5, 1 });
+  pq->push ({ 2010, 0.25, 1 });
+  pq->push ({ 2005, 0.5, 2 });
+  pq->push ({ 2020, 0.25, 2 });
+  check (pq->fetch (2000, 2128), { { 5, 2, 0.5 }, { 10, 1, 0.25 }, { 20, 2, 0.25 } });
+  pq->push ({ 3300, 0.5, 1 });          // pending
+  check (pq->fetch (3000, 3128), {});
+  pq->push ({ 3200, 0.25, 1 });         // supersedes the pending change
+  check (pq->fetch (3128, 3256), { { 72, 1, 0.25 } });
+  check (pq->fetch (3256, 3384), {});
+  // overflowing changes are kept in order, only the newest value per parameter
+  for (uint i = 0; i < ParamQueue::RING_SIZE + 10; i++)
+    pq->push ({ 0, double (i), 7 });
+  TASSERT (pq->overflowed());
+  check (pq->fetch (4000, 4128), { { 0, 7, ParamQueue::RING_SIZE - 1 } });
+  TASSERT (pq->flush() && !pq->overflowed());
+  check (pq->fetch (4128, 4256), { { 0, 7, ParamQueue::RING_SIZE + 9 } });
+  check (pq->fetch (4256, 4384), {});
+}
+
+} // Anon
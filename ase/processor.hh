@@ -77,6 +77,10 @@ class AudioProcessor : public std::enable_shared_from_this<AudioProcessor>, publ
   struct IOBus;
   struct EventStreams;
   struct RenderContext;
+public:
+  struct DspLoadStats;
+  struct ParamQueue;
+private:
   class FloatBuffer;
   friend class ProcessorManager;
   friend class DeviceImpl;
@@ -88,12 +92,15 @@ class AudioProcessor : public std::enable_shared_from_this<AudioProcessor>, publ
   };
   using OBRange = std::pair<FloatBuffer*,FloatBuffer*>;
   AudioProcessor          *sched_next_ = nullptr;
+  uint32                   sched_index_ = 0;
 protected:
 #ifndef DOXYGEN
   // Inherit `AudioSignal` concepts in derived classes from other namespaces
   using MinMax = std::pair<double,double>;
 #endif
-  using MidiEventInput = MidiEventReader<2>;
+  /// Event sources merged by midi_event_input(): MIDI output of the event source processor, parameter and render events.
+  static constexpr size_t MIDI_EVENT_INPUT_SOURCES = 3;
+  using MidiEventInput = MidiEventReader<MIDI_EVENT_INPUT_SOURCES>;
   enum { INITIALIZED   = 1 << 0,
          //            = 1 << 1,
          SCHEDULED     = 1 << 2,
@@ -114,10 +121,15 @@ private:
   EventStreams            *estreams_ = nullptr;
   AtomicBits              *atomic_bits_ = nullptr;
   uint64_t                 render_stamp_ = 0;
+  int64                    tail_frames_ = -1;        // frames to render after inputs fell silent, -1 for always
+  uint64                   silent_frames_ = 0;       // frames rendered since inputs fell silent
   using MidiEventVector = std::vector<MidiEvent>;
   using MidiEventVectorAP = std::atomic<MidiEventVector*>;
   MidiEventVectorAP        t0events_ = nullptr;
+  std::atomic<ParamQueue*> param_queue_ = nullptr;  // created by install_params()
   RenderContext           *render_context_ = nullptr;
+  DspLoadStats            *dsp_load_ = nullptr;      // engine thread, enables render timing
+  FastMemory::Block        dsp_load_block_;          // main thread
   std::vector<CString>     cstrings0_, cstrings1_;
   template<class F> void modify_t0events (const F&);
   void               assign_iobufs      ();
@@ -128,6 +140,8 @@ private:
   static
   const FloatBuffer& zero_buffer        ();
   void               render_block       (uint64 target_stamp);
+  bool               inputs_silent      () const;
+  void               silence_outputs    ();
   void               reset_state        (uint64 target_stamp);
   /*copy*/           AudioProcessor     (const AudioProcessor&) = delete;
   virtual void       render             (uint n_frames) = 0;
@@ -148,7 +162,7 @@ protected:
   uint          schedule_processor ();
   void          reschedule        ();
   virtual uint  schedule_children () { return 0; }
-  static uint   schedule_processor (AudioProcessor &p)  { return p.schedule_processor(); }
+  uint          schedule_processor (AudioProcessor &iproc);
   // Parameters
   void          install_params    (const AudioParams::Map &params);
   void          apply_event       (const MidiEvent &event);
@@ -172,6 +186,7 @@ protected:
   float*        oblock            (OBusId b, uint c);
   void          assign_oblock     (OBusId b, uint c, float val);
   void          redirect_oblock   (OBusId b, uint c, const float *block);
+  void          set_tail          (int64 n_frames);
   // event stream handling
   void             prepare_event_input  ();
   void             prepare_event_output ();
@@ -196,7 +211,7 @@ public:
   double                inyquist    () const ASE_CONST;
   // Parameters
   double              get_param             (Id32 paramid);
-  bool                send_param            (Id32 paramid, double value);
+  bool                send_param            (Id32 paramid, double value, uint64 stamp = 0);
   ParameterC          parameter             (Id32 paramid) const;
   MaybeParamId        find_param            (const String &identifier) const;
   MinMax              param_range           (Id32 paramid) const;
@@ -230,6 +245,9 @@ public:
   void          connect_event_input    (AudioProcessor &oproc);
   void          disconnect_event_input ();
   void          enable_engine_output   (bool onoff);
+  // DSP load
+  DspLoadStats* dsp_load_stats         ();
+  DspLoad       dsp_load               () const;
   // MT-Safe accessors
   static double          param_peek_mt   (const AudioProcessorP proc, Id32 paramid);
   // AudioProcessor Registry
@@ -251,6 +269,14 @@ private:
   static __thread uint64  tls_timestamp;
 };
 
+/// Render timing statistics of an AudioProcessor, located in telemetry memory.
+struct AudioProcessor::DspLoadStats {
+  DspLoad load;                         ///< Telemetry fields, updated after every block.
+  uint64  sum_ns = 0;
+  uint32  histogram[128] = { 0, };      ///< Quarter octave buckets of render durations in nanoseconds.
+  void    record (uint64 ns);
+};
+
 /// Aggregate structure for input/output buffer state and values in AudioProcessor::render().
 /// The floating point #buffer array is cache-line aligned (to 64 byte) to optimize
 /// SIMD access and avoid false sharing.
@@ -267,6 +293,8 @@ class AudioProcessor::FloatBuffer {
   friend class AudioProcessor;
   /// Pointer to the IO samples, this can be redirected or point to #fblock.
   float             *buffer = &fblock[0];
+  /// Silence flag, true if #buffer is redirected to the shared zero block.
+  bool               silent () const    { return buffer == const_float_zeros; }
 };
 
 // == ProcessorManager ==
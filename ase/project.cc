@@ -451,6 +451,13 @@ UndoScope::operator+= (const VoidF &func)
   projectp_->push_undo (func);
 }
 
+/// Add undo step `func` which holds `mem` bytes of undo data.
+void
+UndoScope::add (const VoidF &func, size_t mem)
+{
+  projectp_->push_undo (func, mem);
+}
+
 UndoScope
 ProjectImpl::undo_scope (const String &scopename)
 {
@@ -459,7 +466,8 @@ ProjectImpl::undo_scope (const String &scopename)
   const size_t old_redo = redostack_.size();
   UndoScope undoscope = add_undo_scope (scopename);
   if (undostack_.size() > old_undo && redostack_.size())
-    redostack_.clear();
+    while (!redostack_.empty())
+      pop_undo_func (redostack_);
   if ((!old_undo ^ !undostack_.size()) || (!old_redo ^ !redostack_.size()))
     emit_notify ("dirty");
   return undoscope;
@@ -472,20 +480,66 @@ ProjectImpl::add_undo_scope (const String &scopename)
   assert_return (scopename != "", undoscope);
   if (undo_scopes_open_ == 1 && (undo_groups_open_ == 0 || undo_group_name_.size()))
     {
-      undostack_.push_back ({ nullptr, undo_group_name_.empty() ? scopename : undo_group_name_ });
+      push_undo_func (undostack_, { nullptr, undo_group_name_.empty() ? scopename : undo_group_name_ });
       undo_group_name_ = "";
     }
   return undoscope;
 }
 
 void
-ProjectImpl::push_undo (const VoidF &func)
+ProjectImpl::push_undo (const VoidF &func, size_t mem)
 {
-  undostack_.push_back ({ func, "" });
+  push_undo_func (undostack_, { func, "", mem });
+  trim_undo();
   if (undostack_.size() == 1)
     emit_notify ("dirty");
 }
 
+void
+ProjectImpl::push_undo_func (std::vector<UndoFunc> &stack, UndoFunc &&ufunc)
+{
+  ufunc.mem += sizeof (UndoFunc) + ufunc.name.capacity();
+  undo_mem_ += ufunc.mem;
+  stack.push_back (std::move (ufunc));
+}
+
+void
+ProjectImpl::pop_undo_func (std::vector<UndoFunc> &stack)
+{
+  assert_return (undo_mem_ >= stack.back().mem);
+  undo_mem_ -= stack.back().mem;
+  stack.pop_back();
+}
+
+/// Evict the oldest undo groups until undo memory fits into the budget, the newest group is always kept.
+void
+ProjectImpl::trim_undo ()
+{
+  return_unless (undo_mem_ > undo_budget_);
+  // note, during undo(), undostack_ and redostack_ are swapped, so this trims the stack being recorded
+  size_t evict = 0, evicted_mem = 0, groups = 0;
+  for (size_t i = 0; i < undostack_.size() && undo_mem_ - evicted_mem > undo_budget_; i++)
+    {
+      if (!undostack_[i].func)
+        {
+          size_t next = i + 1;
+          while (next < undostack_.size() && undostack_[next].func)
+            next++;
+          if (next >= undostack_.size())
+            break;              // keep the newest (possibly open) group
+          for (size_t j = i; j < next; j++)
+            evicted_mem += undostack_[j].mem;
+          evict = next;
+          groups++;
+          i = next - 1;
+        }
+    }
+  return_unless (evict > 0);
+  undostack_.erase (undostack_.begin(), undostack_.begin() + evict);
+  undo_mem_ -= evicted_mem;
+  UDEBUG ("Undo: evicted %d groups (%d bytes), undo_memory=%d budget=%d\n", groups, evicted_mem, undo_mem_, undo_budget_);
+}
+
 void
 ProjectImpl::undo ()
 {
@@ -495,12 +549,12 @@ ProjectImpl::undo ()
   while (!undostack_.empty() && undostack_.back().func)
     {
       funcs.push_back (undostack_.back().func);
-      undostack_.pop_back();
+      pop_undo_func (undostack_);
     }
   assert_return (!undostack_.empty() && undostack_.back().func == nullptr); // must contain scope name
   const String scopename = undostack_.back().name;
   UDEBUG ("Undo: steps=%d scope: %s\n", funcs.size(), scopename);
-  undostack_.pop_back(); // pop scope name
+  pop_undo_func (undostack_); // pop scope name
   // swap undo/redo stacks, run undo steps and scope redo
   const bool redostack_was_empty = redostack_.empty();
   undostack_.swap (redostack_);
@@ -529,12 +583,12 @@ ProjectImpl::redo ()
   while (!redostack_.empty() && redostack_.back().func)
     {
       funcs.push_back (redostack_.back().func);
-      redostack_.pop_back();
+      pop_undo_func (redostack_);
     }
   assert_return (!redostack_.empty() && redostack_.back().func == nullptr); // must contain scope name
   const String scopename = redostack_.back().name;
   UDEBUG ("Undo: steps=%d scope: %s\n", funcs.size(), scopename);
-  redostack_.pop_back(); // pop scope name
+  pop_undo_func (redostack_); // pop scope name
   // run redo steps with undo scope
   const bool undostack_was_empty = undostack_.empty();
   {
@@ -582,20 +636,23 @@ ProjectImpl::clear_undo ()
   assert_warn (undo_scopes_open_ == 0 && undo_groups_open_ == 0);
   undostack_.clear();
   redostack_.clear();
+  undo_mem_ = 0;
   emit_notify ("dirty");
 }
 
-size_t ProjectImpl::undo_mem_counter = 0;
+/// Exact memory used by undo and redo steps, including recorded undo data.
+int64
+ProjectImpl::undo_memory () const
+{
+  return undo_mem_;
+}
 
-size_t
-ProjectImpl::undo_size_guess () const
+void
+ProjectImpl::undo_budget (int64 bytes)
 {
-  size_t count = undostack_.size();
-  count += redostack_.size();
-  size_t item = sizeof (UndoFunc);
-  item += sizeof (std::shared_ptr<void>); // undofunc selfp
-  item += 4 * sizeof (uint64);            // undofunc arguments: double ClipNote struct
-  return count * item + undo_mem_counter;
+  assert_return (bytes >= 0);
+  undo_budget_ = bytes;
+  trim_undo();
 }
 
 TelemetryFieldS
@@ -668,6 +725,8 @@ ProjectImpl::update_tempo ()
 {
   AudioProcessorP proc = master_processor();
   return_unless (proc);
+  for (auto track : tracks_)
+    track->freeze_invalidate(); // frozen audio depends on tempo
   const TickSignature tsig (tick_sig_);
   auto job = [proc, tsig] () {
     AudioTransport &transport = const_cast<AudioTransport&> (proc->engine().transport());
@@ -706,7 +765,8 @@ ProjectImpl::start_playback (double autostop)
     AudioEngine &engine = proc->engine();
     const double udmax = 18446744073709549568.0; // max double exactly matching an uint64_t
     const uint64_t s = autostop > udmax ? udmax : autostop * engine.sample_rate();
-    engine.set_autostop (s);
+    const uint64_t now = engine.frame_counter(); // autostop is relative to playback start
+    engine.set_autostop (s >= U64MAX - now ? U64MAX : now + s);
     AudioTransport &transport = const_cast<AudioTransport&> (engine.transport());
     transport.tempo (tsig);
     transport.running (true);
@@ -16,6 +16,7 @@ public:
   /*copy*/  UndoScope  (const UndoScope&);
   /*dtor*/ ~UndoScope  ();
   void      operator+= (const VoidF &func);
+  void      add        (const VoidF &func, size_t mem);
 };
 
 class ProjectImpl final : public DeviceImpl, public virtual Project {
@@ -27,14 +28,19 @@ class ProjectImpl final : public DeviceImpl, public virtual Project {
   uint undo_scopes_open_ = 0;
   uint undo_groups_open_ = 0;
   String undo_group_name_;
-  struct UndoFunc { VoidF func; String name; };
+  struct UndoFunc { VoidF func; String name; size_t mem = 0; };
   std::vector<UndoFunc> undostack_, redostack_;
+  size_t undo_mem_ = 0;
+  size_t undo_budget_ = 128 * 1024 * 1024;
   struct PStorage;
   PStorage *storage_ = nullptr;
   String saved_filename_;
   bool discarded_ = false;
   friend class UndoScope;
   UndoScope           add_undo_scope (const String &scopename);
+  void                push_undo_func (std::vector<UndoFunc> &stack, UndoFunc &&ufunc);
+  void                pop_undo_func  (std::vector<UndoFunc> &stack);
+  void                trim_undo      ();
 protected:
   explicit            ProjectImpl    ();
   virtual            ~ProjectImpl    ();
@@ -50,7 +56,7 @@ public:
   void                 _set_event_source (AudioProcessorP esource) override;
   DeviceInfo           device_info       () override;
   UndoScope            undo_scope        (const String &scopename);
-  void                 push_undo         (const VoidF &func);
+  void                 push_undo         (const VoidF &func, size_t mem = 0);
   void                 undo              () override;
   bool                 can_undo          () override;
   void                 redo              () override;
@@ -58,7 +64,9 @@ public:
   void                 group_undo        (const String &undoname) override;
   void                 ungroup_undo      () override;
   void                 clear_undo        ();
-  size_t               undo_size_guess   () const;
+  int64                undo_memory       () const override;
+  int64                undo_budget       () const override { return undo_budget_; }
+  void                 undo_budget       (int64 bytes) override;
   void                 start_playback    (double autostop);
   void                 start_playback    () override    { start_playback (D64MAX); }
   void                 stop_playback     () override;
@@ -82,7 +90,6 @@ public:
   AudioProcessorP      master_processor  () const;
   ssize_t              track_index       (const Track &child) const;
   static ProjectImplP  create            (const String &projectname);
-  static size_t undo_mem_counter;
 };
 using ProjectImplP = std::shared_ptr<ProjectImpl>;
 
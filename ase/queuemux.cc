@@ -64,4 +64,52 @@ queuemux_test()
   TASSERT (mux.count_pending() == 0);
 }
 
+TEST_INTEGRITY (queuemerger_test);
+static void
+queuemerger_test()
+{
+  // N queues contain ascending (sorted) values, with many duplicates across queues
+  constexpr size_t N = 16;
+  using Queue = std::vector<SomeValue>;
+  std::vector<Queue> queues;
+  queues.resize (N);
+  size_t total = 0;
+  for (size_t q = 0; q < N; q++)
+    {
+      int v = random_int64() % 7;
+      const size_t n = random_int64() % 50; // includes empty queues
+      for (size_t i = 0; i < n; i++)
+        {
+          queues[q].push_back (SomeValue { v });
+          v += random_int64() % 3;
+        }
+      total += n;
+    }
+  std::array<const Queue*,N> queue_ptrs{};
+  for (size_t i = 0; i < queues.size(); i++)
+    queue_ptrs[i] = &queues[i];
+  QueueMerger<N, Queue::const_iterator> merger;
+  merger.assign (queue_ptrs);
+  TASSERT (merger.count_pending() == total);
+  // values are sorted, equal values come in queue order
+  std::vector<const SomeValue*> popped;
+  while (merger.more())
+    {
+      const SomeValue &current = merger.pop();
+      TASSERT (popped.empty() || popped.back()->i <= current.i);
+      popped.push_back (&current);
+    }
+  TASSERT (popped.size() == total);
+  TASSERT (merger.count_pending() == 0);
+  auto queue_of = [&] (const SomeValue *v) {
+    for (size_t q = 0; q < N; q++)
+      if (!queues[q].empty() && v >= &queues[q].front() && v <= &queues[q].back())
+        return q;
+    return N;
+  };
+  for (size_t i = 1; i < popped.size(); i++)
+    if (popped[i - 1]->i == popped[i]->i)
+      TASSERT (queue_of (popped[i - 1]) <= queue_of (popped[i]));
+}
+
 } // Anon
@@ -19,6 +19,25 @@ struct QueueMultiplexer {
   Priority first = {}, next = {};
   std::array<Ptr, MAXQUEUES> ptrs;
   QueueMultiplexer () {}
+  void
+  clear () noexcept
+  {
+    n_queues = 0;
+  }
+  /// Add the sorted sequence [it, end) to the multiplexer.
+  bool
+  add (ForwardIterator it, ForwardIterator end) noexcept
+  {
+    if (it != end)
+      {
+        ASE_ASSERT_RETURN (n_queues < ssize_t (MAXQUEUES), more());
+        ptrs[n_queues].it = it;
+        ptrs[n_queues].end = end;
+        n_queues++;
+        seek();
+      }
+    return more();
+  }
   template<class IterableContainer> bool
   assign (const std::array<const IterableContainer*, MAXQUEUES> &queues)
   {
@@ -133,6 +152,162 @@ private:
   }
 };
 
+/// K-way merger to pop from many sorted Queues in priority order, using a binary min-heap.
+/// Pops cost O(log k) for k queues, runs of values from the same queue cost O(1).
+/// Values at the same priority are popped in the order their queues were added.
+/// Relies on unqualified calls to `Priority QueueMultiplexer_priority (const ValueType&)`.
+template<size_t MAXQUEUES, class ForwardIterator>
+  requires std::forward_iterator<ForwardIterator>
+struct QueueMerger {
+  using ValueType = std::remove_reference_t<decltype (*std::declval<ForwardIterator>())>;
+  using Priority = decltype (QueueMultiplexer_priority (std::declval<const ValueType&>()));
+  struct Ptr { ForwardIterator it, end; Priority prio; uint32_t order; };
+  std::array<Ptr, MAXQUEUES> heap;
+  uint32_t n_queues = 0, n_added = 0;
+  QueueMerger () {}
+  void
+  clear () noexcept
+  {
+    n_queues = 0;
+    n_added = 0;
+  }
+  /// Add the sorted sequence [it, end) to the merge.
+  bool
+  add (ForwardIterator it, ForwardIterator end) noexcept
+  {
+    const uint32_t order = n_added++;
+    if (it == end)
+      return more();
+    ASE_ASSERT_RETURN (n_queues < MAXQUEUES, more());
+    heap[n_queues] = { it, end, QueueMultiplexer_priority (*it), order };
+    sift_up (n_queues++);
+    return true;
+  }
+  template<class IterableContainer> bool
+  assign (const std::array<const IterableContainer*, MAXQUEUES> &queues)
+  {
+    static_assert (std::is_same<
+                   ForwardIterator,
+                   decltype (std::begin (std::declval<const IterableContainer&>()))
+                   >::value);
+    clear();
+    for (size_t i = 0; i < queues.size(); i++)
+      if (queues[i]) [[likely]]
+        add (std::begin (*queues[i]), std::end (*queues[i]));
+    return more();
+  }
+  size_t
+  count_pending() const noexcept
+  {
+    size_t c = 0;
+    for (uint32_t i = 0; i < n_queues; i++)
+      c += heap[i].end - heap[i].it;
+    return c;
+  }
+  bool
+  more() const noexcept
+  {
+    return n_queues > 0;
+  }
+  const ValueType&
+  peek () noexcept
+  {
+    if (!more()) [[unlikely]]
+      return empty();
+    return *heap[0].it;
+  }
+  const ValueType&
+  pop () noexcept
+  {
+    ASE_ASSERT_RETURN (more(), empty());
+    Ptr &top = heap[0];
+    const ValueType &result = *top.it++;
+    if (top.it == top.end) [[unlikely]]
+      {                                         // remove emptied queue
+        top = heap[--n_queues];
+        sift_down (0);
+      }
+    else
+      {
+        top.prio = QueueMultiplexer_priority (*top.it);
+        if (n_queues > 1 && !lesser (top, heap[1 + (n_queues > 2 && lesser (heap[2], heap[1]))]))
+          sift_down (0);                        // next value is in other queue
+      }
+    return result;
+  }
+  class Iter {
+    QueueMerger *mux_ = nullptr;
+  public:
+    using difference_type = ssize_t;
+    using value_type = const ValueType;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+    using iterator_category = std::input_iterator_tag;
+    /*ctor*/    Iter       (QueueMerger *u = nullptr) : mux_ (u && u->more() ? u : nullptr) {}
+    bool        more       () const { return mux_ && mux_->more(); }
+    friend bool operator== (const Iter &a, const Iter &b) { return a.more() == b.more(); }
+    value_type& operator*  () const { return mux_ ? mux_->peek() : empty(); }
+    Iter        operator++ (int) { Iter copy (*this); this->operator++(); return copy; }
+    Iter&       operator++ ()
+    {
+      if (mux_) [[likely]] {
+        if (mux_->more()) [[likely]]
+          mux_->pop();
+        else
+          mux_ = nullptr;
+      }
+      return *this;
+    }
+  };
+  using iterator = Iter;
+  iterator begin ()     { return Iter (this); }
+  iterator end   ()     { return {}; }
+private:
+  static bool
+  lesser (const Ptr &a, const Ptr &b) noexcept
+  {
+    return a.prio < b.prio || (a.prio == b.prio && a.order < b.order);
+  }
+  void
+  sift_up (uint32_t i) noexcept
+  {
+    const Ptr p = heap[i];
+    while (i > 0)
+      {
+        const uint32_t parent = (i - 1) >> 1;
+        if (!lesser (p, heap[parent]))
+          break;
+        heap[i] = heap[parent];
+        i = parent;
+      }
+    heap[i] = p;
+  }
+  void
+  sift_down (uint32_t i) noexcept
+  {
+    const Ptr p = heap[i];
+    for (;;)
+      {
+        uint32_t child = 2 * i + 1;
+        if (child >= n_queues)
+          break;
+        if (child + 1 < n_queues && lesser (heap[child + 1], heap[child]))
+          child++;
+        if (!lesser (heap[child], p))
+          break;
+        heap[i] = heap[child];
+        i = child;
+      }
+    heap[i] = p;
+  }
+  static const ValueType&
+  empty() noexcept ASE_NOINLINE
+  {
+    static const ValueType empty_ {};
+    return empty_;
+  }
+};
+
 } // Ase
 
 #endif /* __ASE_QUEUEMUX_HH__ */
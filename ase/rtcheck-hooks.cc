@@ -0,0 +1,100 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#include "rtcheck.hh"
+#include <pthread.h>
+#include <dlfcn.h>
+#include <cerrno>
+
+/* Interposition of allocation and locking functions for --check-rt, only linked into RTCHECK=1
+ * builds. Sanitizers provide their own allocators and interceptors, which must not be bypassed.
+ */
+#if defined __SANITIZE_ADDRESS__ || defined __SANITIZE_THREAD__
+#define ASE_RTCHECK_HOOKS       0
+#elif defined __has_feature
+#if __has_feature (address_sanitizer) || __has_feature (thread_sanitizer) || __has_feature (leak_sanitizer)
+#define ASE_RTCHECK_HOOKS       0
+#endif
+#endif
+#if !defined ASE_RTCHECK_HOOKS && defined __GLIBC__
+#define ASE_RTCHECK_HOOKS       1
+#endif
+
+#if ASE_RTCHECK_HOOKS
+extern "C" {
+void* __libc_malloc   (size_t size);
+void* __libc_calloc   (size_t nmemb, size_t size);
+void* __libc_realloc  (void *ptr, size_t size);
+void* __libc_memalign (size_t alignment, size_t size);
+void  __libc_free     (void *ptr);
+} // "C"
+
+namespace Ase::RtCheck {
+extern const bool hooks_linked_;
+const bool hooks_linked_ = true; // see RtCheck::enable()
+} // Ase::RtCheck
+
+using namespace Ase;
+
+extern "C" void*
+malloc (size_t size) noexcept
+{
+  RtCheck::check (RtCheck::MALLOC, size);
+  return __libc_malloc (size);
+}
+
+extern "C" void*
+calloc (size_t nmemb, size_t size) noexcept
+{
+  RtCheck::check (RtCheck::MALLOC, nmemb * size);
+  return __libc_calloc (nmemb, size);
+}
+
+extern "C" void*
+realloc (void *ptr, size_t size) noexcept
+{
+  RtCheck::check (RtCheck::MALLOC, size);
+  return __libc_realloc (ptr, size);
+}
+
+extern "C" int
+posix_memalign (void **memptr, size_t alignment, size_t size) noexcept
+{
+  if (alignment % sizeof (void*) != 0 || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+  RtCheck::check (RtCheck::MALLOC, size);
+  void *mem = __libc_memalign (alignment, size);
+  if (!mem)
+    return ENOMEM;
+  *memptr = mem;
+  return 0;
+}
+
+extern "C" void*
+aligned_alloc (size_t alignment, size_t size) noexcept
+{
+  RtCheck::check (RtCheck::MALLOC, size);
+  return __libc_memalign (alignment, size);
+}
+
+extern "C" void
+free (void *ptr) noexcept
+{
+  if (ptr)
+    RtCheck::check (RtCheck::FREE, 0);
+  __libc_free (ptr);
+}
+
+extern "C" int
+pthread_mutex_lock (pthread_mutex_t *mutex) noexcept
+{
+  using LockF = int (*) (pthread_mutex_t*);
+  static std::atomic<LockF> libc_pthread_mutex_lock = nullptr;
+  LockF lock = libc_pthread_mutex_lock.load (std::memory_order_relaxed);
+  if (ASE_UNLIKELY (!lock))
+    {
+      lock = LockF (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+      libc_pthread_mutex_lock = lock;
+    }
+  RtCheck::check (RtCheck::MUTEX_LOCK, 0);
+  return lock (mutex);
+}
+#endif // ASE_RTCHECK_HOOKS
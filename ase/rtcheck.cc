@@ -0,0 +1,176 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#include "rtcheck.hh"
+#include "processor.hh"
+#include "strings.hh"
+#include "platform.hh"
+#include "internal.hh"
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <typeinfo>
+
+namespace Ase {
+namespace RtCheck {
+
+std::atomic<bool> enabled_ = false;
+
+// Defined by rtcheck-hooks.cc, which is only linked into RTCHECK=1 builds
+extern const bool hooks_linked_ __attribute__ ((weak));
+
+static constexpr uint MAX_FRAMES = 24;
+static constexpr uint MAX_RECORDS = 64;
+static constexpr uint MAX_SITES = 256;
+
+struct Record {
+  std::atomic<bool> ready = false;
+  Kind              kind = Kind (0);
+  size_t            size = 0;
+  int               n_frames = 0;
+  void             *frames[MAX_FRAMES] = {};
+  const std::type_info *processor = nullptr; // typeid() of the rendering AudioProcessor
+};
+
+// All state is static, recording must not allocate
+static std::array<Record,MAX_RECORDS> records;
+static std::atomic<uint> n_records = 0;                 // slots claimed by render threads
+static std::atomic<uint> n_reported = 0;               // slots reported by report()
+static std::atomic<uint64> violation_count = 0;
+static std::array<std::atomic<uint64>,MAX_SITES> sites; // hashes of recorded call sites
+
+static __thread uint                  tls_depth = 0;
+static __thread bool                  tls_busy = false;
+static __thread const AudioProcessor *tls_processor = nullptr;
+
+// Insert `hash` into the set of known call sites, returns false for duplicates
+static bool
+site_add (uint64 hash)
+{
+  hash |= 1; // 0 marks empty slots
+  for (uint i = 0; i < MAX_SITES; i++)
+    {
+      std::atomic<uint64> &slot = sites[(hash + i) % MAX_SITES];
+      uint64 prev = 0;
+      if (slot.compare_exchange_strong (prev, hash) || prev == hash)
+        return prev == 0;
+    }
+  return false; // table full, stop recording
+}
+
+static void ASE_NOINLINE
+record (Kind kind, size_t size)
+{
+  tls_busy = true; // guard against recursion, backtrace() may allocate
+  violation_count++;
+  void *frames[MAX_FRAMES + 2];
+  const int n_frames = backtrace (frames, MAX_FRAMES + 2) - 2; // skip record() and its caller
+  uint64 hash = 0xcbf29ce484222325 ^ kind; // FNV-1a over frame addresses
+  for (int i = 0; i < n_frames; i++)
+    hash = (hash ^ uint64 (frames[2 + i])) * 0x100000001b3;
+  if (n_frames > 0 && site_add (hash))
+    {
+      const uint index = n_records++;
+      if (index < MAX_RECORDS)
+        {
+          Record &r = records[index];
+          r.kind = kind;
+          r.size = size;
+          r.n_frames = n_frames;
+          std::copy (frames + 2, frames + 2 + n_frames, r.frames);
+          r.processor = tls_processor ? &typeid (*tls_processor) : nullptr; // named in report()
+          r.ready = true;
+        }
+    }
+  tls_busy = false;
+}
+
+void
+check (Kind kind, size_t size)
+{
+  if (ASE_UNLIKELY (tls_depth) && !tls_busy)
+    record (kind, size);
+}
+
+const AudioProcessor*
+Scope::enter (const AudioProcessor *proc)
+{
+  const AudioProcessor *last = tls_processor;
+  tls_processor = proc ? proc : last;
+  tls_depth++;
+  return last;
+}
+
+void
+Scope::leave (const AudioProcessor *last)
+{
+  tls_depth--;
+  tls_processor = last;
+}
+
+void
+enable (bool onoff)
+{
+  assert_return (this_thread_is_ase());
+  if (onoff && !&hooks_linked_)
+    warning ("%s: malloc(), free() and pthread_mutex_lock() are not checked, build with RTCHECK=1", "--check-rt");
+  if (onoff)
+    {
+      void *frames[2];
+      backtrace (frames, 2); // backtrace() may dlopen libgcc_s upon first use
+    }
+  enabled_ = onoff;
+}
+
+uint64
+n_violations ()
+{
+  return violation_count;
+}
+
+bool
+pending ()
+{
+  return std::min (n_records.load(), MAX_RECORDS) > n_reported;
+}
+
+static const char*
+kind_name (Kind kind)
+{
+  switch (kind)
+    {
+    case MALLOC:        return "malloc";
+    case FREE:          return "free";
+    case MUTEX_LOCK:    return "pthread_mutex_lock";
+    }
+  return "?";
+}
+
+String
+report ()
+{
+  String s;
+  assert_return (this_thread_is_ase(), s);
+  const uint n = std::min (n_records.load(), MAX_RECORDS);
+  for (; n_reported < n && records[n_reported].ready; n_reported++)
+    {
+      const Record &r = records[n_reported];
+      s += string_format ("## Realtime Violation\n`%s (%u)` called during rendering", kind_name (r.kind), r.size);
+      if (r.processor)
+        s += string_format (" of `%s`", string_demangle_cxx (r.processor->name()));
+      s += ":\n```\n";
+      for (int i = 0; i < r.n_frames; i++)
+        {
+          Dl_info info = {};
+          if (dladdr (r.frames[i], &info) && info.dli_sname)
+            s += string_format ("#%-2d %p %s+0x%x\n", i, r.frames[i], string_demangle_cxx (info.dli_sname),
+                                uintptr_t (r.frames[i]) - uintptr_t (info.dli_saddr));
+          else
+            s += string_format ("#%-2d %p %s\n", i, r.frames[i], info.dli_fname ? info.dli_fname : "??");
+        }
+      s += "```\n";
+    }
+  if (n_records.load() > MAX_RECORDS)
+    s += string_format ("(%u more violation sites omitted)\n", n_records.load() - MAX_RECORDS);
+  return s;
+}
+
+} // RtCheck
+} // Ase
@@ -0,0 +1,55 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#ifndef __ASE_RTCHECK_HH__
+#define __ASE_RTCHECK_HH__
+
+#include <ase/defs.hh>
+#include <atomic>
+
+namespace Ase {
+
+/** Realtime safety checker for the render path.
+ * Once enabled, calls to malloc(), free() and pthread_mutex_lock() are intercepted
+ * on threads that currently execute a RtCheck::Scope, i.e. while the engine renders.
+ * Each distinct call site is recorded with a backtrace and the type of the rendering
+ * AudioProcessor, without allocating memory in the offending thread.
+ * The interception lives in rtcheck-hooks.cc, which is only linked into builds
+ * configured with RTCHECK=1 and never into sanitizer builds.
+ */
+namespace RtCheck {
+
+enum Kind : uint8 { MALLOC = 1, FREE, MUTEX_LOCK };
+
+void   enable       (bool onoff);       ///< Start/stop checking, needs to be called from the main thread.
+bool   pending      ();                 ///< Check for unreported violations.
+String report       ();                 ///< Format unreported violations, needs to be called from the main thread.
+uint64 n_violations ();                 ///< Total number of violations (including duplicates) seen so far.
+void   check        (Kind kind, size_t size); ///< Record a violation if the calling thread is rendering.
+
+extern std::atomic<bool> enabled_;
+
+/// Mark the current thread as realtime thread rendering `proc` (may be nullptr) for the Scope lifetime.
+class Scope {
+  const AudioProcessor *last_ = nullptr;
+  bool                  active_ = false;
+  static const AudioProcessor* enter (const AudioProcessor *proc);
+  static void                  leave (const AudioProcessor *last);
+public:
+  explicit Scope (const AudioProcessor *proc)
+  {
+    if (ASE_UNLIKELY (enabled_.load (std::memory_order_relaxed)))
+      {
+        last_ = enter (proc);
+        active_ = true;
+      }
+  }
+  /*dtor*/ ~Scope ()
+  {
+    if (ASE_UNLIKELY (active_))
+      leave (last_);
+  }
+};
+
+} // RtCheck
+} // Ase
+
+#endif // __ASE_RTCHECK_HH__
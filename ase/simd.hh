@@ -0,0 +1,94 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#ifndef __ASE_SIMD_HH__
+#define __ASE_SIMD_HH__
+
+#include <ase/cxxaux.hh>
+
+namespace Ase {
+
+/// Number of float lanes in the vector registers of the build target, 4 for SSE, 8 for AVX and 16 for AVX-512.
+#if defined (__AVX512F__)
+static constexpr uint SIMD_FLOAT_LANES = 16;
+#elif defined (__AVX__)
+static constexpr uint SIMD_FLOAT_LANES = 8;
+#else
+static constexpr uint SIMD_FLOAT_LANES = 4;
+#endif
+
+/// Helper to construct SimdVector types.
+template<class T, uint N>
+struct SimdVectorT {
+  static_assert (N >= 1 && (N & (N - 1)) == 0, "SIMD lane count must be a power of 2");
+  typedef T Type __attribute__ ((vector_size (N * sizeof (T))));
+};
+
+/** Vector of `N` lanes of `T`, using the GCC vector extensions.
+ * Arithmetic, comparisons and `?:` blending operate per lane, comparisons yield signed integer lanes
+ * of all bits set for true. Vectors wider than the target registers are split by the compiler,
+ * which allows writing lane counts independently of the instruction set.
+ * Avoid passing wide vectors by value to non-inlined functions, that changes the ABI.
+ */
+template<class T, uint N> using SimdVector = typename SimdVectorT<T,N>::Type;
+
+/// Number of lanes in a SimdVector.
+template<class V> static constexpr uint simd_lanes = sizeof (V) / sizeof (V{}[0]);
+
+/// Load a SimdVector from `N` consecutive values, `p` needs no special alignment.
+template<class V, class T> ASE_ALWAYS_INLINE inline void
+simd_load (V &v, const T *p)
+{
+  static_assert (sizeof (V) == simd_lanes<V> * sizeof (T));
+  __builtin_memcpy (&v, p, sizeof (V));
+}
+
+/// Store a SimdVector into `N` consecutive values, `p` needs no special alignment.
+template<class V, class T> ASE_ALWAYS_INLINE inline void
+simd_store (T *p, const V &v)
+{
+  static_assert (sizeof (V) == simd_lanes<V> * sizeof (T));
+  __builtin_memcpy (p, &v, sizeof (V));
+}
+
+/// Check if any lane of the comparison result `mask` is true.
+template<class M> ASE_ALWAYS_INLINE inline bool
+simd_any (const M &mask)
+{
+  auto bits = mask[0];
+  for (uint i = 1; i < simd_lanes<M>; i++)
+    bits |= mask[i];
+  return bits != 0;
+}
+
+/// Bit mask of the true lanes in the comparison result `mask`, lane 0 is the least significant bit.
+template<class M> ASE_ALWAYS_INLINE inline uint64
+simd_bits (const M &mask)
+{
+  static_assert (simd_lanes<M> <= 64);
+  uint64 bits = 0;
+  for (uint i = 0; i < simd_lanes<M>; i++)
+    bits |= uint64 (mask[i] & 1) << i;
+  return bits;
+}
+
+/// Clamp all lanes of `v` into the range [`lo`, `hi`].
+template<class V, class T> ASE_ALWAYS_INLINE inline V
+simd_clamp (const V &v, T lo, T hi)
+{
+  const V vlo = V{} + lo, vhi = V{} + hi;
+  const V r = v < vlo ? vlo : v;
+  return r > vhi ? vhi : r;
+}
+
+/// Sum up all lanes of `v`.
+template<class V> ASE_ALWAYS_INLINE inline auto
+simd_sum (const V &v)
+{
+  auto sum = v[0];
+  for (uint i = 1; i < simd_lanes<V>; i++)
+    sum += v[i];
+  return sum;
+}
+
+} // Ase
+
+#endif // __ASE_SIMD_HH__
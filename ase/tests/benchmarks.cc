@@ -3,6 +3,8 @@
 #include "../unicode.hh"
 #include "../memory.hh"
 #include "../loft.hh"
+#include "../midievent.hh"
+#include "../randomhash.hh"
 #include "../internal.hh"
 #include <cmath>
 
@@ -408,4 +410,69 @@ zbench_aligned_allocator_loft_alloc()
   ase_aligned_allocator_benchloop<AllocatorType::LoftAlloc> (2654435769);
 }
 
+// == MidiEvent merging ==
+template<size_t K, class Merger>
+static double
+midi_event_merge_bench (const char *name)
+{
+  // K sorted event streams of a typical block size
+  constexpr size_t EVENTS_PER_QUEUE = 64, BLOCK = 256;
+  std::vector<std::vector<Ase::MidiEvent>> streams (K);
+  for (auto &stream : streams)
+    {
+      std::vector<uint> frames;
+      for (size_t i = 0; i < EVENTS_PER_QUEUE; i++)
+        frames.push_back (Ase::random_int64() % BLOCK);
+      std::sort (frames.begin(), frames.end());
+      for (uint frame : frames)
+        {
+          stream.push_back (Ase::make_note_on (0, 60, 1.0));
+          stream.back().frame = frame;
+        }
+    }
+  std::array<Ase::MidiEventRange,K> ranges;
+  std::array<const Ase::MidiEventRange*,K> range_ptrs;
+  for (size_t i = 0; i < K; i++)
+    {
+      ranges[i] = streams[i];
+      range_ptrs[i] = &ranges[i];
+    }
+  Ase::Test::Timer timer (MAXTIME);
+  size_t accu = 0;
+  auto loop_merge = [&] () {
+    for (size_t j = 0; j < 64; j++)
+      {
+        Merger merger;
+        merger.assign (range_ptrs);
+        uint last = 0;
+        while (merger.more())
+          {
+            const Ase::MidiEvent &ev = merger.pop();
+            accu += ev.frame < last;
+            last = ev.frame;
+          }
+      }
+  };
+  const double bench_time = timer.benchmark (loop_merge);
+  const double n_events = 64.0 * K * EVENTS_PER_QUEUE;
+  Ase::printerr ("  BENCH    %-18s k=%-3u %11.1f MEvents/s, %6.2f nsecs/event\n", name, K,
+                 n_events / bench_time / M, bench_time * 1e9 / n_events);
+  TASSERT (accu == 0);
+  return bench_time;
+}
+
+TEST_BENCHMARK (midi_event_merge_benchmarks);
+static void
+midi_event_merge_benchmarks()
+{
+  midi_event_merge_bench<2, Ase::QueueMultiplexer<2,const Ase::MidiEvent*>> ("QueueMultiplexer:");
+  midi_event_merge_bench<2, Ase::QueueMerger<2,const Ase::MidiEvent*>> ("QueueMerger:");
+  midi_event_merge_bench<4, Ase::QueueMultiplexer<4,const Ase::MidiEvent*>> ("QueueMultiplexer:");
+  midi_event_merge_bench<4, Ase::QueueMerger<4,const Ase::MidiEvent*>> ("QueueMerger:");
+  midi_event_merge_bench<16, Ase::QueueMultiplexer<16,const Ase::MidiEvent*>> ("QueueMultiplexer:");
+  midi_event_merge_bench<16, Ase::QueueMerger<16,const Ase::MidiEvent*>> ("QueueMerger:");
+  midi_event_merge_bench<64, Ase::QueueMultiplexer<64,const Ase::MidiEvent*>> ("QueueMultiplexer:");
+  midi_event_merge_bench<64, Ase::QueueMerger<64,const Ase::MidiEvent*>> ("QueueMerger:");
+}
+
 } // Anon
@@ -8,6 +8,8 @@
 #include "server.hh"
 #include "main.hh"
 #include "serialize.hh"
+#include "storage.hh"
+#include "path.hh"
 #include "jsonipc/jsonipc.hh"
 #include "internal.hh"
 
@@ -24,6 +26,8 @@ TrackImpl::TrackImpl (ProjectImpl &project, bool masterflag)
 TrackImpl::~TrackImpl()
 {
   assert_return (_parent() == nullptr);
+  if (!freeze_cachedir_.empty())
+    anklang_cachedir_cleanup (freeze_cachedir_);
 }
 
 ProjectImpl*
@@ -103,6 +107,7 @@ TrackImpl::_set_parent (GadgetImpl *parent)
     }
   else if (chain_)
     {
+      freeze_invalidate();
       midi_prod_->_disconnect_remove();
       chain_->_disconnect_remove();
       chain_->_set_parent (nullptr);
@@ -209,6 +214,7 @@ void
 TrackImpl::update_clips ()
 {
   return_unless (midi_prod_);
+  freeze_invalidate();
   MidiLib::MidiProducerIfaceP midi_iface = std::dynamic_pointer_cast<MidiLib::MidiProducerIface> (midi_prod_->_audio_processor());
   MidiLib::MidiFeedP feedp = std::make_shared<MidiLib::MidiFeed>();
   MidiLib::MidiFeed &feed = *feedp;
@@ -226,6 +232,233 @@ TrackImpl::update_clips ()
   midi_iface->engine().async_jobs += job;
 }
 
+/// Regenerate the MIDI generator of a single `clip`, without touching other clips.
+void
+TrackImpl::update_clip (const ClipImpl &clip)
+{
+  return_unless (midi_prod_);
+  const ssize_t index = clip_index (clip);
+  return_unless (index >= 0);
+  freeze_invalidate();
+  MidiLib::MidiProducerIfaceP midi_iface = std::dynamic_pointer_cast<MidiLib::MidiProducerIface> (midi_prod_->_audio_processor());
+  ClipImpl::Generator generator;
+  generator.setup (clip);
+  auto job = [midi_iface, index, generator] () mutable {
+    midi_iface->update_generator (index, generator);
+    // generator holds the previous clip events now, its dtor runs in the user thread
+  };
+  midi_iface->engine().async_jobs += job;
+}
+
+AudioChainP
+TrackImpl::audio_chain () const
+{
+  return_unless (chain_, nullptr);
+  return std::dynamic_pointer_cast<AudioChain> (chain_->_audio_processor());
+}
+
+static constexpr const double FREEZE_TAIL_SECONDS = 4;
+
+/// Determine the ticks that freezing needs to render, by following the clip succession of the
+/// MIDI producer from tick 0: playback starts with the first clip, a successor starts at the
+/// next bar after a clip ends and a looping clip repeats forever. Repeating from `intro_ticks`
+/// on with `period_ticks` reproduces playback, `period_ticks` is 0 if playback stops.
+bool
+TrackImpl::freeze_span (const TickSignature &tsig, int64 *intro_ticks, int64 *period_ticks) const
+{
+  const int64 bar_ticks = tsig.bar_ticks();
+  int64 tick = 0;
+  ssize_t index = 0;
+  *period_ticks = 0;
+  for (size_t n = 0; n < clips_.size() && index >= 0 && size_t (index) < clips_.size() && clips_[index]; n++)
+    {
+      ClipImpl::Generator generator;
+      generator.setup (*clips_[index]);
+      if (generator.play_length() >= M52MAX) // looping, repeats after the first pass
+        {
+          *intro_ticks = tick + generator.loop_end() - generator.start_offset();
+          *period_ticks = generator.loop_end() - generator.loop_start();
+          return *period_ticks > 0;
+        }
+      if (generator.play_length() <= 0)
+        break;                          // playback stops at an empty clip
+      tick += generator.play_length();
+      index = clip_succession (*clips_[index]);
+      if (index < 0)
+        break;                          // playback stops
+      tick = (tick + bar_ticks - 1) / bar_ticks * bar_ticks;
+      if (index == 0)                   // the clip sequence repeats, render it twice for the tails
+        {
+          *intro_ticks = tick;
+          *period_ticks = tick;
+          return tick > 0;
+        }
+    }
+  *intro_ticks = tick;
+  return tick > 0;
+}
+
+/// Render the track chain into an audio cache and play it back instead of the chain.
+/// Rendering happens by playing the project from the start in freewheel mode, paced
+/// by the cache writer. Since this takes over the transport, freezing is refused while
+/// the project is playing or paused after the start, and only one track of a project
+/// freezes at a time, the stopped transport is restored by freeze_done().
+/// The length follows the clip succession (see freeze_span()),
+/// looping playback is rendered for two loop periods (so loop repetitions include the
+/// tail of the previous loop). Clip, device, parameter and tempo changes discard the cache,
+/// including changes of the clip succession, see also freeze_invalidate().
+bool
+TrackImpl::freeze (bool onoff)
+{
+  if (!onoff)
+    {
+      freeze_invalidate();
+      return true;
+    }
+  return_unless (!frozen_ && !freezing_, true);
+  ProjectImpl *project = this->project();
+  AudioChainP chain = audio_chain();
+  return_unless (project && chain && !is_master(), false);
+  AudioEngine &engine = chain->engine();
+  const uint n_channels = 2;
+  return_unless (chain->n_ochannels (OBusId (1)) <= n_channels, false);
+  for (TrackP track : project->all_tracks())
+    if (shared_ptr_cast<TrackImpl> (track)->freezing_)
+      {
+        ASE_SERVER.user_note (string_format ("## Freeze Track\n%s: \\\nAnother track is being frozen: \\\n%s",
+                                             name(), track->name()));
+        return false;
+      }
+  if (project->is_playing() || engine.transport().current_tick > 0)
+    {
+      ASE_SERVER.user_note (string_format ("## Freeze Track\n%s: \\\nFreezing needs the project stopped at the start",
+                                           name()));
+      return false;
+    }
+  launcher_clips(); // forces creation
+  TickSignature tsig (project->signature());
+  tsig.set_samplerate (engine.sample_rate());
+  auto cache = std::make_shared<AudioChain::FrozenCache>();
+  cache->n_channels = n_channels;
+  return_unless (freeze_span (tsig, &cache->intro_ticks, &cache->period_ticks), false);
+  int64 n_frames;
+  if (cache->period_ticks > 0) // looping
+    n_frames = tsig.sample_from_tick (cache->intro_ticks + cache->period_ticks) + 1;
+  else
+    n_frames = tsig.sample_from_tick (cache->intro_ticks) + FREEZE_TAIL_SECONDS * engine.sample_rate();
+  // setup cache file
+  const String cachedir = anklang_cachedir_create();
+  if (cachedir.empty())
+    {
+      printerr ("%s: failed to create cache directory: %s\n", program_alias(), strerror (errno));
+      return false;
+    }
+  const String filename = Path::join (cachedir, "freeze.f32");
+  WaveWriterP raw_writer = wave_writer_create_raw (n_channels, filename, 0600);
+  if (!raw_writer)
+    {
+      printerr ("%s: %s: failed to open cache file: %s\n", program_alias(), filename, strerror (errno));
+      anklang_cachedir_cleanup (cachedir);
+      return false;
+    }
+  // the ring only buffers disk latency, freewheeling waits for ring space
+  const size_t ring_frames = CLAMP (n_frames, 1 * engine.sample_rate(), 16 * engine.sample_rate());
+  auto *recorder = new AudioChain::FreezeRecorder();
+  recorder->writer = wave_writer_create_async (raw_writer, n_channels, ring_frames);
+  recorder->n_channels = n_channels;
+  recorder->n_frames = n_frames;
+  const uint32 serial = ++freeze_serial_;
+  std::weak_ptr<TrackImpl> weakself = shared_ptr_cast<TrackImpl> (this);
+  AudioEngine *enginep = &engine;
+  recorder->done = [weakself, serial, filename, cache, enginep] (AudioChain::FreezeRecorder &recorder) {
+    enginep->pace_freewheel (recorder.writer, false);
+    recorder.failed |= !recorder.writer->close();
+    TrackImplP self = weakself.lock();
+    if (self && self->freeze_serial_ == serial)
+      self->freeze_done (recorder, filename, cache);
+  };
+  freeze_cachedir_ = cachedir;
+  freezing_ = true;
+  // render project from the start (checked above), as fast as possible
+  engine.async_jobs += [chain, recorder] () {
+    chain->freeze_record (recorder);
+  };
+  engine.pace_freewheel (recorder->writer, true);
+  engine.set_freewheel (true);
+  project->start_playback();
+  return true;
+}
+
+void
+TrackImpl::freeze_done (AudioChain::FreezeRecorder &recorder, const String &filename, AudioChain::FrozenCacheP cache)
+{
+  assert_return (freezing_);
+  freezing_ = false;
+  ProjectImpl *project = this->project();
+  AudioChainP chain = audio_chain();
+  return_unless (project && chain);
+  AudioEngine &engine = chain->engine();
+  engine.set_freewheel (false);
+  project->stop_playback();
+  project->stop_playback();     // rewind, freeze() started at the stopped start position
+  const AsyncWaveWriter::Stats stats = recorder.writer->stats();
+  if (!recorder.failed && !stats.n_dropped && !stats.n_failed)
+    {
+      cache->blob = Blob::from_file (filename);
+      cache->frames = (const float*) cache->blob.data();
+      cache->n_frames = cache->blob.size() / (sizeof (float) * cache->n_channels);
+    }
+  if (recorder.failed || stats.n_dropped || stats.n_failed || cache->n_frames < recorder.n_frames)
+    {
+      printerr ("%s: %s: freezing failed, %u frames dropped, %u frames failed\n", program_alias(), filename,
+                stats.n_dropped, stats.n_failed);
+      anklang_cachedir_cleanup (freeze_cachedir_);
+      freeze_cachedir_.clear();
+      emit_notify ("frozen");
+      return;
+    }
+  auto job = [chain, cache] () mutable {
+    chain->freeze_playback (cache);
+    // swapped cache is released in the main thread
+  };
+  engine.async_jobs += job;
+  frozen_ = true;
+  emit_notify ("frozen");
+}
+
+/// Discard frozen audio, needs to be called when clips, devices or parameters change.
+void
+TrackImpl::freeze_invalidate ()
+{
+  return_unless (frozen_ || freezing_);
+  freeze_serial_++; // ignore pending freeze_done()
+  AudioChainP chain = audio_chain();
+  if (chain)
+    {
+      AudioChain::FrozenCacheP nocache;
+      auto job = [chain, nocache] () mutable {
+        chain->freeze_record (nullptr);
+        chain->freeze_playback (nocache);
+        // swapped cache is released in the main thread
+      };
+      chain->engine().async_jobs += job;
+      ProjectImpl *project = this->project();
+      if (freezing_)
+        chain->engine().set_freewheel (false);
+      if (freezing_ && project)
+        {
+          project->stop_playback();
+          project->stop_playback();     // rewind, like freeze_done()
+        }
+    }
+  freezing_ = false;
+  frozen_ = false;
+  if (!freeze_cachedir_.empty())
+    anklang_cachedir_cleanup (freeze_cachedir_);
+  freeze_cachedir_.clear();
+  emit_notify ("frozen");
+}
+
 DeviceP
 TrackImpl::access_device ()
 {
@@ -313,3 +546,119 @@ TrackImpl::ClipScout::update (const ClipScout &other)
 }
 
 } // Ase
+
+#include "testing.hh"
+#include <unistd.h>
+
+namespace { // Anon
+using namespace Ase;
+
+/// Capture `n_frames` of `chain` output from project playback in freewheel mode.
+static std::vector<float>
+freeze_test_capture (ProjectImpl &project, AudioChainP chain, int64 n_frames)
+{
+  AudioEngine &engine = chain->engine();
+  const String cachedir = anklang_cachedir_create();
+  TASSERT (!cachedir.empty());
+  const String filename = Path::join (cachedir, "capture.f32");
+  WaveWriterP raw_writer = wave_writer_create_raw (2, filename, 0600);
+  TASSERT (raw_writer);
+  struct Capture { bool done = false, failed = false; };
+  auto capture = std::make_shared<Capture>(); // outlives the test if the engine is stuck
+  auto *recorder = new AudioChain::FreezeRecorder();
+  recorder->writer = wave_writer_create_async (raw_writer, 2, engine.sample_rate());
+  recorder->n_channels = 2;
+  recorder->n_frames = n_frames;
+  AudioEngine *enginep = &engine;
+  recorder->done = [capture, enginep] (AudioChain::FreezeRecorder &recorder) {
+    enginep->pace_freewheel (recorder.writer, false);
+    capture->failed = !recorder.writer->close() || recorder.failed;
+    capture->done = true;
+  };
+  project.stop_playback();
+  project.stop_playback();      // rewind
+  engine.async_jobs += [chain, recorder] () {
+    chain->freeze_record (recorder);
+  };
+  engine.pace_freewheel (recorder->writer, true);
+  engine.set_freewheel (true);
+  project.start_playback();
+  const uint64 start_usecs = timestamp_realtime();
+  while (!capture->done && timestamp_realtime() < start_usecs + 20 * 1000000)
+    {
+      usleep (1500);
+      main_loop->iterate (false);
+    }
+  if (!capture->done)           // cancel, recorder is released via done()
+    engine.async_jobs += [chain] () { chain->freeze_record (nullptr); };
+  engine.set_freewheel (false);
+  project.stop_playback();
+  project.stop_playback();      // rewind, TrackImpl::freeze() needs the start position
+  std::vector<float> samples;
+  if (capture->done && !capture->failed)
+    {
+      Blob blob = Blob::from_file (filename);
+      const float *frames = (const float*) blob.data();
+      samples.assign (frames, frames + blob.size() / sizeof (float));
+    }
+  anklang_cachedir_cleanup (cachedir);
+  TASSERT (capture->done && !capture->failed);
+  return samples;
+}
+
+TEST_INTEGRITY (track_freeze_test);
+static void
+track_freeze_test()
+{
+  ProjectImplP project = ProjectImpl::create ("FreezeTest");
+  TrackP track = project->create_track();
+  TASSERT (track && track->access_device()->append_device ("Ase::Devices::BlepSynth"));
+  ClipS clips = track->launcher_clips();
+  TASSERT (clips.size() && clips[0]);
+  ClipNote note;
+  note.id = -1;
+  note.key = 60;
+  note.tick = 0;
+  note.duration = TRANSPORT_PPQN;
+  note.velocity = 1;
+  clips[0]->change_batch ({ note });
+  AudioChainP chain = std::dynamic_pointer_cast<AudioChain> (track->access_device()->_audio_processor());
+  TASSERT (chain);
+  // freezing renders the looping first clip twice, compare the whole span
+  TickSignature tsig (project->signature());
+  tsig.set_samplerate (chain->engine().sample_rate());
+  const int64 n_frames = tsig.sample_from_tick (4 * tsig.bar_ticks());
+  const std::vector<float> live = freeze_test_capture (*project, chain, n_frames);
+  TASSERT (live.size() == 2 * n_frames);
+  // freeze and capture cache playback, once the rewind reached the engine
+  const AudioTransport &transport = chain->engine().transport();
+  uint64 start_usecs = timestamp_realtime();
+  while ((project->is_playing() || transport.current_tick > 0) && timestamp_realtime() < start_usecs + 1000000)
+    usleep (1500);
+  TASSERT (track->freeze (true));
+  TASSERT (track->freeze (true)); // no-op while freezing
+  start_usecs = timestamp_realtime();
+  while (!track->frozen() && timestamp_realtime() < start_usecs + 20 * 1000000)
+    {
+      usleep (1500);
+      main_loop->iterate (false);
+    }
+  TASSERT (track->frozen());
+  const std::vector<float> cached = freeze_test_capture (*project, chain, n_frames);
+  TASSERT (cached.size() == live.size());
+  double energy = 0, maxdiff = 0;
+  for (size_t i = 0; i < live.size(); i++)
+    {
+      energy += live[i] * live[i];
+      maxdiff = std::max (maxdiff, std::abs (double (live[i]) - cached[i]));
+    }
+  TASSERT (energy > 1);
+  TCMP (maxdiff, <, 1e-4);
+  track->freeze (false);
+  TASSERT (!track->frozen());
+  project->discard();
+  if (main_config.engine->get_project() == project)
+    main_config.engine->set_project (nullptr);
+}
+
+} // Anon
@@ -3,6 +3,7 @@
 #define __ASE_TRACK_HH__
 
 #include <ase/device.hh>
+#include <ase/combo.hh>
 
 namespace Ase {
 
@@ -11,9 +12,15 @@ class TrackImpl : public DeviceImpl, public virtual Track {
   DeviceP      chain_, midi_prod_;
   ClipImplS    clips_;
   uint         midi_channel_ = 0;
+  String       freeze_cachedir_;
+  uint32       freeze_serial_ = 0;
+  bool         freezing_ = false, frozen_ = false;
   ASE_DEFINE_MAKE_SHARED (TrackImpl);
   friend class ProjectImpl;
   virtual         ~TrackImpl        ();
+  AudioChainP     audio_chain       () const;
+  void            freeze_done       (AudioChain::FreezeRecorder &recorder, const String &filename, AudioChain::FrozenCacheP cache);
+  bool            freeze_span       (const TickSignature &tsig, int64 *intro_ticks, int64 *period_ticks) const;
 protected:
   String          fallback_name     () const override;
   void            serialize         (WritNode &xs) override;
@@ -34,9 +41,13 @@ public:
   DeviceP         access_device     () override;
   MonitorP        create_monitor    (int32 ochannel) override;
   void            update_clips      ();
+  void            update_clip       (const ClipImpl &clip);
   ssize_t         clip_index        (const ClipImpl &clip) const;
   int             clip_succession   (const ClipImpl &clip) const;
   TelemetryFieldS telemetry         () const override;
+  bool            frozen            () const override      { return frozen_; }
+  bool            freeze            (bool onoff) override;
+  void            freeze_invalidate ();
   enum Cmd { STOP, START, };
   void            queue_cmd         (CallbackS&, Cmd cmd, double arg = 0);
   void            queue_cmd         (DCallbackS&, Cmd cmd);
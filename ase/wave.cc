@@ -11,6 +11,7 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <thread>
 #include <opus.h>
 #include <ogg/ogg.h>
 #include <FLAC/all.h>
@@ -240,6 +241,80 @@ wave_writer_create_wav (int rate, int channels, const String &filename, int mode
   return wavw;
 }
 
+// == RawWriter ==
+class RawWriterImpl final : public WaveWriter {
+  String   filename_;
+  uint32_t n_channels_ = 0;
+  int      fd_ = -1;
+  std::function<void()> flush_atquit;
+public:
+  RawWriterImpl()
+  {
+    flush_atquit = [this] () { close(); };
+    atquit_add (&flush_atquit);
+  }
+  ~RawWriterImpl()
+  {
+    atquit_del (&flush_atquit);
+    close();
+  }
+  bool
+  open (const String &filename, uint32_t n_channels, int mode)
+  {
+    assert_return (fd_ == -1, false);
+    assert_return (!filename.empty(), false);
+    assert_return (n_channels > 0, false);
+    fd_ = ::open (filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC, mode);
+    if (fd_ < 0)
+      return false;
+    filename_ = filename;
+    n_channels_ = n_channels;
+    return true;
+  }
+  String
+  name () const override
+  {
+    return filename_;
+  }
+  ssize_t
+  write (const float *frames, size_t n_frames) override
+  {
+    assert_return (fd_ >= 0, -1);
+    return_unless (n_frames, 0);
+    const char *bytes = (const char*) frames;
+    size_t n_bytes = n_frames * n_channels_ * sizeof (float);
+    while (n_bytes)
+      {
+        const ssize_t l = ::write (fd_, bytes, n_bytes);
+        if (l < 0 && errno == EINTR)
+          continue;
+        if (l <= 0)
+          return -1;
+        bytes += l;
+        n_bytes -= l;
+      }
+    return n_frames;
+  }
+  bool
+  close () override
+  {
+    return_unless (fd_ >= 0, false);
+    const bool ok = ::close (fd_) >= 0;
+    fd_ = -1;
+    return ok;
+  }
+};
+
+/// Create a WaveWriter for headerless interleaved float32 samples in host byte order.
+WaveWriterP
+wave_writer_create_raw (int channels, const String &filename, int mode)
+{
+  auto raww = std::make_shared<RawWriterImpl>();
+  if (raww->open (filename, channels, mode) == false)
+    return nullptr;
+  return raww;
+}
+
 // == OpusWriter ==
 String
 wave_writer_opus_version()
@@ -638,4 +713,138 @@ wave_writer_create_flac (int rate, int channels, const String &filename, int mod
   return ow;
 }
 
+// == AsyncWriter ==
+class AsyncWriter final : public AsyncWaveWriter {
+  WaveWriterP           writer_;
+  const uint            n_channels_ = 0;
+  const uint64          capacity_ = 0; // frames, power of 2
+  std::unique_ptr<float[]> ring_;
+  alignas (64) std::atomic<uint64> head_ = 0; // frames read by writer thread
+  alignas (64) std::atomic<uint64> tail_ = 0; // frames written by engine
+  std::atomic<uint64>   n_overflows_ = 0, n_dropped_ = 0, high_water_ = 0, n_failed_ = 0;
+  std::atomic<bool>     quit_ = false, failed_ = false;
+  ScopedSemaphore       sem_;
+  std::thread           thread_;
+  std::atomic<bool>     closed_ = false;
+  std::function<void()> flush_atquit;
+  void
+  drain ()
+  {
+    const uint64 tail = tail_.load (std::memory_order_acquire);
+    uint64 head = head_.load (std::memory_order_relaxed);
+    while (head < tail)
+      {
+        const uint64 offset = head & (capacity_ - 1);
+        const uint64 n_frames = std::min (tail - head, capacity_ - offset);
+        // after a failed write, frames are discarded and write() rejects new frames
+        if (ASE_UNLIKELY (failed_) || writer_->write (&ring_[offset * n_channels_], n_frames) < 0)
+          {
+            n_failed_ += n_frames;
+            failed_ = true;
+          }
+        head += n_frames;
+        head_.store (head, std::memory_order_release);
+      }
+  }
+  void
+  run ()
+  {
+    this_thread_set_name ("AseWaveWriter"); // max 16 chars
+    while (!quit_)
+      {
+        sem_.wait();
+        drain();
+      }
+    drain();
+  }
+public:
+  AsyncWriter (WaveWriterP writer, uint channels, uint64 capacity) :
+    writer_ (writer), n_channels_ (channels), capacity_ (capacity), ring_ (new float[capacity * channels])
+  {
+    flush_atquit = [this] () { close(); };
+    atquit_add (&flush_atquit); // runs before flush_atquit of writer_
+    thread_ = std::thread (&AsyncWriter::run, this);
+  }
+  ~AsyncWriter()
+  {
+    atquit_del (&flush_atquit);
+    close();
+  }
+  String
+  name () const override
+  {
+    return writer_->name();
+  }
+  /// Queue `n_frames` for writing, never blocks, rejects frames that exceed the ring space.
+  /// Returns -1 once the wrapped writer failed.
+  ssize_t
+  write (const float *frames, size_t n_frames) override
+  {
+    return_unless (n_frames, 0);
+    const uint64 tail = tail_.load (std::memory_order_relaxed);
+    const uint64 pending = tail - head_.load (std::memory_order_acquire);
+    return_unless (!quit_ && !failed_, -1);
+    if (ASE_UNLIKELY (pending + n_frames > capacity_))
+      {
+        n_overflows_ += 1;
+        n_dropped_ += n_frames;
+        return -1;
+      }
+    const uint64 offset = tail & (capacity_ - 1);
+    const uint64 n1 = std::min (uint64 (n_frames), capacity_ - offset);
+    std::copy (frames, frames + n1 * n_channels_, &ring_[offset * n_channels_]);
+    std::copy (frames + n1 * n_channels_, frames + n_frames * n_channels_, &ring_[0]);
+    tail_.store (tail + n_frames, std::memory_order_release);
+    if (pending + n_frames > high_water_.load (std::memory_order_relaxed))
+      high_water_.store (pending + n_frames, std::memory_order_relaxed);
+    sem_.post();
+    return n_frames;
+  }
+  size_t
+  writable () const override
+  {
+    return capacity_ - (tail_.load (std::memory_order_relaxed) - head_.load (std::memory_order_acquire));
+  }
+  Stats
+  stats () const override
+  {
+    Stats s;
+    s.n_frames = tail_;
+    s.n_overflows = n_overflows_;
+    s.n_dropped = n_dropped_;
+    s.high_water = high_water_;
+    s.capacity = capacity_;
+    s.n_failed = n_failed_;
+    return s;
+  }
+  /// Flush pending frames, stop the writer thread and close the wrapped writer.
+  bool
+  close () override
+  {
+    return_unless (!closed_.exchange (true), false);
+    quit_ = true;
+    sem_.post();
+    thread_.join();
+    if (n_overflows_)
+      printerr ("%s: AsyncWaveWriter: %u overflows, %u frames dropped, ring size: %u frames\n",
+                name(), uint64 (n_overflows_), uint64 (n_dropped_), capacity_);
+    if (n_failed_)
+      printerr ("%s: AsyncWaveWriter: failed to write %u frames\n", name(), uint64 (n_failed_));
+    const bool closed = writer_->close();
+    return closed && !n_failed_;
+  }
+};
+
+/// Create an AsyncWaveWriter which feeds `writer` from a writer thread, `ring_frames` is rounded up to a power of 2.
+AsyncWaveWriterP
+wave_writer_create_async (WaveWriterP writer, int channels, size_t ring_frames)
+{
+  assert_return (writer != nullptr, nullptr);
+  assert_return (channels > 0, nullptr);
+  uint64 capacity = 1024;
+  while (capacity < ring_frames)
+    capacity *= 2;
+  return std::make_shared<AsyncWriter> (writer, channels, capacity);
+}
+
 } // Ase
@@ -15,14 +15,34 @@ public:
 };
 using WaveWriterP = std::shared_ptr<WaveWriter>;
 
+/// WaveWriter that queues frames in a preallocated lock-free ring, drained by a writer thread.
+class AsyncWaveWriter : public WaveWriter {
+public:
+  struct Stats {
+    uint64 n_frames = 0;        ///< Frames queued for writing.
+    uint64 n_overflows = 0;     ///< Number of write() calls rejected due to insufficient ring space.
+    uint64 n_dropped = 0;       ///< Frames lost due to overflows.
+    uint64 high_water = 0;      ///< Maximum number of frames pending in the ring.
+    uint64 capacity = 0;        ///< Ring size in frames.
+    uint64 n_failed = 0;        ///< Frames the wrapped writer failed to write.
+  };
+  virtual Stats  stats          () const = 0;
+  virtual size_t writable       () const = 0; ///< Number of frames that fit into the ring.
+};
+using AsyncWaveWriterP = std::shared_ptr<AsyncWaveWriter>;
+
 WaveWriterP wave_writer_create_wav (int rate, int channels, const String &filename, int mode = 0664, uint8_t n_bits = 32);
 
+WaveWriterP wave_writer_create_raw (int channels, const String &filename, int mode = 0664);
+
 WaveWriterP wave_writer_create_opus (int rate, int channels, const String &filename, int mode = 0664, int complexity = 10, float bitrate = 128);
 String      wave_writer_opus_version ();
 
 WaveWriterP wave_writer_create_flac (int rate, int channels, const String &filename, int mode = 0664, int compresion = 9);
 String      wave_writer_flac_version ();
 
+AsyncWaveWriterP wave_writer_create_async (WaveWriterP writer, int channels, size_t ring_frames);
+
 } // Ase
 
 #endif // __ASE_WAVE_HH__
@@ -4,14 +4,19 @@
 
 #include <ase/randomhash.hh>
 #include <ase/datautils.hh>
+#include <ase/simd.hh>
 
 namespace Ase {
 namespace BlepUtils {
 
 using std::max;
 
+template<uint LANES> class OscBatch;
+
 class OscImpl
 {
+  template<uint LANES> friend class OscBatch;
+
   double rate_;
   double leaky_a;
 
@@ -139,20 +144,29 @@ public:
 
     unison_voices.resize (n_voices);
 
+    unison_spread (unison_voices, detune, stereo);
+    if (unison_voices_changed)
+      reset();
+  }
+  /* compute detune and stereo spread factors for a set of unison voices */
+  template<class Voices> static void
+  unison_spread (Voices& voices, float detune, float stereo)
+  {
+    const size_t n_voices = voices.size();
     bool left_channel = true; /* start spreading voices at the left channel */
-    for (size_t i = 0; i < unison_voices.size(); i++)
+    for (size_t i = 0; i < n_voices; i++)
       {
         if (n_voices == 1)
-          unison_voices[i].freq_factor = 1;
+          voices[i].freq_factor = 1;
         else
           {
             const float detune_cent = -detune / 2.0 + i / float (n_voices - 1) * detune;
-            unison_voices[i].freq_factor = pow (2, detune_cent / 1200);
+            voices[i].freq_factor = pow (2, detune_cent / 1200);
           }
         /* stereo spread factors */
         double left_factor, right_factor;
-        bool odd_n_voices = unison_voices.size() & 1;
-        if (odd_n_voices && i == unison_voices.size() / 2)  // odd number of voices: this voice is centered
+        bool odd_n_voices = voices.size() & 1;
+        if (odd_n_voices && i == voices.size() / 2)  // odd number of voices: this voice is centered
           {
             left_factor  = (1 - stereo) + stereo * 0.5;
             right_factor = (1 - stereo) + stereo * 0.5;
@@ -178,27 +192,30 @@ public:
          *      a factor of sqrt (2)
          */
         const double norm = sqrt (left_factor * left_factor + right_factor * right_factor) * sqrt (n_voices / 2.0);
-        unison_voices[i].left_factor  = left_factor / norm;
-        unison_voices[i].right_factor = right_factor / norm;
+        voices[i].left_factor  = left_factor / norm;
+        voices[i].right_factor = right_factor / norm;
       }
-    if (unison_voices_changed)
-      reset();
   }
   void
   set_rate (double rate)
   {
     rate_ = rate;
 
+    leaky_a = leaky_coefficient (rate_);
+  }
+  static double
+  leaky_coefficient (double rate)
+  {
     /* get leaky integrator constant for sample rate from ms (half-life time) */
     const double leaky_ms = 10;
-    leaky_a = pow (2.0, -1000.0 / (rate_ * leaky_ms));
+    return pow (2.0, -1000.0 / (rate * leaky_ms));
   }
   double
   rate()
   {
     return rate_;
   }
-  double
+  static double
   estimate_dc (double shape,
                double pulse_width,
                double sub,
@@ -290,6 +307,17 @@ public:
                      double sub,
                      double sub_width,
                      double sync_factor)
+  {
+    for (auto& voice : unison_voices)
+      reset_voice (voice, shape, pulse_width, sub, sub_width, sync_factor);
+  }
+  template<class Voice> static void
+  reset_voice (Voice& voice,
+               double shape,
+               double pulse_width,
+               double sub,
+               double sub_width,
+               double sync_factor)
   {
     const double bound_a = sub_width * pulse_width;
     const double bound_b = 2 * sub_width * pulse_width + 1 - sub_width - pulse_width;
@@ -364,53 +392,50 @@ public:
 
     const double dc = (dc_base * (int) sync_factor + dc_sync) / sync_factor;
 
-    for (auto& voice : unison_voices)
-      {
-        double dest_phase = voice.master_phase;
+    double dest_phase = voice.master_phase;
 
-        double last_value; /* leaky integrator state */
+    double last_value; /* leaky integrator state */
 
-        dest_phase *= sync_factor;
-        dest_phase -= (int) dest_phase;
+    dest_phase *= sync_factor;
+    dest_phase -= (int) dest_phase;
 
-        voice.slave_phase = dest_phase;
+    voice.slave_phase = dest_phase;
 
-        /* compute voice state and initial value without dc */
-        if (dest_phase < bound_a)
-          {
-            double frac = (bound_a - dest_phase) / bound_a;
-            last_value = a1 * frac + a2 * (1 - frac);
+    /* compute voice state and initial value without dc */
+    if (dest_phase < bound_a)
+      {
+        double frac = (bound_a - dest_phase) / bound_a;
+        last_value = a1 * frac + a2 * (1 - frac);
 
-            voice.state = State::A;
-          }
-        else if (dest_phase < bound_b)
-          {
-            double frac = (bound_b - dest_phase) / (bound_b - bound_a);
-            last_value = b1 * frac + b2 * (1 - frac);
+        voice.state = State::A;
+      }
+    else if (dest_phase < bound_b)
+      {
+        double frac = (bound_b - dest_phase) / (bound_b - bound_a);
+        last_value = b1 * frac + b2 * (1 - frac);
 
-            voice.state = State::B;
-          }
-        else if (dest_phase < bound_c)
-          {
-            double frac = (bound_c - dest_phase) / (bound_c - bound_b);
-            last_value = c1 * frac + c2 * (1 - frac);
+        voice.state = State::B;
+      }
+    else if (dest_phase < bound_c)
+      {
+        double frac = (bound_c - dest_phase) / (bound_c - bound_b);
+        last_value = c1 * frac + c2 * (1 - frac);
 
-            voice.state = State::C;
-          }
-        else
-          {
-            double frac = (bound_d - dest_phase) / (bound_d - bound_c);
-            last_value = d1 * frac + d2 * (1 - frac);
+        voice.state = State::C;
+      }
+    else
+      {
+        double frac = (bound_d - dest_phase) / (bound_d - bound_c);
+        last_value = d1 * frac + d2 * (1 - frac);
 
-            voice.state = State::D;
-          }
-        voice.last_value    = last_value - dc;
-        voice.last_dc       = dc;
-        voice.current_level = last_value - 1;
+        voice.state = State::D;
       }
+    voice.last_value    = last_value - dc;
+    voice.last_dc       = dc;
+    voice.current_level = last_value - 1;
   }
-  void
-  insert_blep (UnisonVoice& voice, double frac, double weight)
+  template<class Voice> static void
+  insert_blep (Voice& voice, double frac, double weight)
   {
     int pos = frac * OVERSAMPLE;
     const float inter_frac = frac * OVERSAMPLE - pos;
@@ -427,13 +452,13 @@ public:
         pos += OVERSAMPLE;
       }
   }
-  void
-  insert_future_delta (UnisonVoice& voice, double weight)
+  template<class Voice> static void
+  insert_future_delta (Voice& voice, double weight)
   {
     voice.future[voice.future_pos + WSHIFT] += weight;
   }
 
-  double
+  static double
   clamp (double d, double min, double max)
   {
     return ASE_CLAMP (d, min, max);
@@ -444,8 +469,8 @@ public:
    * when master oscillator sync occurs, only return true if this point in time is
    * before master oscillator sync
    */
-  bool
-  check_slave_before_master (UnisonVoice& voice, double target_phase, double sync_factor)
+  template<class Voice> static bool
+  check_slave_before_master (Voice& voice, double target_phase, double sync_factor)
   {
     if (voice.slave_phase > target_phase)
       {
@@ -461,6 +486,110 @@ public:
       }
     return false;
   }
+  /* advance the waveform state machine of a voice after its phases have been incremented,
+   * inserting bleps for all discontinuities that occurred within the current sample
+   */
+  template<class Voice> static void
+  process_state (Voice& voice, double master_inc, double slave_inc, double saw_delta,
+                 double shape, double pulse_width, double sub, double sub_width, double sync_factor)
+  {
+    bool state_changed;
+    do
+      {
+        state_changed = false;
+
+        if (voice.state == State::A)
+          {
+            const double bound_a = sub_width * pulse_width;
+
+            if (check_slave_before_master (voice, bound_a, sync_factor))
+              {
+                const double slave_frac = (voice.slave_phase - bound_a) / slave_inc;
+
+                const double jump_a = 2.0 * (shape * (1 - sub) - sub);
+                const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_a;
+                const double blep_height = jump_a + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
+
+                insert_blep (voice, slave_frac, blep_height);
+                voice.current_level += blep_height;
+                voice.state = State::B;
+                state_changed = true;
+              }
+          }
+        if (voice.state == State::B)
+          {
+            const double bound_b = 2 * sub_width * pulse_width + 1 - sub_width - pulse_width;
+
+            if (check_slave_before_master (voice, bound_b, sync_factor))
+              {
+                const double slave_frac = (voice.slave_phase - bound_b) / slave_inc;
+
+                const double jump_ab = 2.0 * ((shape + 1) * (1 - sub) - sub);
+                const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_b;
+                const double blep_height = jump_ab + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
+
+                insert_blep (voice, slave_frac, blep_height);
+                voice.current_level += blep_height;
+                voice.state = State::C;
+                state_changed = true;
+              }
+          }
+        if (voice.state == State::C)
+          {
+            const double bound_c = sub_width * pulse_width + (1 - sub_width);
+
+            if (check_slave_before_master (voice, bound_c, sync_factor))
+              {
+                const double slave_frac = (voice.slave_phase - bound_c) / slave_inc;
+
+                const double jump_abc = 2.0 * (2 * shape + 1) * (1 - sub);
+                const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_c;
+                const double blep_height = jump_abc + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
+
+                insert_blep (voice, slave_frac, blep_height);
+                voice.current_level += blep_height;
+                voice.state = State::D;
+                state_changed = true;
+              }
+          }
+        if (voice.state == State::D)
+          {
+            if (check_slave_before_master (voice, 1, sync_factor))
+              {
+                voice.slave_phase -= 1;
+
+                const double slave_frac = voice.slave_phase / slave_inc;
+
+                voice.current_level += (1 - slave_frac) * saw_delta;
+
+                insert_blep (voice, slave_frac, -voice.current_level);
+
+                voice.current_level = saw_delta * slave_frac - saw_delta;
+                voice.state = State::A;
+                state_changed = true;
+              }
+          }
+        if (!state_changed && voice.master_phase > 1)
+          {
+            voice.master_phase -= 1;
+
+            const double master_frac = voice.master_phase / master_inc;
+
+            const double new_slave_phase = voice.master_phase * sync_factor;
+
+            voice.current_level += (1 - master_frac) * saw_delta;
+
+            insert_blep (voice, master_frac, -voice.current_level);
+
+            voice.current_level = saw_delta * master_frac - saw_delta;
+            voice.slave_phase = new_slave_phase;
+
+            voice.state = State::A;
+            state_changed = true;
+          }
+      }
+    while (state_changed); // rerun all state checks if state was modified
+  }
   void
   process_sample_stereo (float *left_out, float *right_out, unsigned int n_values,
                          const float *freq_in = nullptr,
@@ -525,102 +654,7 @@ public:
             voice.master_phase += master_inc;
             voice.slave_phase  += slave_inc;
 
-            bool state_changed;
-            do
-              {
-                state_changed = false;
-
-                if (voice.state == State::A)
-                  {
-                    const double bound_a = sub_width * pulse_width;
-
-                    if (check_slave_before_master (voice, bound_a, sync_factor))
-                      {
-                        const double slave_frac = (voice.slave_phase - bound_a) / slave_inc;
-
-                        const double jump_a = 2.0 * (shape * (1 - sub) - sub);
-                        const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_a;
-                        const double blep_height = jump_a + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
-
-                        insert_blep (voice, slave_frac, blep_height);
-                        voice.current_level += blep_height;
-                        voice.state = State::B;
-                        state_changed = true;
-                      }
-                  }
-                if (voice.state == State::B)
-                  {
-                    const double bound_b = 2 * sub_width * pulse_width + 1 - sub_width - pulse_width;
-
-                    if (check_slave_before_master (voice, bound_b, sync_factor))
-                      {
-                        const double slave_frac = (voice.slave_phase - bound_b) / slave_inc;
-
-                        const double jump_ab = 2.0 * ((shape + 1) * (1 - sub) - sub);
-                        const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_b;
-                        const double blep_height = jump_ab + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
-
-                        insert_blep (voice, slave_frac, blep_height);
-                        voice.current_level += blep_height;
-                        voice.state = State::C;
-                        state_changed = true;
-                      }
-                  }
-                if (voice.state == State::C)
-                  {
-                    const double bound_c = sub_width * pulse_width + (1 - sub_width);
-
-                    if (check_slave_before_master (voice, bound_c, sync_factor))
-                      {
-                        const double slave_frac = (voice.slave_phase - bound_c) / slave_inc;
-
-                        const double jump_abc = 2.0 * (2 * shape + 1) * (1 - sub);
-                        const double saw = -4.0 * (shape + 1) * (1 - sub) * bound_c;
-                        const double blep_height = jump_abc + saw - (voice.current_level + (1 - slave_frac) * saw_delta);
-
-                        insert_blep (voice, slave_frac, blep_height);
-                        voice.current_level += blep_height;
-                        voice.state = State::D;
-                        state_changed = true;
-                      }
-                  }
-                if (voice.state == State::D)
-                  {
-                    if (check_slave_before_master (voice, 1, sync_factor))
-                      {
-                        voice.slave_phase -= 1;
-
-                        const double slave_frac = voice.slave_phase / slave_inc;
-
-                        voice.current_level += (1 - slave_frac) * saw_delta;
-
-                        insert_blep (voice, slave_frac, -voice.current_level);
-
-                        voice.current_level = saw_delta * slave_frac - saw_delta;
-                        voice.state = State::A;
-                        state_changed = true;
-                      }
-                  }
-                if (!state_changed && voice.master_phase > 1)
-                  {
-                    voice.master_phase -= 1;
-
-                    const double master_frac = voice.master_phase / master_inc;
-
-                    const double new_slave_phase = voice.master_phase * sync_factor;
-
-                    voice.current_level += (1 - master_frac) * saw_delta;
-
-                    insert_blep (voice, master_frac, -voice.current_level);
-
-                    voice.current_level = saw_delta * master_frac - saw_delta;
-                    voice.slave_phase = new_slave_phase;
-
-                    voice.state = State::A;
-                    state_changed = true;
-                  }
-              }
-            while (state_changed); // rerun all state checks if state was modified
+            process_state (voice, master_inc, slave_inc, saw_delta, shape, pulse_width, sub, sub_width, sync_factor);
 
             if (voice.dc_steps > 0)
               {
@@ -649,6 +683,310 @@ public:
   }
 };
 
+/* OscImpl for several independent synthesizer voices, one voice per SIMD lane
+ *
+ * All voices share the waveform, sync and unison parameters, only the base frequency
+ * is set per lane. The state of each unison voice is kept as struct of arrays, so phase
+ * accumulation, dc correction, leaky integration and the stereo mix of all lanes are
+ * computed with vector instructions. The oscillator state needs double precision, so
+ * lanes are processed in groups that fit into a vector register. Waveform discontinuities
+ * only occur every few samples per lane, these are handled per lane with the OscImpl
+ * state machine, so the output matches OscImpl up to floating point contraction.
+ */
+template<uint LANES>
+class OscBatch
+{
+  static constexpr uint GROUP   = std::min (LANES, std::max (SIMD_FLOAT_LANES / 2, 2u));
+  static constexpr uint NGROUPS = LANES / GROUP;
+
+  using State   = OscImpl::State;
+  using DoubleV = SimdVector<double, GROUP>;
+  using FloatV  = SimdVector<float, GROUP>;
+
+  static const int WIDTH  = OscImpl::WIDTH;
+  static const int WSHIFT = OscImpl::WSHIFT;
+
+  struct alignas (64) Unison
+  {
+    double freq_factor   = 1;
+    double left_factor   = 1;
+    double right_factor  = 0;
+
+    double master_phase[LANES] = {};
+    double slave_phase[LANES] = {};
+    double last_value[LANES] = {};
+    double current_level[LANES] = {};
+    double last_dc[LANES] = {};
+    double dc_delta[LANES] = {};
+    double dc_steps[LANES] = {};
+    State  state[LANES] = {};
+
+    /* lane groups are processed one after another, each needs its own read position */
+    float  future[NGROUPS][WIDTH * 2][GROUP] = {};
+    int    future_pos[NGROUPS] = {};
+  };
+  /* OscImpl::UnisonVoice interface to one lane, used for the per lane state machine */
+  struct LaneVoice
+  {
+    double& master_phase;
+    double& slave_phase;
+    double& last_value;
+    double& current_level;
+    double& last_dc;
+    State&  state;
+    struct Future {
+      float (*rows)[GROUP];
+      uint column;
+      float& operator[] (int i) { return rows[i][column]; }
+    } future;
+    int     future_pos;
+  };
+  static LaneVoice
+  lane_voice (Unison& u, uint lane)
+  {
+    const uint g = lane / GROUP;
+    return { u.master_phase[lane], u.slave_phase[lane], u.last_value[lane], u.current_level[lane], u.last_dc[lane],
+             u.state[lane], { u.future[g], lane % GROUP }, u.future_pos[g] };
+  }
+
+  std::vector<Unison> unison_voices;
+  double              rate_ = 48000;
+  double              leaky_a_ = OscImpl::leaky_coefficient (48000);
+  uint64              need_reset_voice_state_ = 0; /* bit mask of lanes */
+public:
+  double frequency_base[LANES] = {};
+  double frequency_factor = 1;
+
+  double shape_base       = 0; // 0 = saw, range [-1:1]
+  double pulse_width_base = 0.5;
+  double sync_base        = 0;
+  double sub_base         = 0;
+  double sub_width_base   = 0.5;
+
+  static_assert (LANES <= 64 && LANES % GROUP == 0);
+
+  OscBatch()
+  {
+    unison_voices.reserve (16); // avoid reallocations from set_unison()
+    set_unison (1, 0, 0);
+  }
+  void
+  set_rate (double rate)
+  {
+    if (rate_ != rate)
+      {
+        rate_ = rate;
+        leaky_a_ = OscImpl::leaky_coefficient (rate_);
+      }
+  }
+  void
+  set_unison (size_t n_voices, float detune, float stereo)
+  {
+    const bool unison_voices_changed = unison_voices.size() != n_voices;
+
+    unison_voices.resize (n_voices);
+
+    OscImpl::unison_spread (unison_voices, detune, stereo);
+    if (unison_voices_changed)
+      for (uint lane = 0; lane < LANES; lane++)
+        reset_lane (lane);
+  }
+  /* like OscImpl::reset() for a single lane */
+  void
+  reset_lane (uint lane)
+  {
+    const bool randomize_phase = unison_voices.size() > 1;
+
+    for (auto& u : unison_voices)
+      {
+        for (int i = 0; i < WIDTH * 2; i++)
+          u.future[lane / GROUP][i][lane % GROUP] = 0;
+        u.dc_steps[lane] = 0;
+        u.dc_delta[lane] = 0;
+        u.master_phase[lane] = randomize_phase ? random_frange (0, 1) : 0; // randomize start phase for true unison
+      }
+    need_reset_voice_state_ |= uint64 (1) << lane;
+  }
+  /* continue the voice of `osc` in `lane`, osc must use the same unison setup */
+  void
+  import_lane (uint lane, const OscImpl& osc)
+  {
+    ASE_ASSERT_RETURN (lane < LANES);
+    ASE_ASSERT_RETURN (osc.unison_voices.size() == unison_voices.size());
+
+    set_rate (osc.rate_);
+    frequency_base[lane] = osc.frequency_base;
+    for (size_t v = 0; v < unison_voices.size(); v++)
+      {
+        const OscImpl::UnisonVoice& src = osc.unison_voices[v];
+        Unison& u = unison_voices[v];
+
+        u.master_phase[lane]  = src.master_phase;
+        u.slave_phase[lane]   = src.slave_phase;
+        u.last_value[lane]    = src.last_value;
+        u.current_level[lane] = src.current_level;
+        u.last_dc[lane]       = src.last_dc;
+        u.dc_delta[lane]      = src.dc_delta;
+        u.dc_steps[lane]      = src.dc_steps;
+        u.state[lane]         = src.state;
+
+        /* pending bleps only extend WIDTH samples past the read position, align them to our position */
+        LaneVoice voice = lane_voice (u, lane);
+        for (int i = 0; i < WIDTH * 2; i++)
+          voice.future[i] = 0;
+        for (int i = 0; i < WIDTH; i++)
+          voice.future[voice.future_pos + i] = src.future[src.future_pos + i];
+      }
+    if (osc.need_reset_voice_state)
+      need_reset_voice_state_ |= uint64 (1) << lane;
+    else
+      need_reset_voice_state_ &= ~(uint64 (1) << lane);
+  }
+  /* render n_values frames of all lanes, output is interleaved: left_out[frame * LANES + lane] */
+  void
+  process_sample_stereo (float *left_out, float *right_out, uint n_values)
+  {
+    floatfill (left_out, 0.0, n_values * LANES);
+    floatfill (right_out, 0.0, n_values * LANES);
+
+    const double pulse_width = OscImpl::clamp (pulse_width_base, 0.01, 0.99);
+    const double sub         = OscImpl::clamp (sub_base, 0.0, 1.0);
+    const double sub_width   = OscImpl::clamp (sub_width_base, 0.01, 0.99);
+    const double shape       = OscImpl::clamp (shape_base, -1.0, 1.0);
+    const double sync_factor = fast_exp2 (OscImpl::clamp (sync_base, 0.0, 60.0) / 12);
+
+    /* reset needs parameters, so we need to do it here */
+    for (uint lane = 0; need_reset_voice_state_; lane++)
+      if (need_reset_voice_state_ & (uint64 (1) << lane))
+        {
+          for (auto& u : unison_voices)
+            {
+              LaneVoice voice = lane_voice (u, lane);
+              OscImpl::reset_voice (voice, shape, pulse_width, sub, sub_width, sync_factor);
+            }
+          need_reset_voice_state_ &= ~(uint64 (1) << lane);
+        }
+
+    for (auto& u : unison_voices)
+      for (uint g = 0; g < NGROUPS; g++)
+        process_group (u, g, left_out, right_out, n_values, shape, pulse_width, sub, sub_width, sync_factor);
+  }
+private:
+  void
+  process_group (Unison& u, const uint g, float *left_out, float *right_out, uint n_values,
+                 double shape, double pulse_width, double sub, double sub_width, double sync_factor)
+  {
+    /* without modulation inputs, all parameters are constant during the block */
+    const double dc = OscImpl::estimate_dc (shape, pulse_width, sub, sub_width, sync_factor);
+    const double bounds[4] = {
+      sub_width * pulse_width,                                   // State::A
+      2 * sub_width * pulse_width + 1 - sub_width - pulse_width, // State::B
+      sub_width * pulse_width + (1 - sub_width),                 // State::C
+      1,                                                         // State::D
+    };
+
+    /* dc substampling according to control frequency (cpu/quality trade off) */
+    const int dc_steps = max (irintf (rate_ / 4000), 1);
+
+    const uint lane0 = g * GROUP;
+    const double master_freq2inc = 0.5 / rate_ * u.freq_factor;
+
+    DoubleV master_inc, next_bound;
+    for (uint j = 0; j < GROUP; j++)
+      {
+        const double master_freq = frequency_factor * frequency_base[lane0 + j];
+        master_inc[j] = master_freq * master_freq2inc;
+        next_bound[j] = bounds[int (u.state[lane0 + j])];
+      }
+    const DoubleV slave_inc = master_inc * sync_factor;
+    const DoubleV saw_delta = -4.0 * slave_inc * (shape + 1) * (1 - sub);
+
+    DoubleV master_phase, slave_phase, last_value, current_level, last_dc, dc_delta, dc_count;
+    simd_load (master_phase, u.master_phase + lane0);
+    simd_load (slave_phase, u.slave_phase + lane0);
+    simd_load (last_value, u.last_value + lane0);
+    simd_load (current_level, u.current_level + lane0);
+    simd_load (last_dc, u.last_dc + lane0);
+    simd_load (dc_delta, u.dc_delta + lane0);
+    simd_load (dc_count, u.dc_steps + lane0);
+
+    float (*future)[GROUP] = u.future[g];
+    int future_pos = u.future_pos[g];
+    for (uint n = 0; n < n_values; n++)
+      {
+        master_phase += master_inc;
+        slave_phase  += slave_inc;
+
+        /* lanes that may cross a waveform boundary run through the state machine */
+        const auto crossing = (slave_phase > next_bound) | (master_phase > 1.0);
+        if (ASE_UNLIKELY (simd_any (crossing)))
+          {
+            simd_store (u.master_phase + lane0, master_phase);
+            simd_store (u.slave_phase + lane0, slave_phase);
+            simd_store (u.current_level + lane0, current_level);
+            for (uint j = 0; j < GROUP; j++)
+              if (crossing[j])
+                {
+                  LaneVoice voice = lane_voice (u, lane0 + j);
+                  voice.future_pos = future_pos;
+                  OscImpl::process_state (voice, master_inc[j], slave_inc[j], saw_delta[j],
+                                          shape, pulse_width, sub, sub_width, sync_factor);
+                  next_bound[j] = bounds[int (u.state[lane0 + j])];
+                }
+            simd_load (master_phase, u.master_phase + lane0);
+            simd_load (slave_phase, u.slave_phase + lane0);
+            simd_load (current_level, u.current_level + lane0);
+          }
+
+        const auto dc_update = dc_count <= 0.0;
+        dc_delta = dc_update ? (last_dc - dc) / dc_steps : dc_delta;
+        last_dc  = dc_update ? DoubleV{} + dc : last_dc;
+        dc_count = dc_update ? DoubleV{} + (dc_steps - 1) : dc_count - 1;
+
+        current_level += saw_delta;
+
+        /* insert_future_delta(): align with the impulses */
+        FloatV future_delta, value_in;
+        simd_load (future_delta, future[future_pos + WSHIFT]);
+        future_delta = __builtin_convertvector (__builtin_convertvector (future_delta, DoubleV) + (saw_delta + dc_delta), FloatV);
+        simd_store (future[future_pos + WSHIFT], future_delta);
+
+        /* pop_future() */
+        simd_load (value_in, future[future_pos++]);
+        if (future_pos == WIDTH)
+          {
+            for (int i = 0; i < WIDTH; i++)
+              {
+                std::copy_n (future[WIDTH + i], GROUP, future[i]);
+                std::fill_n (future[WIDTH + i], GROUP, 0.f);
+              }
+            future_pos = 0;
+          }
+
+        /* leaky integration */
+        const DoubleV value = leaky_a_ * last_value + __builtin_convertvector (value_in, DoubleV);
+        last_value = value;
+
+        FloatV left, right;
+        float *lout = left_out + n * LANES + lane0, *rout = right_out + n * LANES + lane0;
+        simd_load (left, lout);
+        simd_load (right, rout);
+        left  = __builtin_convertvector (__builtin_convertvector (left, DoubleV) + value * u.left_factor, FloatV);
+        right = __builtin_convertvector (__builtin_convertvector (right, DoubleV) + value * u.right_factor, FloatV);
+        simd_store (lout, left);
+        simd_store (rout, right);
+      }
+    u.future_pos[g] = future_pos;
+    simd_store (u.master_phase + lane0, master_phase);
+    simd_store (u.slave_phase + lane0, slave_phase);
+    simd_store (u.last_value + lane0, last_value);
+    simd_store (u.current_level + lane0, current_level);
+    simd_store (u.last_dc + lane0, last_dc);
+    simd_store (u.dc_delta + lane0, dc_delta);
+    simd_store (u.dc_steps + lane0, dc_count);
+  }
+};
+
 class Osc /* simple interface to OscImpl */
 {
   double
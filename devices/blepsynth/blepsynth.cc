@@ -1,11 +1,14 @@
 // This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
 #include "ase/processor.hh"
 #include "ase/midievent.hh"
+#include "ase/engine.hh"
 #include "devices/blepsynth/bleposc.hh"
 #include "devices/blepsynth/laddervcf.hh"
 #include "devices/blepsynth/skfilter.hh"
 #include "devices/blepsynth/linearsmooth.hh"
+#include "ase/simd.hh"
 #include "ase/internal.hh"
+#include "ase/testing.hh"
 
 // based on liquidsfz envelope.hh
 
@@ -249,6 +252,94 @@ private:
 
     *iptr = i;
   }
+  void
+  update_sustain()
+  {
+    if (params_changed_)
+      {
+        if (std::abs (sustain_level_ - level_) > 1e-5)
+          {
+            sustain_steps_ = std::max<int> (0.020f * rate_, 1);
+            c_ = (sustain_level_ - level_) / sustain_steps_;
+          }
+        else
+          {
+            sustain_steps_ = 0;
+          }
+        params_changed_ = false;
+      }
+  }
+  /* describe the current stage as level = (a * level + b) * level + c, which ends
+   * once sign * level exceeds limit or after count samples, returns the start level
+   */
+  float
+  segment (float *a, float *b, float *c, float *sign, float *limit, float *count)
+  {
+    *sign  = 1;
+    *limit = INFINITY;
+    *count = INFINITY;
+    switch (state_)
+      {
+      case State::ATTACK:
+        compute_slope_params (attack_, 0, 1);
+        *limit = 1;
+        break;
+      case State::DECAY:
+        compute_slope_params (decay_, 1, sustain_level_);
+        *sign  = -1;
+        *limit = -sustain_level_;
+        break;
+      case State::RELEASE:
+        compute_slope_params (release_, release_start_, 0);
+        *sign  = -1;
+        *limit = -1e-5f;
+        break;
+      case State::SUSTAIN:
+        update_sustain();
+        *a = 0;
+        *b = 1;
+        *c = sustain_steps_ ? c_ : 0;
+        if (sustain_steps_)
+          *count = sustain_steps_;
+        return level_;
+      case State::DONE:
+        *a = *b = *c = 0;
+        return 0;
+      }
+    /* linear and exponential shapes use a = 0 (and b = 1) */
+    *a = a_;
+    *b = b_;
+    *c = c_;
+    return level_;
+  }
+  /* advance to the next stage once the current segment() ended */
+  void
+  segment_done()
+  {
+    switch (state_)
+      {
+      case State::ATTACK:
+        level_          = 1;
+        state_          = State::DECAY;
+        params_changed_ = true;
+        break;
+      case State::DECAY:
+        state_          = State::SUSTAIN;
+        level_          = sustain_level_;
+        params_changed_ = true;
+        break;
+      case State::RELEASE:
+        state_ = State::DONE;
+        level_ = 0;
+        break;
+      case State::SUSTAIN: /* sustain smoothing */
+        sustain_steps_ = 0;
+        level_         = sustain_level_;
+        break;
+      case State::DONE:
+        break;
+      }
+  }
   template<State STATE>
   void
   process (uint *iptr, float *samples, uint n_samples)
@@ -284,19 +375,7 @@ public:
       }
     if (state_ == State::SUSTAIN)
       {
-        if (params_changed_)
-          {
-            if (std::abs (sustain_level_ - level_) > 1e-5)
-              {
-                sustain_steps_ = std::max<int> (0.020f * rate_, 1);
-                c_ = (sustain_level_ - level_) / sustain_steps_;
-              }
-            else
-              {
-                sustain_steps_ = 0;
-              }
-            params_changed_ = false;
-          }
+        update_sustain();
         while (sustain_steps_ && i < n_samples) /* sustain smoothing */
           {
             samples[i++] = level_;
@@ -314,6 +393,55 @@ public:
           samples[i++] = 0;
       }
   }
+  /* process the envelopes of LANES voices at once, output is interleaved: samples[i * LANES + lane],
+   * lanes without envelope produce zeros
+   */
+  template<uint LANES> static void
+  process_lanes (FlexADSR *const *envs, float *samples, uint n_samples)
+  {
+    using FloatV = SimdVector<float, LANES>;
+    FloatV level, a, b, c, sign, limit, count;
+    auto start_segment = [&] (uint lane) {
+      float la = 0, lb = 0, lc = 0, lsign = 1, llimit = INFINITY, lcount = INFINITY, llevel = 0;
+      if (envs[lane])
+        llevel = envs[lane]->segment (&la, &lb, &lc, &lsign, &llimit, &lcount);
+      level[lane] = llevel;
+      a[lane]     = la;
+      b[lane]     = lb;
+      c[lane]     = lc;
+      sign[lane]  = lsign;
+      limit[lane] = llimit;
+      count[lane] = lcount;
+    };
+    for (uint lane = 0; lane < LANES; lane++)
+      start_segment (lane);
+
+    for (uint i = 0; i < n_samples; i++)
+      {
+        simd_store (samples + i * LANES, level);
+        level = (a * level + b) * level + c;
+        count -= 1;
+
+        const auto segment_end = (level * sign > limit) | (count <= 0);
+        if (ASE_UNLIKELY (simd_any (segment_end)))
+          for (uint lane = 0; lane < LANES; lane++)
+            if (segment_end[lane] && envs[lane])
+              {
+                envs[lane]->level_ = level[lane];
+                envs[lane]->segment_done();
+                start_segment (lane);
+              }
+      }
+    for (uint lane = 0; lane < LANES; lane++)
+      if (envs[lane])
+        {
+          FlexADSR *env = envs[lane];
+          if (env->state_ != State::DONE)
+            env->level_ = level[lane];
+          if (env->state_ == State::SUSTAIN && env->sustain_steps_)
+            env->sustain_steps_ = count[lane];
+        }
+  }
   bool
   is_constant() const
   {
@@ -328,8 +456,69 @@ public:
   {
     return state_ == State::DONE;
   }
+  float
+  level() const
+  {
+    return level_;
+  }
 };
 
+// == Voice Stealing ==
+enum VoiceStealing { STEAL_RELEASED, STEAL_OLDEST, STEAL_QUIETEST };
+
+/* state of a playing voice that decides if it is reused for a new note */
+struct StealCandidate
+{
+  bool   released = false;  // received note off
+  bool   fading = false;    // already stolen, fading out
+  uint64 note_id = 0;       // note on order, lower values are older
+  float  level = 0;         // current output level
+};
+
+/* pick the index of the voice to steal from `candidates` according to `mode`, returns `n` if none is left;
+ * voices that already fade out are never picked, their pending note would be lost
+ */
+static size_t
+pick_steal_victim (const StealCandidate *candidates, size_t n, int mode)
+{
+  size_t victim = n;
+  for (size_t i = 0; i < n; i++)
+    {
+      const StealCandidate &c = candidates[i];
+      if (c.fading)
+        continue;
+      else if (victim == n)
+        victim = i;
+      else if (mode == STEAL_QUIETEST)
+        {
+          if (c.level < candidates[victim].level)
+            victim = i;
+        }
+      else if (mode == STEAL_RELEASED && c.released != candidates[victim].released)
+        {
+          if (c.released)
+            victim = i;
+        }
+      else if (c.note_id < candidates[victim].note_id)
+        victim = i;
+    }
+  return victim;
+}
+
+/* fade out a stolen voice, by scaling `n_frames` of `env` (every `stride` floats) with a linear ramp
+ * that reaches 0 after `fade_length` frames, `*fade_frames` counts the frames left until silence
+ */
+static void
+steal_fade (float *env, uint stride, uint n_frames, uint *fade_frames, uint fade_length)
+{
+  const float step = 1.0f / fade_length;
+  for (uint i = 0; i < n_frames; i++)
+    {
+      env[i * stride] *= *fade_frames * step;
+      *fade_frames -= *fade_frames > 0;
+    }
+}
+
 // == BlepSynth ==
 // subtractive synth based on band limited steps (MinBLEP):
 // - aliasing-free square/saw and similar sounds including hard sync
@@ -345,23 +534,72 @@ class BlepSynth : public AudioProcessor {
     FIL_ATTACK, FIL_DECAY, FIL_SUSTAIN, FIL_RELEASE, FIL_CUT_MOD,
     MIX, VEL_TRACK, POST_GAIN,
     KEY_C, KEY_D, KEY_E, KEY_F, KEY_G,
+    POLYPHONY, VOICE_STEALING, LOAD_GOVERNOR, FILTER_LANES,
   };
 
   enum { FILTER_TYPE_BYPASS, FILTER_TYPE_LADDER, FILTER_TYPE_SKFILTER };
   int filter_type_ = 0;
+  bool filter_lanes_ = false;   // filter voice batches with LadderVCFLanes / SKFilterLanes instead of per voice
+
+  static constexpr uint MAX_VOICES = 64;        // preallocated, POLYPHONY selects how many are used
+  static constexpr float STEAL_FADE_SECONDS = 0.003; // fade-out of stolen voices before they restart
+  uint   polyphony_ = 32;
+  int    voice_stealing_ = STEAL_RELEASED;
+  uint64 note_counter_ = 0;
+
+  /* the load governor lowers unison voices first and polyphony second while the engine
+   * DSP load stays above GOVERNOR_HIGH_LOAD, and restores them below GOVERNOR_LOW_LOAD
+   */
+  static constexpr float GOVERNOR_HIGH_LOAD = 0.85;
+  static constexpr float GOVERNOR_LOW_LOAD = 0.6;
+  static constexpr uint  GOVERNOR_MAX_UNISON = 16;
+  bool   governor_ = false;
+  uint   governor_unison_ = GOVERNOR_MAX_UNISON;    // upper bound for unison voices
+  uint   governor_voices_ = MAX_VOICES;             // upper bound for polyphony
+  uint   governor_frames_ = 0;                      // frames since last governor step
 
   static constexpr int CUTOFF_MIN_MIDI = 15;
   static constexpr int CUTOFF_MAX_MIDI = 144;
 
+  /* block-constant parameter values and the quantities derived from them, updated from
+   * adjust_param() only, so rendering voices needs no get_param() lookups or conversions
+   */
+  struct OscParams
+  {
+    double shape = 0, pulse_width = 0.5, sub = 0, sub_width = 0.5, sync = 0;
+    double frequency_factor = 1;
+    int    unison_voices = 1;
+    float  unison_detune = 0, unison_stereo = 0;
+  };
+  struct EnvParams
+  {
+    float attack = 0, decay = 0, sustain = 0, release = 0;
+    float attack_slope = 0, decay_slope = 0, release_slope = 0;
+  };
+  struct ParamSnapshot
+  {
+    OscParams osc[2];
+    uint      osc_serial = 1;       // changes whenever osc[] changes
+    EnvParams volume_env, filter_env;
+    int       ve_model = 0;
+    float     mix_norm = 0, vel_track = 0, post_gain_factor = 1;
+    double    cutoff = 0, log2_cutoff = 0, key_track = 0, cut_mod = 0, resonance = 0, drive = 0;
+    int       ladder_mode = 0, skfilter_mode = 0;
+    float     cutoff_min_hz = 0, cutoff_max_hz = 0;
+  };
+  ParamSnapshot snapshot_;
+
   class Voice
   {
   public:
     enum State {
       IDLE,
       ON,
-      RELEASE
+      RELEASE,
+      STEAL     // fading out, restarts with steal_note_
       // TODO: SUSTAIN / pedal
     };
+    struct StealNote { int channel = 0, key = 0; float velocity = 0; bool release = false; };
     // TODO : enum class MonoType
 
     FlexADSR     envelope_;
@@ -369,7 +607,11 @@ class BlepSynth : public AudioProcessor {
     State        state_       = IDLE;
     int          midi_note_   = -1;
     int          channel_     = 0;
+    uint64       note_id_     = 0;  // note_counter_ at note on, for stealing the oldest voice
+    StealNote    steal_note_;       // note to start after the fade-out of a stolen voice
+    uint         steal_frames_ = 0; // frames left until a stolen voice is silent
     double       freq_        = 0;
+    double       log2_key_    = 0;  // log2 (freq_ / c3_hertz) for key tracking
     float        vel_gain_    = 0;
     bool         new_voice_   = false;
 
@@ -393,15 +635,36 @@ class BlepSynth : public AudioProcessor {
 
     LadderVCF ladder_filter_ { FILTER_OVERSAMPLE };
     SKFilter  skfilter_ { FILTER_OVERSAMPLE };
+
+    uint      batch_ = 0;   // VoiceBatch index
+    uint      lane_ = 0;    // SIMD lane within batch_
+    uint      osc_serial_ = 0;
   };
-  std::vector<Voice>    voices_;
-  std::vector<Voice *>  active_voices_;
-  std::vector<Voice *>  idle_voices_;
+  /* voices are rendered in batches, one voice per SIMD lane: oscillators, mix and volume
+   * envelope run vectorized, osc1_ and osc2_ of a voice only prepare new notes; filters run
+   * per voice, or for the whole batch if filter_lanes_ is set
+   */
+  static constexpr uint VOICE_LANES = SIMD_FLOAT_LANES;
+  static constexpr uint BATCH_FRAMES = 64;
+  struct VoiceBatch
+  {
+    BlepUtils::OscBatch<VOICE_LANES> osc1_;
+    BlepUtils::OscBatch<VOICE_LANES> osc2_;
+    uint                             osc_serial_ = 0;
+    LadderVCFLanes<VOICE_LANES>      ladder_filter_ { Voice::FILTER_OVERSAMPLE };
+    SKFilterLanes<VOICE_LANES>       skfilter_ { Voice::FILTER_OVERSAMPLE };
+  };
+  std::vector<Voice>      voices_;
+  std::vector<Voice *>    active_voices_;
+  std::vector<Voice *>    idle_voices_;
+  std::vector<VoiceBatch> batches_;
+  std::array<Voice::StealNote,MAX_VOICES> queued_notes_; // notes waiting for a stolen voice to restart
+  uint                    n_queued_notes_ = 0;
   void
   initialize (SpeakerArrangement busses) override
   {
     using namespace MakeIcon;
-    set_max_voices (32);
+    set_max_voices (MAX_VOICES);
 
     ParameterMap pmap;
 
@@ -491,6 +754,8 @@ class BlepSynth : public AudioProcessor {
     skfilter_mode_choices += { "HP6"_uc, "6 Pole Highpass, 36dB/Octave" };
     skfilter_mode_choices += { "HP8"_uc, "8 Pole Highpass, 48dB/Octave" };
     pmap[SKFILTER_MODE] = Param { "skfilter_mode", _("SKFilter Mode"), _("Mode"), 2, "", std::move (skfilter_mode_choices), "", { String ("blurb=") + _("Sallen-Key Filter Mode to be used"), } };
+    pmap[FILTER_LANES] = Param { "filter_lanes", _("Batch Filters"), _("Batch"), false, "", {}, STANDARD + ":toggle",
+                                 { String ("blurb=") + _("Filter several voices at once, faster but with a different oversampling filter"), } };
 
     pmap.group = _("Filter Envelope");
     pmap[FIL_ATTACK]  = Param { "fil_attack", _("Attack"), _("A"), 40, "%", { 0, 100, }, };
@@ -499,6 +764,17 @@ class BlepSynth : public AudioProcessor {
     pmap[FIL_RELEASE] = Param { "fil_release", _("Release"), _("R"), 30, "%", { 0, 100, }, };
     pmap[FIL_CUT_MOD] = Param { "fil_cut_mod", _("Env Cutoff Modulation"), _("CutMod"), 36, "semitones", { -96, 96, }, }; /* 8 octaves range */
 
+    pmap.group = _("Voices");
+    pmap[POLYPHONY] = Param { "polyphony", _("Polyphony"), _("Poly"), 32, "Voices", { 1, MAX_VOICES, 1 }, "", { String ("blurb=") + _("Maximum number of voices playing at once"), } };
+    ChoiceS voice_stealing_choices;
+    voice_stealing_choices += { "Rel", "Released First" };
+    voice_stealing_choices += { "Old", "Oldest" };
+    voice_stealing_choices += { "Qt", "Quietest" };
+    pmap[VOICE_STEALING] = Param { "voice_stealing", _("Voice Stealing"), _("Steal"), STEAL_RELEASED, "", std::move (voice_stealing_choices), "",
+                                   { String ("blurb=") + _("Voice to reuse for a new note if all voices are playing"), } };
+    pmap[LOAD_GOVERNOR] = Param { "load_governor", _("Load Governor"), _("Gov"), false, "", {}, STANDARD + ":toggle",
+                                  { String ("blurb=") + _("Reduce unison voices and polyphony while the DSP load is too high"), } };
+
     pmap.group = _("Keyboard Input");
     pmap[KEY_C] = Param { "c", _("Main Input 1"), _("C"), false, "", {}, GUIONLY + ":toggle" };
     pmap[KEY_D] = Param { "d", _("Main Input 2"), _("D"), false, "", {}, GUIONLY + ":toggle" };
@@ -508,6 +784,8 @@ class BlepSynth : public AudioProcessor {
     old_c_ = old_d_ = old_e_ = old_f_ = old_g_ = false;
 
     install_params (pmap);
+    snapshot_.cutoff_min_hz = convert_cutoff (CUTOFF_MIN_MIDI);
+    snapshot_.cutoff_max_hz = convert_cutoff (CUTOFF_MAX_MIDI);
 
     prepare_event_input();
     stereout_ = add_output_bus ("Stereo Out", SpeakerArrangement::STEREO);
@@ -519,18 +797,141 @@ class BlepSynth : public AudioProcessor {
     voices_.clear();
     voices_.resize (n_voices);
 
+    batches_.clear();
+    batches_.resize ((n_voices + VOICE_LANES - 1) / VOICE_LANES);
+    for (uint i = 0; i < n_voices; i++)
+      {
+        voices_[i].batch_ = i / VOICE_LANES;
+        voices_[i].lane_ = i % VOICE_LANES;
+      }
+
     active_voices_.clear();
     active_voices_.reserve (n_voices);
 
+    // allocate from the back, lowest voices first, to keep active voices in few batches
     idle_voices_.clear();
-    for (auto& v : voices_)
-      idle_voices_.push_back (&v);
+    for (auto it = voices_.rbegin(); it != voices_.rend(); it++)
+      idle_voices_.push_back (&*it);
+  }
+  uint
+  voice_limit() const
+  {
+    return governor_ ? std::min (polyphony_, governor_voices_) : polyphony_;
+  }
+  /* pick a playing voice to reuse for a new note, according to voice_stealing_ */
+  Voice *
+  steal_voice()
+  {
+    StealCandidate candidates[MAX_VOICES];
+    const size_t n = std::min<size_t> (active_voices_.size(), MAX_VOICES);
+    for (size_t i = 0; i < n; i++)
+      {
+        const Voice *voice = active_voices_[i];
+        candidates[i] = { voice->state_ == Voice::RELEASE, voice->state_ == Voice::STEAL,
+                          voice->note_id_, voice->envelope_.level() * voice->vel_gain_ };
+      }
+    const size_t victim = pick_steal_victim (candidates, n, voice_stealing_);
+    return victim < n ? active_voices_[victim] : nullptr;
+  }
+  uint
+  steal_fade_frames() const
+  {
+    return std::max (1u, uint (sample_rate() * STEAL_FADE_SECONDS));
+  }
+  /* start the pending notes of stolen voices that faded out */
+  void
+  restart_stolen_voices()
+  {
+    for (Voice *voice : active_voices_)
+      if (voice->state_ == Voice::STEAL && !voice->steal_frames_)
+        {
+          const Voice::StealNote note = voice->steal_note_;
+          start_voice (voice, note.channel, note.key, note.velocity);
+          if (note.release)
+            release_voice (voice);
+        }
+  }
+  /* retry the notes that found all voices fading out, once stolen voices restarted */
+  void
+  start_queued_notes()
+  {
+    const uint n = n_queued_notes_;
+    Voice::StealNote notes[MAX_VOICES];
+    std::copy (queued_notes_.begin(), queued_notes_.begin() + n, notes);
+    n_queued_notes_ = 0;
+    for (uint i = 0; i < n; i++)
+      {
+        note_on (notes[i].channel, notes[i].key, notes[i].velocity);
+        if (notes[i].release)
+          note_off (notes[i].channel, notes[i].key);
+      }
+  }
+  /* release playing voices beyond voice_limit(), oldest first */
+  void
+  release_excess_voices()
+  {
+    const uint limit = voice_limit();
+    for (;;)
+      {
+        uint n_on = 0;
+        Voice *oldest = nullptr;
+        for (Voice *voice : active_voices_)
+          if (voice->state_ == Voice::ON)
+            {
+              n_on++;
+              if (!oldest || voice->note_id_ < oldest->note_id_)
+                oldest = voice;
+            }
+        if (n_on <= limit)
+          return;
+        note_off (oldest->channel_, oldest->midi_note_);
+      }
+  }
+  /* adapt governor_unison_ and governor_voices_ to the engine DSP load, one step per 100ms */
+  void
+  govern_load (uint n_frames)
+  {
+    governor_frames_ += n_frames;
+    if (governor_frames_ < sample_rate() / 10)
+      return;
+    const float load = engine().dsp_load();
+    if (load > GOVERNOR_HIGH_LOAD)
+      {
+        uint unison = 1;
+        for (const OscParams& p : snapshot_.osc)
+          unison = std::max (unison, std::min<uint> (p.unison_voices, governor_unison_));
+        if (unison > 1)
+          {
+            governor_unison_ = unison / 2;
+            snapshot_.osc_serial++;
+          }
+        else if (voice_limit() > 1)
+          {
+            governor_voices_ = voice_limit() * 3 / 4;
+            release_excess_voices();
+          }
+      }
+    else if (load < GOVERNOR_LOW_LOAD)
+      {
+        if (governor_voices_ < polyphony_)
+          {
+            governor_voices_ += std::max (1u, governor_voices_ / 4);
+            if (governor_voices_ >= polyphony_)
+              governor_voices_ = MAX_VOICES;
+          }
+        else if (governor_unison_ < GOVERNOR_MAX_UNISON)
+          {
+            governor_unison_ *= 2;
+            snapshot_.osc_serial++;
+          }
+      }
+    governor_frames_ = 0;
   }
   Voice *
   alloc_voice()
   {
-    if (idle_voices_.empty()) // out of voices?
-      return nullptr;
+    if (active_voices_.size() >= voice_limit() || idle_voices_.empty()) // out of voices?
+      return steal_voice();
 
     Voice *voice = idle_voices_.back();
     assert_return (voice->state_ == Voice::IDLE, nullptr);   // every item in idle_voices should be idle
@@ -560,15 +961,52 @@ class BlepSynth : public AudioProcessor {
           }
       }
     active_voices_.resize (new_voice_count);
+    std::sort (idle_voices_.begin(), idle_voices_.end(), std::greater<Voice*>());
   }
   void
   reset (uint64 target_stamp) override
   {
-    set_max_voices (0);
-    set_max_voices (32);
+    // voices are preallocated, just mark all of them idle
+    active_voices_.clear();
+    idle_voices_.clear();
+    for (auto it = voices_.rbegin(); it != voices_.rend(); it++)
+      {
+        it->state_ = Voice::IDLE;
+        it->new_voice_ = false;
+        it->steal_frames_ = 0;
+        idle_voices_.push_back (&*it);
+      }
+    n_queued_notes_ = 0;
+    for (VoiceBatch& batch : batches_)
+      for (uint l = 0; l < VOICE_LANES; l++)
+        {
+          batch.osc1_.frequency_base[l] = 0;
+          batch.osc2_.frequency_base[l] = 0;
+        }
+    governor_unison_ = GOVERNOR_MAX_UNISON;
+    governor_voices_ = MAX_VOICES;
+    governor_frames_ = 0;
     adjust_all_params();
   }
   void
+  reset_filters()
+  {
+    for (Voice *voice : active_voices_)
+      {
+        if (filter_type_ == FILTER_TYPE_LADDER)
+          voice->ladder_filter_.reset();
+        if (filter_type_ == FILTER_TYPE_SKFILTER)
+          voice->skfilter_.reset();
+      }
+    for (VoiceBatch& batch : batches_)
+      {
+        if (filter_type_ == FILTER_TYPE_LADDER)
+          batch.ladder_filter_.reset();
+        if (filter_type_ == FILTER_TYPE_SKFILTER)
+          batch.skfilter_.reset();
+      }
+  }
+  void
   init_osc (BlepUtils::OscImpl& osc, float freq)
   {
     osc.frequency_base = freq;
@@ -580,6 +1018,11 @@ class BlepSynth : public AudioProcessor {
   void
   adjust_param (uint32_t tag) override
   {
+    if (tag >= OSC1_SHAPE && tag <= OSC2_UNISON_STEREO)
+      {
+        update_osc_params ((tag - OSC1_SHAPE) / (OSC2_SHAPE - OSC1_SHAPE));
+        return;
+      }
     switch (tag)
       {
         case FILTER_TYPE:
@@ -588,18 +1031,22 @@ class BlepSynth : public AudioProcessor {
             if (new_filter_type != filter_type_)
               {
                 filter_type_ = new_filter_type;
-                for (Voice *voice : active_voices_)
-                  {
-                    if (filter_type_ == FILTER_TYPE_LADDER)
-                      voice->ladder_filter_.reset();
-                    if (filter_type_ == FILTER_TYPE_SKFILTER)
-                      voice->skfilter_.reset();
-                  }
+                reset_filters();
               }
             set_parameter_used (LADDER_MODE, filter_type_ == FILTER_TYPE_LADDER);
             set_parameter_used (SKFILTER_MODE, filter_type_ == FILTER_TYPE_SKFILTER);
           }
           break;
+        case FILTER_LANES:
+          {
+            const bool new_filter_lanes = get_param (FILTER_LANES) > 0.5;
+            if (new_filter_lanes != filter_lanes_)
+              {
+                filter_lanes_ = new_filter_lanes;
+                reset_filters();
+              }
+          }
+          break;
         case ATTACK:
         case DECAY:
         case SUSTAIN:
@@ -608,6 +1055,14 @@ class BlepSynth : public AudioProcessor {
         case DECAY_SLOPE:
         case RELEASE_SLOPE:
           {
+            EnvParams& env = snapshot_.volume_env;
+            env.attack = perc_to_s (get_param (ATTACK));
+            env.decay = perc_to_s (get_param (DECAY));
+            env.sustain = get_param (SUSTAIN);          /* percent */
+            env.release = perc_to_s (get_param (RELEASE));
+            env.attack_slope = get_param (ATTACK_SLOPE) * 0.01;
+            env.decay_slope = get_param (DECAY_SLOPE) * 0.01;
+            env.release_slope = get_param (RELEASE_SLOPE) * 0.01;
             for (Voice *voice : active_voices_)
               update_volume_envelope (voice);
             break;
@@ -617,19 +1072,54 @@ class BlepSynth : public AudioProcessor {
         case FIL_SUSTAIN:
         case FIL_RELEASE:
           {
+            EnvParams& env = snapshot_.filter_env;
+            env.attack = perc_to_s (get_param (FIL_ATTACK));
+            env.decay = perc_to_s (get_param (FIL_DECAY));
+            env.sustain = get_param (FIL_SUSTAIN);      /* percent */
+            env.release = perc_to_s (get_param (FIL_RELEASE));
             for (Voice *voice : active_voices_)
               update_filter_envelope (voice);
             break;
           }
         case VE_MODEL:
           {
-            bool ve_has_slope = irintf (get_param (VE_MODEL)) > 0; // exponential envelope has no slope parameters
+            snapshot_.ve_model = irintf (get_param (VE_MODEL));
+            bool ve_has_slope = snapshot_.ve_model > 0; // exponential envelope has no slope parameters
 
             set_parameter_used (ATTACK_SLOPE,  ve_has_slope);
             set_parameter_used (DECAY_SLOPE,   ve_has_slope);
             set_parameter_used (RELEASE_SLOPE, ve_has_slope);
             break;
           }
+        case MIX:           snapshot_.mix_norm = get_param (MIX) * 0.01; break;
+        case VEL_TRACK:     snapshot_.vel_track = get_param (VEL_TRACK) * 0.01; break;
+        case POST_GAIN:     snapshot_.post_gain_factor = db2voltage (get_param (POST_GAIN)); break;
+        case CUTOFF:
+          snapshot_.cutoff = convert_cutoff (get_param (CUTOFF));
+          snapshot_.log2_cutoff = fast_log2 (snapshot_.cutoff);
+          break;
+        case KEY_TRACK:     snapshot_.key_track = get_param (KEY_TRACK) * 0.01; break;
+        case FIL_CUT_MOD:   snapshot_.cut_mod = get_param (FIL_CUT_MOD) / 12.; break; /* convert semitones to octaves */
+        case RESONANCE:     snapshot_.resonance = get_param (RESONANCE) * 0.01; break;
+        case DRIVE:         snapshot_.drive = get_param (DRIVE); break;
+        case LADDER_MODE:   snapshot_.ladder_mode = irintf (get_param (LADDER_MODE)); break;
+        case SKFILTER_MODE: snapshot_.skfilter_mode = irintf (get_param (SKFILTER_MODE)); break;
+        case POLYPHONY:
+          polyphony_ = CLAMP (irintf (get_param (POLYPHONY)), 1, int (MAX_VOICES));
+          release_excess_voices();
+          break;
+        case VOICE_STEALING:
+          voice_stealing_ = irintf (get_param (VOICE_STEALING));
+          break;
+        case LOAD_GOVERNOR:
+          governor_ = get_param (LOAD_GOVERNOR) > 0.5;
+          if (!governor_ && (governor_unison_ < GOVERNOR_MAX_UNISON || governor_voices_ < MAX_VOICES))
+            {
+              governor_unison_ = GOVERNOR_MAX_UNISON;
+              governor_voices_ = MAX_VOICES;
+              snapshot_.osc_serial++;
+            }
+          break;
         case KEY_C: check_note (KEY_C, old_c_, 60); break;
         case KEY_D: check_note (KEY_D, old_d_, 62); break;
         case KEY_E: check_note (KEY_E, old_e_, 64); break;
@@ -638,25 +1128,50 @@ class BlepSynth : public AudioProcessor {
       }
   }
   void
-  update_osc (BlepUtils::OscImpl& osc, int oscnum)
+  update_osc_params (int oscnum)
   {
     const uint O = oscnum * (OSC2_SHAPE - OSC1_SHAPE);
-    osc.shape_base          = get_param (O+OSC1_SHAPE) * 0.01;
-    osc.pulse_width_base    = get_param (O+OSC1_PULSE_WIDTH) * 0.01;
-    osc.sub_base            = get_param (O+OSC1_SUB) * 0.01;
-    osc.sub_width_base      = get_param (O+OSC1_SUB_WIDTH) * 0.01;
-    osc.sync_base           = get_param (O+OSC1_SYNC);
+    OscParams& p = snapshot_.osc[oscnum];
+    p.shape          = get_param (O+OSC1_SHAPE) * 0.01;
+    p.pulse_width    = get_param (O+OSC1_PULSE_WIDTH) * 0.01;
+    p.sub            = get_param (O+OSC1_SUB) * 0.01;
+    p.sub_width      = get_param (O+OSC1_SUB_WIDTH) * 0.01;
+    p.sync           = get_param (O+OSC1_SYNC);
 
     int octave = irintf (get_param (O+OSC1_OCTAVE));
     octave = CLAMP (octave, -2, 3);
-    osc.frequency_factor = fast_exp2 (octave + get_param (O+OSC1_PITCH) / 12.);
+    p.frequency_factor = fast_exp2 (octave + get_param (O+OSC1_PITCH) / 12.);
 
     int unison_voices = irintf (get_param (O+OSC1_UNISON_VOICES));
-    unison_voices = CLAMP (unison_voices, 1, 16);
-    osc.set_unison (unison_voices, get_param (O+OSC1_UNISON_DETUNE), get_param (O+OSC1_UNISON_STEREO) * 0.01);
+    p.unison_voices = CLAMP (unison_voices, 1, 16);
+    p.unison_detune = get_param (O+OSC1_UNISON_DETUNE);
+    p.unison_stereo = get_param (O+OSC1_UNISON_STEREO) * 0.01;
+    snapshot_.osc_serial++;
 
-    set_parameter_used (O + OSC1_UNISON_DETUNE, unison_voices > 1);
-    set_parameter_used (O + OSC1_UNISON_STEREO, unison_voices > 1);
+    set_parameter_used (O + OSC1_UNISON_DETUNE, p.unison_voices > 1);
+    set_parameter_used (O + OSC1_UNISON_STEREO, p.unison_voices > 1);
+  }
+  template<class Oscillator> void
+  update_osc (Oscillator& osc, int oscnum)
+  {
+    const OscParams& p = snapshot_.osc[oscnum];
+    osc.shape_base          = p.shape;
+    osc.pulse_width_base    = p.pulse_width;
+    osc.sub_base            = p.sub;
+    osc.sub_width_base      = p.sub_width;
+    osc.sync_base           = p.sync;
+    osc.frequency_factor    = p.frequency_factor;
+    osc.set_unison (std::min<uint> (p.unison_voices, governor_unison_), p.unison_detune, p.unison_stereo);
+  }
+  /* apply oscillator parameters, unless `owner` is up to date with snapshot_ */
+  template<class Owner> void
+  update_oscs (Owner& owner)
+  {
+    if (owner.osc_serial_ == snapshot_.osc_serial)
+      return;
+    update_osc (owner.osc1_, 0);
+    update_osc (owner.osc2_, 1);
+    owner.osc_serial_ = snapshot_.osc_serial;
   }
   static double
   perc_to_s (double perc)
@@ -709,64 +1224,85 @@ class BlepSynth : public AudioProcessor {
   note_on (int channel, int midi_note, float vel)
   {
     Voice *voice = alloc_voice();
-    if (voice)
+    if (!voice)
       {
-        voice->freq_ = note_to_freq (midi_note);
-        voice->state_ = Voice::ON;
-        voice->channel_ = channel;
-        voice->midi_note_ = midi_note;
-        voice->vel_gain_ = velocity_to_gain (vel, get_param (VEL_TRACK) * 0.01);
-
-        // Volume Envelope
-        /* TODO: maybe use non-linear translation between level and sustain % */
-        switch (irintf (get_param (VE_MODEL)))
-          {
-            case 0:   voice->envelope_.set_shape (FlexADSR::Shape::EXPONENTIAL);
-                      break;
-            default:  voice->envelope_.set_shape (FlexADSR::Shape::FLEXIBLE);
-                      break;
-          }
-        update_volume_envelope (voice);
-        voice->envelope_.set_rate (sample_rate());
-        voice->envelope_.start();
-
-        // Filter Envelope
-        voice->fil_envelope_.set_shape (FlexADSR::Shape::LINEAR);
-        update_filter_envelope (voice);
-        voice->fil_envelope_.set_rate (sample_rate());
-        voice->fil_envelope_.start();
-
-        init_osc (voice->osc1_, voice->freq_);
-        init_osc (voice->osc2_, voice->freq_);
-
-        voice->osc1_.reset();
-        voice->osc2_.reset();
-
-        const float cutoff_min_hz = convert_cutoff (CUTOFF_MIN_MIDI);
-        const float cutoff_max_hz = convert_cutoff (CUTOFF_MAX_MIDI);
-
-        voice->ladder_filter_.reset();
-        voice->ladder_filter_.set_rate (sample_rate());
-        voice->ladder_filter_.set_frequency_range (cutoff_min_hz, cutoff_max_hz);
-
-        voice->skfilter_.reset();
-        voice->skfilter_.set_rate (sample_rate());
-        voice->skfilter_.set_frequency_range (cutoff_min_hz, cutoff_max_hz);
-        voice->new_voice_ = true;
-
-        voice->cutoff_smooth_.reset (sample_rate(), 0.020);
-        voice->last_cutoff_ = -5000; // force reset
-
-        voice->cut_mod_smooth_.reset (sample_rate(), 0.020);
-        voice->last_cut_mod_ = -5000; // force reset
-        voice->last_key_track_ = -5000;
-
-        voice->reso_smooth_.reset (sample_rate(), 0.020);
-        voice->last_reso_ = -5000; // force reset
-                                   //
-        voice->drive_smooth_.reset (sample_rate(), 0.020);
-        voice->last_drive_ = -5000; // force reset
+        // all voices fade out already, retry after the next restart, see start_queued_notes()
+        if (!active_voices_.empty() && n_queued_notes_ < queued_notes_.size())
+          queued_notes_[n_queued_notes_++] = { channel, midi_note, vel, false };
+        return;
       }
+    if (voice->state_ != Voice::IDLE)
+      {
+        // stolen voices fade out first to avoid clicks, render_audio() restarts them
+        if (voice->state_ != Voice::STEAL)
+          voice->steal_frames_ = steal_fade_frames();
+        voice->state_ = Voice::STEAL;
+        voice->steal_note_ = { channel, midi_note, vel, false };
+        return;
+      }
+    start_voice (voice, channel, midi_note, vel);
+  }
+  void
+  start_voice (Voice *voice, int channel, int midi_note, float vel)
+  {
+    voice->freq_ = note_to_freq (midi_note);
+    voice->log2_key_ = fast_log2 (voice->freq_ / c3_hertz);
+    voice->state_ = Voice::ON;
+    voice->note_id_ = ++note_counter_;
+    voice->channel_ = channel;
+    voice->midi_note_ = midi_note;
+    voice->vel_gain_ = velocity_to_gain (vel, snapshot_.vel_track);
+
+    // Volume Envelope
+    /* TODO: maybe use non-linear translation between level and sustain % */
+    switch (snapshot_.ve_model)
+      {
+        case 0:   voice->envelope_.set_shape (FlexADSR::Shape::EXPONENTIAL);
+                  break;
+        default:  voice->envelope_.set_shape (FlexADSR::Shape::FLEXIBLE);
+                  break;
+      }
+    update_volume_envelope (voice);
+    voice->envelope_.set_rate (sample_rate());
+    voice->envelope_.start();
+
+    // Filter Envelope
+    voice->fil_envelope_.set_shape (FlexADSR::Shape::LINEAR);
+    update_filter_envelope (voice);
+    voice->fil_envelope_.set_rate (sample_rate());
+    voice->fil_envelope_.start();
+
+    init_osc (voice->osc1_, voice->freq_);
+    init_osc (voice->osc2_, voice->freq_);
+
+    voice->osc1_.reset();
+    voice->osc2_.reset();
+    voice->osc_serial_ = 0;
+
+    const float cutoff_min_hz = snapshot_.cutoff_min_hz;
+    const float cutoff_max_hz = snapshot_.cutoff_max_hz;
+
+    voice->ladder_filter_.reset();
+    voice->ladder_filter_.set_rate (sample_rate());
+    voice->ladder_filter_.set_frequency_range (cutoff_min_hz, cutoff_max_hz);
+
+    voice->skfilter_.reset();
+    voice->skfilter_.set_rate (sample_rate());
+    voice->skfilter_.set_frequency_range (cutoff_min_hz, cutoff_max_hz);
+    voice->new_voice_ = true;
+
+    voice->cutoff_smooth_.reset (sample_rate(), 0.020);
+    voice->last_cutoff_ = -5000; // force reset
+
+    voice->cut_mod_smooth_.reset (sample_rate(), 0.020);
+    voice->last_cut_mod_ = -5000; // force reset
+    voice->last_key_track_ = -5000;
+
+    voice->reso_smooth_.reset (sample_rate(), 0.020);
+    voice->last_reso_ = -5000; // force reset
+                               //
+    voice->drive_smooth_.reset (sample_rate(), 0.020);
+    voice->last_drive_ = -5000; // force reset
   }
   void
   note_off (int channel, int midi_note)
@@ -774,12 +1310,20 @@ class BlepSynth : public AudioProcessor {
     for (auto voice : active_voices_)
       {
         if (voice->state_ == Voice::ON && voice->midi_note_ == midi_note && voice->channel_ == channel)
-          {
-            voice->state_ = Voice::RELEASE;
-            voice->envelope_.stop();
-            voice->fil_envelope_.stop();
-          }
+          release_voice (voice);
+        else if (voice->state_ == Voice::STEAL && voice->steal_note_.key == midi_note && voice->steal_note_.channel == channel)
+          voice->steal_note_.release = true;
       }
+    for (uint i = 0; i < n_queued_notes_; i++)
+      if (queued_notes_[i].key == midi_note && queued_notes_[i].channel == channel)
+        queued_notes_[i].release = true;
+  }
+  void
+  release_voice (Voice *voice)
+  {
+    voice->state_ = Voice::RELEASE;
+    voice->envelope_.stop();
+    voice->fil_envelope_.stop();
   }
   void
   check_note (ParamType pid, bool& old_value, int note)
@@ -803,13 +1347,12 @@ class BlepSynth : public AudioProcessor {
     float osc2_left_out[n_frames];
     float osc2_right_out[n_frames];
 
-    update_osc (voice->osc1_, 0);
-    update_osc (voice->osc2_, 1);
+    update_oscs (*voice);
     voice->osc1_.process_sample_stereo (osc1_left_out, osc1_right_out, n_frames);
     voice->osc2_.process_sample_stereo (osc2_left_out, osc2_right_out, n_frames);
 
     // apply volume envelope & mix
-    const float mix_norm = get_param (MIX) * 0.01;
+    const float mix_norm = snapshot_.mix_norm;
     const float v1 = voice->vel_gain_ * (1 - mix_norm);
     const float v2 = voice->vel_gain_ * mix_norm;
     for (uint i = 0; i < n_frames; i++)
@@ -817,9 +1360,55 @@ class BlepSynth : public AudioProcessor {
         mix_left_out[i]  = osc1_left_out[i] * v1 + osc2_left_out[i] * v2;
         mix_right_out[i] = osc1_right_out[i] * v1 + osc2_right_out[i] * v2;
       }
+    filter_voice (voice, n_frames, mix_left_out, mix_right_out);
+  }
+  void
+  filter_voice (Voice *voice, uint n_frames, float *mix_left_out, float *mix_right_out)
+  {
     /* --------- run filter - processing in place is ok --------- */
-    double cutoff = convert_cutoff (get_param (CUTOFF));
-    double key_track = get_param (KEY_TRACK) * 0.01;
+    update_filter_smooth (voice);
+
+    auto filter_process_block = [&] (auto& filter)
+      {
+        if (filter_constant (voice))
+          {
+            /* use more efficient version of the filter computation if all parameters are constants */
+            float freq, reso, drive;
+            filter_input (voice, 1, &freq, &reso, &drive, 1);
+
+            filter.set_freq (freq);
+            filter.set_reso (reso);
+            filter.set_drive (drive);
+            filter.process_block (n_frames, mix_left_out, mix_right_out);
+          }
+        else
+          {
+            /* generic version: pass per-sample values for freq, reso and drive */
+            float freq_in[n_frames], reso_in[n_frames], drive_in[n_frames];
+            filter_input (voice, n_frames, freq_in, reso_in, drive_in, 1);
+
+            filter.process_block (n_frames, mix_left_out, mix_right_out, freq_in, reso_in, drive_in);
+          }
+      };
+
+    if (filter_type_ == FILTER_TYPE_LADDER)
+      {
+        voice->ladder_filter_.set_mode (LadderVCF::Mode (snapshot_.ladder_mode));
+        filter_process_block (voice->ladder_filter_);
+      }
+    else if (filter_type_ == FILTER_TYPE_SKFILTER)
+      {
+        voice->skfilter_.set_mode (SKFilter::Mode (snapshot_.skfilter_mode));
+        filter_process_block (voice->skfilter_);
+      }
+  }
+  /* let the filter parameter smoothing of a voice follow the current parameter values */
+  void
+  update_filter_smooth (Voice *voice)
+  {
+    const ParamSnapshot& snapshot = snapshot_;
+    const double cutoff = snapshot.cutoff;
+    const double key_track = snapshot.key_track;
 
     if (fabs (voice->last_cutoff_ - cutoff) > 1e-7 || fabs (voice->last_key_track_ - key_track) > 1e-7)
       {
@@ -828,11 +1417,11 @@ class BlepSynth : public AudioProcessor {
         // original strategy for key tracking: cutoff * exp (amount * log (key / 261.63))
         // but since cutoff_smooth_ is already in log2-frequency space, we can do it better
 
-        voice->cutoff_smooth_.set (fast_log2 (cutoff) + key_track * fast_log2 (voice->freq_ / c3_hertz), reset);
+        voice->cutoff_smooth_.set (snapshot.log2_cutoff + key_track * voice->log2_key_, reset);
         voice->last_cutoff_ = cutoff;
         voice->last_key_track_ = key_track;
       }
-    double cut_mod = get_param (FIL_CUT_MOD) / 12.; /* convert semitones to octaves */
+    const double cut_mod = snapshot.cut_mod;
     if (fabs (voice->last_cut_mod_ - cut_mod) > 1e-7)
       {
         const bool reset = voice->last_cut_mod_ < -1000;
@@ -840,7 +1429,7 @@ class BlepSynth : public AudioProcessor {
         voice->cut_mod_smooth_.set (cut_mod, reset);
         voice->last_cut_mod_ = cut_mod;
       }
-    double resonance = get_param (RESONANCE) * 0.01;
+    const double resonance = snapshot.resonance;
     if (fabs (voice->last_reso_ - resonance) > 1e-7)
       {
         const bool reset = voice->last_reso_ < -1000;
@@ -848,7 +1437,7 @@ class BlepSynth : public AudioProcessor {
         voice->reso_smooth_.set (resonance, reset);
         voice->last_reso_ = resonance;
       }
-    double drive = get_param (DRIVE);
+    const double drive = snapshot.drive;
     if (fabs (voice->last_drive_ - drive) > 1e-7)
       {
         const bool reset = voice->last_drive_ < -1000;
@@ -856,84 +1445,256 @@ class BlepSynth : public AudioProcessor {
         voice->drive_smooth_.set (drive, reset);
         voice->last_drive_ = drive;
       }
+  }
+  bool
+  filter_constant (Voice *voice)
+  {
+    return voice->cutoff_smooth_.is_constant() && voice->fil_envelope_.is_constant() && voice->cut_mod_smooth_.is_constant() &&
+           voice->reso_smooth_.is_constant() && voice->drive_smooth_.is_constant();
+  }
+  /* generate per sample cutoff, resonance and drive of a voice for the filter, written to
+   * freq_in[i * stride], reso_in[i * stride] and drive_in[i * stride]
+   */
+  void
+  filter_input (Voice *voice, uint n_frames, float *freq_in, float *reso_in, float *drive_in, uint stride)
+  {
+    float fil_env[n_frames];
+    voice->fil_envelope_.process (fil_env, n_frames);
 
-    auto filter_process_block = [&] (auto& filter)
+    for (uint i = 0; i < n_frames; i++)
       {
-        auto gen_filter_input = [&] (float *freq_in, float *reso_in, float *drive_in, uint n_frames)
-          {
-            voice->fil_envelope_.process (freq_in, n_frames);
+        freq_in[i * stride] = fast_exp2 (voice->cutoff_smooth_.get_next() + fil_env[i] * voice->cut_mod_smooth_.get_next());
+        reso_in[i * stride] = voice->reso_smooth_.get_next();
+        drive_in[i * stride] = voice->drive_smooth_.get_next();
+      }
+  }
+  void
+  set_parameter_used (uint32_t id, bool used)
+  {
+    // TODO: implement this function to enable/disable parameters in the gui
+    // printf ("TODO: set parameter %d used flag to %s\n", int (id), used ? "true" : "false");
+  }
+  void
+  update_volume_envelope (Voice *voice)
+  {
+    const EnvParams& env = snapshot_.volume_env;
+    voice->envelope_.set_attack (env.attack);
+    voice->envelope_.set_decay (env.decay);
+    voice->envelope_.set_sustain (env.sustain);
+    voice->envelope_.set_release (env.release);
+    voice->envelope_.set_attack_slope (env.attack_slope);
+    voice->envelope_.set_decay_slope (env.decay_slope);
+    voice->envelope_.set_release_slope (env.release_slope);
+  }
+  void
+  update_filter_envelope (Voice *voice)
+  {
+    const EnvParams& env = snapshot_.filter_env;
+    voice->fil_envelope_.set_attack (env.attack);
+    voice->fil_envelope_.set_decay (env.decay);
+    voice->fil_envelope_.set_sustain (env.sustain);
+    voice->fil_envelope_.set_release (env.release);
+  }
+  void
+  start_batch_voice (Voice *voice)
+  {
+    VoiceBatch& batch = batches_[voice->batch_];
+    update_oscs (batch);
+    update_oscs (*voice);
 
-            for (uint i = 0; i < n_frames; i++)
-              {
-                freq_in[i] = fast_exp2 (voice->cutoff_smooth_.get_next() + freq_in[i] * voice->cut_mod_smooth_.get_next());
-                reso_in[i] = voice->reso_smooth_.get_next();
-                drive_in[i] = voice->drive_smooth_.get_next();
-              }
-          };
+    // FIR oversampling filter latency, rounded to whole frames since delay() can be fractional
+    double delay = 0;
+    if (filter_type_ == FILTER_TYPE_LADDER)
+      delay = filter_lanes_ ? batch.ladder_filter_.delay() : voice->ladder_filter_.delay();
+    if (filter_type_ == FILTER_TYPE_SKFILTER)
+      delay = filter_lanes_ ? batch.skfilter_.delay() : voice->skfilter_.delay();
+    const int idelay = irintf (delay);
+    if (idelay && !filter_lanes_)
+      {
+        // compensate FIR oversampling filter latency
+        float junk[idelay];
+        render_voice (voice, idelay, junk, junk);
+      }
+    else if (idelay)
+      {
+        /* compensate FIR oversampling filter latency: advance oscillators and filter input,
+         * the filter lane of the new voice starts from silence
+         */
+        float junk[idelay], junk2[idelay], junk3[idelay];
+        voice->osc1_.process_sample_stereo (junk, junk2, idelay);
+        voice->osc2_.process_sample_stereo (junk, junk2, idelay);
+        update_filter_smooth (voice);
+        filter_input (voice, idelay, junk, junk2, junk3, 1);
+      }
+    batch.osc1_.import_lane (voice->lane_, voice->osc1_);
+    batch.osc2_.import_lane (voice->lane_, voice->osc2_);
 
-        bool const_freq = voice->cutoff_smooth_.is_constant() && voice->fil_envelope_.is_constant() && voice->cut_mod_smooth_.is_constant();
-        bool const_reso = voice->reso_smooth_.is_constant();
-        bool const_drive = voice->drive_smooth_.is_constant();
+    auto start_filter = [&] (auto& filter)
+      {
+        filter.set_rate (sample_rate());
+        filter.set_frequency_range (snapshot_.cutoff_min_hz, snapshot_.cutoff_max_hz);
+        filter.reset_lane (voice->lane_);
+      };
+    start_filter (batch.ladder_filter_);
+    start_filter (batch.skfilter_);
+    voice->new_voice_ = false;
+  }
+  /* filter all voices of a batch at once, unused lanes only see silence */
+  void
+  filter_batch (VoiceBatch& batch, Voice *const *lanes, uint n_frames, float *mix_left_out, float *mix_right_out)
+  {
+    constexpr uint L = VOICE_LANES;
+    bool const_params = true;
+    for (uint l = 0; l < L; l++)
+      if (lanes[l])
+        {
+          update_filter_smooth (lanes[l]);
+          const_params = const_params && filter_constant (lanes[l]);
+        }
 
-        if (const_freq && const_reso && const_drive)
+    auto filter_process_block = [&] (auto& filter)
+      {
+        if (const_params)
           {
             /* use more efficient version of the filter computation if all parameters are constants */
-            float freq, reso, drive;
-            gen_filter_input (&freq, &reso, &drive, 1);
-
-            filter.set_freq (freq);
-            filter.set_reso (reso);
-            filter.set_drive (drive);
+            for (uint l = 0; l < L; l++)
+              {
+                float freq = snapshot_.cutoff, reso = 0, drive = 0;
+                if (lanes[l])
+                  filter_input (lanes[l], 1, &freq, &reso, &drive, 1);
+                filter.set_freq (l, freq);
+                filter.set_reso (l, reso);
+                filter.set_drive (l, drive);
+              }
             filter.process_block (n_frames, mix_left_out, mix_right_out);
           }
         else
           {
             /* generic version: pass per-sample values for freq, reso and drive */
-            float freq_in[n_frames], reso_in[n_frames], drive_in[n_frames];
-            gen_filter_input (freq_in, reso_in, drive_in, n_frames);
-
+            alignas (64) float freq_in[BATCH_FRAMES * L], reso_in[BATCH_FRAMES * L], drive_in[BATCH_FRAMES * L];
+            for (uint l = 0; l < L; l++)
+              if (lanes[l])
+                filter_input (lanes[l], n_frames, freq_in + l, reso_in + l, drive_in + l, L);
+              else
+                for (uint i = 0; i < n_frames; i++)
+                  {
+                    freq_in[i * L + l] = snapshot_.cutoff;
+                    reso_in[i * L + l] = 0;
+                    drive_in[i * L + l] = 0;
+                  }
             filter.process_block (n_frames, mix_left_out, mix_right_out, freq_in, reso_in, drive_in);
           }
       };
 
     if (filter_type_ == FILTER_TYPE_LADDER)
       {
-        voice->ladder_filter_.set_mode (LadderVCF::Mode (irintf (get_param (LADDER_MODE))));
-        filter_process_block (voice->ladder_filter_);
+        batch.ladder_filter_.set_mode (LadderVCF::Mode (snapshot_.ladder_mode));
+        filter_process_block (batch.ladder_filter_);
       }
     else if (filter_type_ == FILTER_TYPE_SKFILTER)
       {
-        voice->skfilter_.set_mode (SKFilter::Mode (irintf (get_param (SKFILTER_MODE))));
-        filter_process_block (voice->skfilter_);
+        batch.skfilter_.set_mode (SKFilter::Mode (snapshot_.skfilter_mode));
+        filter_process_block (batch.skfilter_);
       }
   }
   void
-  set_parameter_used (uint32_t id, bool used)
+  render_batch (VoiceBatch& batch, Voice *const *lanes, uint n_frames, float *left_out, float *right_out)
   {
-    // TODO: implement this function to enable/disable parameters in the gui
-    // printf ("TODO: set parameter %d used flag to %s\n", int (id), used ? "true" : "false");
-  }
-  void
-  update_volume_envelope (Voice *voice)
-  {
-    voice->envelope_.set_attack (perc_to_s (get_param (ATTACK)));
-    voice->envelope_.set_decay (perc_to_s (get_param (DECAY)));
-    voice->envelope_.set_sustain (get_param (SUSTAIN));         /* percent */
-    voice->envelope_.set_release (perc_to_s (get_param (RELEASE)));
-    voice->envelope_.set_attack_slope (get_param (ATTACK_SLOPE) * 0.01);
-    voice->envelope_.set_decay_slope (get_param (DECAY_SLOPE) * 0.01);
-    voice->envelope_.set_release_slope (get_param (RELEASE_SLOPE) * 0.01);
+    using FloatV = SimdVector<float, VOICE_LANES>;
+    constexpr uint L = VOICE_LANES;
+
+    alignas (64) float osc1_left_out[BATCH_FRAMES * L];
+    alignas (64) float osc1_right_out[BATCH_FRAMES * L];
+    alignas (64) float osc2_left_out[BATCH_FRAMES * L];
+    alignas (64) float osc2_right_out[BATCH_FRAMES * L];
+
+    update_oscs (batch);
+    batch.osc1_.process_sample_stereo (osc1_left_out, osc1_right_out, n_frames);
+    batch.osc2_.process_sample_stereo (osc2_left_out, osc2_right_out, n_frames);
+
+    // mix oscillators, unused lanes get zero gain
+    const float mix_norm = snapshot_.mix_norm;
+    FloatV v1 = {}, v2 = {};
+    for (uint l = 0; l < L; l++)
+      if (lanes[l])
+        {
+          v1[l] = lanes[l]->vel_gain_ * (1 - mix_norm);
+          v2[l] = lanes[l]->vel_gain_ * mix_norm;
+        }
+    float *mix_left_out = osc1_left_out, *mix_right_out = osc1_right_out;
+    for (uint i = 0; i < n_frames * L; i += L)
+      {
+        FloatV o1l, o1r, o2l, o2r;
+        simd_load (o1l, osc1_left_out + i);
+        simd_load (o1r, osc1_right_out + i);
+        simd_load (o2l, osc2_left_out + i);
+        simd_load (o2r, osc2_right_out + i);
+        simd_store (mix_left_out + i, o1l * v1 + o2l * v2);
+        simd_store (mix_right_out + i, o1r * v1 + o2r * v2);
+      }
+
+    if (filter_lanes_)
+      filter_batch (batch, lanes, n_frames, mix_left_out, mix_right_out);
+    else // filters are per voice
+      for (uint l = 0; l < L; l++)
+        if (lanes[l])
+          {
+            float voice_left[BATCH_FRAMES], voice_right[BATCH_FRAMES];
+            for (uint i = 0; i < n_frames; i++)
+              {
+                voice_left[i] = mix_left_out[i * L + l];
+                voice_right[i] = mix_right_out[i * L + l];
+              }
+            filter_voice (lanes[l], n_frames, voice_left, voice_right);
+            for (uint i = 0; i < n_frames; i++)
+              {
+                mix_left_out[i * L + l] = voice_left[i];
+                mix_right_out[i * L + l] = voice_right[i];
+              }
+          }
+
+    // apply volume envelope
+    FlexADSR *envelopes[L];
+    for (uint l = 0; l < L; l++)
+      envelopes[l] = lanes[l] ? &lanes[l]->envelope_ : nullptr;
+    float *volume_env = osc2_left_out;
+    FlexADSR::process_lanes<L> (envelopes, volume_env, n_frames);
+    for (uint l = 0; l < L; l++)
+      if (lanes[l] && lanes[l]->state_ == Voice::STEAL)
+        steal_fade (volume_env + l, L, n_frames, &lanes[l]->steal_frames_, steal_fade_frames());
+    const float post_gain_factor = snapshot_.post_gain_factor;
+    for (uint i = 0; i < n_frames; i++)
+      {
+        FloatV env, mix_left, mix_right;
+        simd_load (env, volume_env + i * L);
+        simd_load (mix_left, mix_left_out + i * L);
+        simd_load (mix_right, mix_right_out + i * L);
+        const FloatV amp = post_gain_factor * env;
+        left_out[i] += simd_sum (mix_left * amp);
+        right_out[i] += simd_sum (mix_right * amp);
+      }
   }
   void
-  update_filter_envelope (Voice *voice)
+  render_audio (float *left_out, float *right_out, uint n_frames)
   {
-    voice->fil_envelope_.set_attack (perc_to_s (get_param (FIL_ATTACK)));
-    voice->fil_envelope_.set_decay (perc_to_s (get_param (FIL_DECAY)));
-    voice->fil_envelope_.set_sustain (get_param (FIL_SUSTAIN));         /* percent */
-    voice->fil_envelope_.set_release (perc_to_s (get_param (FIL_RELEASE)));
+    while (n_frames)
+      {
+        // split at the end of fade-outs, so stolen voices restart sample accurately
+        uint block = n_frames;
+        for (Voice *voice : active_voices_)
+          if (voice->state_ == Voice::STEAL)
+            block = std::min (block, voice->steal_frames_);
+        render_voices (left_out, right_out, block);
+        restart_stolen_voices();
+        if (ASE_UNLIKELY (n_queued_notes_))
+          start_queued_notes();
+        left_out += block;
+        right_out += block;
+        n_frames -= block;
+      }
   }
   void
-  render_audio (float *left_out, float *right_out, uint n_frames)
+  render_voices (float *left_out, float *right_out, uint n_frames)
   {
     if (!n_frames)
       return;
@@ -941,42 +1702,37 @@ class BlepSynth : public AudioProcessor {
     bool   need_free = false;
 
     for (Voice *voice : active_voices_)
+      if (voice->new_voice_)
+        start_batch_voice (voice);
+
+    for (size_t b = 0; b < batches_.size(); b++)
       {
-        if (voice->new_voice_)
+        Voice *lanes[VOICE_LANES] = {};
+        bool   active = false;
+        for (uint l = 0; l < VOICE_LANES && b * VOICE_LANES + l < voices_.size(); l++)
           {
-            int idelay = 0;
-            if (filter_type_ == FILTER_TYPE_LADDER)
-              idelay = voice->ladder_filter_.delay();
-            if (filter_type_ == FILTER_TYPE_SKFILTER)
-              idelay = voice->skfilter_.delay();
-            if (idelay)
+            Voice *voice = &voices_[b * VOICE_LANES + l];
+            if (voice->state_ != Voice::IDLE)
               {
-                // compensate FIR oversampling filter latency
-                float junk[idelay];
-                render_voice (voice, idelay, junk, junk);
+                lanes[l] = voice;
+                active = true;
               }
-            voice->new_voice_ = false;
-          }
-        float mix_left_out[n_frames];
-        float mix_right_out[n_frames];
-
-        render_voice (voice, n_frames, mix_left_out, mix_right_out);
-
-        // apply volume envelope
-        float volume_env[n_frames];
-        voice->envelope_.process (volume_env, n_frames);
-        float post_gain_factor = db2voltage (get_param (POST_GAIN));
-        for (uint i = 0; i < n_frames; i++)
-          {
-            float amp = post_gain_factor * volume_env[i];
-            left_out[i] += mix_left_out[i] * amp;
-            right_out[i] += mix_right_out[i] * amp;
-          }
-        if (voice->envelope_.done())
-          {
-            voice->state_ = Voice::IDLE;
-            need_free = true;
           }
+        if (!active)
+          continue;
+
+        for (uint offset = 0; offset < n_frames; offset += BATCH_FRAMES)
+          render_batch (batches_[b], lanes, std::min (n_frames - offset, BATCH_FRAMES), left_out + offset, right_out + offset);
+
+        for (Voice *voice : lanes)
+          if (voice && voice->state_ != Voice::STEAL && voice->envelope_.done())
+            {
+              voice->state_ = Voice::IDLE;
+              need_free = true;
+              // silent lanes need no waveform transitions
+              batches_[b].osc1_.frequency_base[voice->lane_] = 0;
+              batches_[b].osc2_.frequency_base[voice->lane_] = 0;
+            }
       }
     if (need_free)
       free_unused_voices();
@@ -1012,6 +1768,11 @@ class BlepSynth : public AudioProcessor {
             for (auto voice : active_voices_)
               if (voice->state_ == Voice::ON && voice->channel_ == ev.channel)
                 note_off (voice->channel_, voice->midi_note_);
+              else if (voice->state_ == Voice::STEAL && voice->steal_note_.channel == ev.channel)
+                voice->steal_note_.release = true;
+            for (uint i = 0; i < n_queued_notes_; i++)
+              if (queued_notes_[i].channel == ev.channel)
+                queued_notes_[i].release = true;
             break;
           case MidiMessage::PARAM_VALUE:
             apply_event (ev);
@@ -1022,6 +1783,10 @@ class BlepSynth : public AudioProcessor {
       }
     // process frames after last event
     render_audio (left_out + offset, right_out + offset, n_frames - offset);
+    if (governor_)
+      govern_load (n_frames);
+    // sleep while no voices are sounding
+    set_tail (active_voices_.empty() ? 0 : -1);
   }
 
   static double
@@ -1065,4 +1830,397 @@ public:
 };
 static auto blepsynth = register_audio_processor<BlepSynth> ("Ase::Devices::BlepSynth");
 
+// == Tests ==
+static void
+setup_test_osc (auto& osc, int unison)
+{
+  osc.shape_base       = 0.3;
+  osc.pulse_width_base = 0.3;
+  osc.sub_base         = 0.2;
+  osc.sync_base        = 7;
+  osc.set_unison (unison, 6, 0.5);
+}
+
+static void
+setup_test_envelope (FlexADSR& envelope, FlexADSR::Shape shape, uint voice)
+{
+  envelope.set_shape (shape);
+  envelope.set_attack (0.001 + 0.004 * (voice % 3));
+  envelope.set_decay (0.02);
+  envelope.set_sustain (40 + voice * 2);
+  envelope.set_release (0.01 + 0.002 * voice);
+  envelope.set_attack_slope (0.5);
+  envelope.set_decay_slope (-1);
+  envelope.set_release_slope (-0.3);
+  envelope.set_rate (48000);
+  envelope.start();
+}
+
+TEST_INTEGRITY (blepsynth_voice_lanes_test);
+static void
+blepsynth_voice_lanes_test()
+{
+  constexpr uint L = SIMD_FLOAT_LANES, N = 128;
+  float left[N], right[N], lanes_left[N * L], lanes_right[N * L];
+  // OscBatch lanes must match OscImpl
+  for (int unison : { 1, 5 })
+    {
+      BlepUtils::OscImpl osc[L];
+      BlepUtils::OscBatch<L> batch;
+      setup_test_osc (batch, unison);
+      for (uint l = 0; l < L; l++)
+        {
+          setup_test_osc (osc[l], unison);
+          osc[l].frequency_base = 110 * (l + 1) + l;
+          osc[l].set_rate (48000);
+          osc[l].reset();
+          if (l & 1)
+            osc[l].process_sample_stereo (left, right, 1 + l); // lanes start at different positions
+          batch.import_lane (l, osc[l]);
+        }
+      double max_diff = 0;
+      for (uint block = 0; block < 100; block++)
+        {
+          const uint n = 1 + block * 7 % N;
+          batch.process_sample_stereo (lanes_left, lanes_right, n);
+          for (uint l = 0; l < L; l++)
+            {
+              osc[l].process_sample_stereo (left, right, n);
+              for (uint i = 0; i < n; i++)
+                max_diff = std::max (max_diff, std::max (std::abs (left[i] - lanes_left[i * L + l]),
+                                                         std::abs (right[i] - lanes_right[i * L + l])) * 1.0);
+            }
+        }
+      TASSERT (max_diff < 1e-5);
+    }
+  // FlexADSR::process_lanes() must match FlexADSR::process()
+  for (auto shape : { FlexADSR::Shape::FLEXIBLE, FlexADSR::Shape::EXPONENTIAL, FlexADSR::Shape::LINEAR })
+    {
+      FlexADSR envelope[L], lanes_envelope[L], *lanes[L];
+      for (uint l = 0; l < L; l++)
+        {
+          setup_test_envelope (envelope[l], shape, l);
+          setup_test_envelope (lanes_envelope[l], shape, l);
+          lanes[l] = l == 1 ? nullptr : &lanes_envelope[l];
+        }
+      double max_diff = 0;
+      for (uint block = 0; block < 200; block++)
+        {
+          const uint n = 1 + block * 37 % N;
+          FlexADSR::process_lanes<L> (lanes, lanes_left, n);
+          for (uint l = 0; l < L; l++)
+            {
+              envelope[l].process (left, n);
+              for (uint i = 0; i < n; i++)
+                max_diff = std::max (max_diff, std::abs ((lanes[l] ? left[i] : 0) - lanes_left[i * L + l]) * 1.0);
+            }
+          for (uint l = 0; l < L; l++)
+            if (block == 40 + 5 * l) // release
+              {
+                envelope[l].stop();
+                lanes_envelope[l].stop();
+              }
+            else if (block == 20) // sustain smoothing
+              {
+                envelope[l].set_sustain (20);
+                lanes_envelope[l].set_sustain (20);
+              }
+        }
+      TASSERT (max_diff < 1e-5);
+      for (uint l = 0; l < L; l++)
+        TASSERT (!lanes[l] || lanes[l]->done() == envelope[l].done());
+    }
+}
+
+TEST_INTEGRITY (blepsynth_voice_stealing_test);
+static void
+blepsynth_voice_stealing_test()
+{
+  const StealCandidate candidates[] = {
+    { .released = false, .fading = false, .note_id = 2, .level = 0.5 },  // oldest
+    { .released = true,  .fading = false, .note_id = 4, .level = 0.3 },  // released
+    { .released = false, .fading = false, .note_id = 5, .level = 0.1 },  // quietest
+    { .released = false, .fading = true,  .note_id = 1, .level = 0 },    // already stolen
+  };
+  TCMP (pick_steal_victim (candidates, 4, STEAL_RELEASED), ==, 1u);
+  TCMP (pick_steal_victim (candidates, 4, STEAL_OLDEST), ==, 0u);
+  TCMP (pick_steal_victim (candidates, 4, STEAL_QUIETEST), ==, 2u);
+  // without released voices, the oldest voice is stolen
+  const StealCandidate playing[] = { candidates[2], candidates[0], candidates[3] };
+  TCMP (pick_steal_victim (playing, 3, STEAL_RELEASED), ==, 1u);
+  // fading voices are never stolen, their pending note would be lost
+  TCMP (pick_steal_victim (candidates + 3, 1, STEAL_OLDEST), ==, 1u);
+  const StealCandidate fading[] = { candidates[3], candidates[3], candidates[2] };
+  TCMP (pick_steal_victim (fading, 3, STEAL_OLDEST), ==, 2u);
+  TCMP (pick_steal_victim (fading, 2, STEAL_QUIETEST), ==, 2u);
+  TCMP (pick_steal_victim (candidates, 0, STEAL_OLDEST), ==, 0u);
+  // the fade-out ramps down to silence across blocks
+  constexpr uint FADE = 48;
+  float env[2 * FADE];
+  floatfill (env, 1.0, 2 * FADE);
+  uint fade_frames = FADE;
+  steal_fade (env, 1, FADE / 2 + 3, &fade_frames, FADE);
+  steal_fade (env + FADE / 2 + 3, 1, 2 * FADE - (FADE / 2 + 3), &fade_frames, FADE);
+  TCMP (fade_frames, ==, 0u);
+  TCMP (env[0], ==, 1.0);
+  for (uint i = 1; i < FADE; i++)
+    TASSERT (env[i] < env[i - 1] && env[i - 1] - env[i] < 1.01 / FADE);
+  for (uint i = FADE; i < 2 * FADE; i++)
+    TCMP (env[i], ==, 0.0);
+}
+
+TEST_INTEGRITY (blepsynth_filter_lanes_test);
+static void
+blepsynth_filter_lanes_test()
+{
+  constexpr uint L = SIMD_FLOAT_LANES, N = 64;
+  alignas (64) float left[N * L], right[N * L], freq[N * L], reso[N * L], drive[N * L];
+  // oversampling round trip must reproduce the delayed input
+  for (uint over : { 2, 4, 8 })
+    {
+      LaneOversampler<L> oversampler (over, N);
+      alignas (64) float over_samples[N * 8 * L];
+      double max_diff = 0;
+      for (uint block = 0; block < 20; block++)
+        {
+          for (uint i = 0; i < N * L; i++)
+            left[i] = sin ((block * N + i / L) * 2 * M_PI * 1000 / 48000 + i % L);
+          oversampler.upsample (left, N, over_samples);
+          oversampler.downsample (over_samples, N, right);
+          for (uint i = 0; block > 2 && i < N * L; i++)
+            max_diff = std::max (max_diff, std::abs (right[i] - sin ((block * N + i / L - oversampler.delay()) * 2 * M_PI * 1000 / 48000 + i % L)));
+        }
+      TASSERT (max_diff < 0.001);
+    }
+  // filter lanes are independent, lanes with lower cutoff attenuate more
+  auto check_filter = [&] (auto& filter) {
+    double energy[L] = { 0, };
+    for (uint block = 0; block < 20; block++)
+      {
+        for (uint i = 0; i < N * L; i++)
+          {
+            const uint l = i % L;
+            left[i] = right[i] = sin ((block * N + i / L) * 2 * M_PI * 5000 / 48000);
+            freq[i] = 1000 * (1 + l / 2);
+            reso[i] = 0.3;
+            drive[i] = 0;
+          }
+        filter.process_block (N, left, right, freq, reso, drive);
+        for (uint i = 0; block > 2 && i < N * L; i++)
+          {
+            TASSERT (right[i] == left[i]);
+            energy[i % L] += left[i] * left[i];
+          }
+      }
+    for (uint l = 0; l + 1 < L; l += 2)
+      TASSERT (energy[l] == energy[l + 1]);
+    for (uint l = 2; l + 1 < L; l += 2)
+      TASSERT (energy[l] > energy[l - 2]);
+  };
+  LadderVCFLanes<L> ladder (4);
+  check_filter (ladder);
+  SKFilterLanes<L> skfilter (4);
+  check_filter (skfilter);
+}
+
+// filter lanes with per sample and constant parameters against the scalar filter of each lane
+template<class Filter, class FilterLanes> static void
+filter_lanes_vs_scalar (typename Filter::Mode mode)
+{
+  constexpr uint L = SIMD_FLOAT_LANES, N = 64;
+  alignas (64) float left[N * L], right[N * L], const_left[N * L], const_right[N * L], freq[N * L], reso[N * L], drive[N * L];
+  std::vector<std::unique_ptr<Filter>> filters;
+  for (uint l = 0; l < L; l++)
+    {
+      filters.push_back (std::make_unique<Filter> (4));
+      filters[l]->set_mode (mode);
+      filters[l]->set_freq (500 * (l + 1));
+      filters[l]->set_reso (0.5);
+      filters[l]->set_drive (0);
+    }
+  FilterLanes lanes (4), const_lanes (4);
+  lanes.set_mode (mode);
+  const_lanes.set_mode (mode);
+  for (uint l = 0; l < L; l++)
+    {
+      const_lanes.set_freq (l, 500 * (l + 1));
+      const_lanes.set_reso (l, 0.5);
+      const_lanes.set_drive (l, 0);
+    }
+  double scalar_energy[L] = { 0, }, lanes_energy[L] = { 0, }, max_const_diff = 0;
+  for (uint block = 0; block < 40; block++)
+    {
+      for (uint i = 0; i < N * L; i++)
+        {
+          const_left[i] = const_right[i] = left[i] = right[i] = 0.5 * sin ((block * N + i / L) * 2 * M_PI * 440 / 48000);
+          freq[i] = 500 * (i % L + 1);
+          reso[i] = 0.5;
+          drive[i] = 0;
+        }
+      lanes.process_block (N, left, right, freq, reso, drive);
+      const_lanes.process_block (N, const_left, const_right);
+      for (uint l = 0; l < L; l++)
+        {
+          float scalar_left[N], scalar_right[N];
+          for (uint i = 0; i < N; i++)
+            scalar_left[i] = scalar_right[i] = 0.5 * sin ((block * N + i) * 2 * M_PI * 440 / 48000);
+          filters[l]->process_block (N, scalar_left, scalar_right);
+          for (uint i = 0; block >= 10 && i < N; i++)
+            {
+              scalar_energy[l] += scalar_left[i] * scalar_left[i];
+              lanes_energy[l] += left[i * L + l] * left[i * L + l];
+            }
+        }
+      for (uint i = 0; i < N * L; i++)
+        max_const_diff = std::max<double> (max_const_diff, std::abs (const_left[i] - left[i]) + std::abs (const_right[i] - right[i]));
+    }
+  // only the oversampling filters differ, which have a flat pass band
+  for (uint l = 0; l < L; l++)
+    TASSERT (std::abs (sqrt (lanes_energy[l] / scalar_energy[l]) - 1) < 0.01);
+  TASSERT (max_const_diff < 1e-5);
+}
+
+TEST_INTEGRITY (blepsynth_filter_lanes_scalar_test);
+static void
+blepsynth_filter_lanes_scalar_test()
+{
+  for (auto mode : { LadderVCF::LP1, LadderVCF::LP2, LadderVCF::LP3, LadderVCF::LP4 })
+    filter_lanes_vs_scalar<LadderVCF, LadderVCFLanes<SIMD_FLOAT_LANES>> (mode);
+  for (auto mode : { SKFilter::LP1, SKFilter::LP4, SKFilter::LP8, SKFilter::BP4, SKFilter::HP2, SKFilter::HP6 })
+    filter_lanes_vs_scalar<SKFilter, SKFilterLanes<SIMD_FLOAT_LANES>> (mode);
+}
+
+// oscillators, mix and volume envelope of a BlepSynth voice, rendered per voice or per batch
+template<bool BATCHED> static void
+blepsynth_voices_bench (uint n_voices, int unison)
+{
+  constexpr uint L = SIMD_FLOAT_LANES, N = 128, BLOCKS = 64;
+  const uint n_batches = (n_voices + L - 1) / L;
+  std::vector<BlepUtils::OscImpl> osc1 (n_voices), osc2 (n_voices);
+  std::vector<BlepUtils::OscBatch<L>> batch1 (n_batches), batch2 (n_batches);
+  std::vector<FlexADSR> envelopes (n_voices);
+  for (uint v = 0; v < n_voices; v++)
+    {
+      for (auto *osc : { &osc1[v], &osc2[v] })
+        {
+          setup_test_osc (*osc, unison);
+          osc->frequency_base = 55 * (1 + v % 24);
+          osc->set_rate (48000);
+          osc->reset();
+        }
+      setup_test_osc (batch1[v / L], unison);
+      setup_test_osc (batch2[v / L], unison);
+      batch1[v / L].import_lane (v % L, osc1[v]);
+      batch2[v / L].import_lane (v % L, osc2[v]);
+      setup_test_envelope (envelopes[v], FlexADSR::Shape::FLEXIBLE, v);
+    }
+  float left_out[N], right_out[N];
+  auto render = [&] () {
+    for (uint block = 0; block < BLOCKS; block++)
+      {
+        floatfill (left_out, 0, N);
+        floatfill (right_out, 0, N);
+        if (BATCHED)
+          for (uint b = 0; b < n_batches; b++)
+            {
+              using FloatV = SimdVector<float, L>;
+              alignas (64) float o1l[N * L], o1r[N * L], o2l[N * L], o2r[N * L], env[N * L];
+              batch1[b].process_sample_stereo (o1l, o1r, N);
+              batch2[b].process_sample_stereo (o2l, o2r, N);
+              FlexADSR *lanes[L] = {};
+              for (uint l = 0; l < L && b * L + l < n_voices; l++)
+                lanes[l] = &envelopes[b * L + l];
+              FlexADSR::process_lanes<L> (lanes, env, N);
+              for (uint i = 0; i < N; i++)
+                {
+                  FloatV l1, r1, l2, r2, e;
+                  simd_load (l1, o1l + i * L);
+                  simd_load (r1, o1r + i * L);
+                  simd_load (l2, o2l + i * L);
+                  simd_load (r2, o2r + i * L);
+                  simd_load (e, env + i * L);
+                  left_out[i] += simd_sum ((l1 * 0.7f + l2 * 0.3f) * e);
+                  right_out[i] += simd_sum ((r1 * 0.7f + r2 * 0.3f) * e);
+                }
+            }
+        else
+          for (uint v = 0; v < n_voices; v++)
+            {
+              float o1l[N], o1r[N], o2l[N], o2r[N], env[N];
+              osc1[v].process_sample_stereo (o1l, o1r, N);
+              osc2[v].process_sample_stereo (o2l, o2r, N);
+              envelopes[v].process (env, N);
+              for (uint i = 0; i < N; i++)
+                {
+                  left_out[i] += (o1l[i] * 0.7f + o2l[i] * 0.3f) * env[i];
+                  right_out[i] += (o1r[i] * 0.7f + o2r[i] * 0.3f) * env[i];
+                }
+            }
+      }
+  };
+  Test::Timer timer (0.15);
+  const double bench_time = timer.benchmark (render);
+  const double rendered_secs = BLOCKS * N / 48000.0;
+  printerr ("  BENCH    BlepSynth %-8s unison=%-2d %2u voices: %8.1f voices per core\n",
+            BATCHED ? "batched:" : "scalar:", unison, n_voices, n_voices * rendered_secs / bench_time);
+}
+
+TEST_BENCHMARK (blepsynth_voices_benchmarks);
+static void
+blepsynth_voices_benchmarks()
+{
+  for (int unison : { 1, 4 })
+    {
+      blepsynth_voices_bench<false> (32, unison);
+      blepsynth_voices_bench<true> (32, unison);
+    }
+}
+
+// oversampled filter stage of a BlepSynth voice, filtered per voice or per batch
+template<class Filter, class FilterLanes> static void
+blepsynth_filter_bench (const char *name, uint n_voices)
+{
+  constexpr uint L = SIMD_FLOAT_LANES, N = 128, BLOCKS = 64;
+  constexpr int over = 4; // same as the filter oversampling of BlepSynth voices
+  const uint n_batches = (n_voices + L - 1) / L;
+  std::vector<std::unique_ptr<Filter>> filters;
+  std::vector<std::unique_ptr<FilterLanes>> batch_filters;
+  for (uint v = 0; v < n_voices; v++)
+    filters.push_back (std::make_unique<Filter> (over));
+  for (uint b = 0; b < n_batches; b++)
+    batch_filters.push_back (std::make_unique<FilterLanes> (over));
+  alignas (64) float left[N * L], right[N * L], freq[N * L], reso[N * L], drive[N * L];
+  for (uint i = 0; i < N * L; i++)
+    {
+      left[i] = right[i] = sin (i / L * 2 * M_PI * 220 / 48000);
+      freq[i] = 500 + 100 * (i % L);
+      reso[i] = 0.7;
+      drive[i] = 0;
+    }
+  auto render_scalar = [&] () {
+    for (uint block = 0; block < BLOCKS; block++)
+      for (uint v = 0; v < n_voices; v++)
+        filters[v]->process_block (N, left, right, freq, reso, drive);
+  };
+  auto render_batched = [&] () {
+    for (uint block = 0; block < BLOCKS; block++)
+      for (uint b = 0; b < n_batches; b++)
+        batch_filters[b]->process_block (N, left, right, freq, reso, drive);
+  };
+  const double rendered_secs = BLOCKS * N / 48000.0;
+  Test::Timer timer (0.15);
+  double bench_time = timer.benchmark (render_scalar);
+  printerr ("  BENCH    BlepSynth %-9s scalar:  %2u voices: %8.1f voices per core\n", name, n_voices, n_voices * rendered_secs / bench_time);
+  bench_time = timer.benchmark (render_batched);
+  printerr ("  BENCH    BlepSynth %-9s batched: %2u voices: %8.1f voices per core\n", name, n_voices, n_voices * rendered_secs / bench_time);
+}
+
+TEST_BENCHMARK (blepsynth_filter_benchmarks);
+static void
+blepsynth_filter_benchmarks()
+{
+  blepsynth_filter_bench<LadderVCF, LadderVCFLanes<SIMD_FLOAT_LANES>> ("ladder:", 32);
+  blepsynth_filter_bench<SKFilter, SKFilterLanes<SIMD_FLOAT_LANES>> ("skfilter:", 32);
+}
+
 } // Anon
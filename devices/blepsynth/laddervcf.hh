@@ -4,6 +4,7 @@
 
 #define PANDA_RESAMPLER_HEADER_ONLY
 #include "pandaresampler.hh"
+#include "devices/blepsynth/laneresampler.hh"
 
 #include <array>
 #include <algorithm>
@@ -14,8 +15,11 @@ namespace Ase {
 
 using PandaResampler::Resampler2;
 
+template<uint LANES> class LadderVCFLanes;
+
 class LadderVCF
 {
+  template<uint LANES> friend class LadderVCFLanes;
 public:
   enum Mode {
     LP1, LP2, LP3, LP4
@@ -152,10 +156,15 @@ private:
   }
   void
   setup_reso_drive (FParams& fparams, float reso, float drive)
+  {
+    setup_reso_drive (fparams, reso, drive, global_volume_, test_linear_);
+  }
+  static void
+  setup_reso_drive (FParams& fparams, float reso, float drive, float global_volume, bool test_linear)
   {
     reso = std::clamp (reso, 0.001f, 1.f);
 
-    if (test_linear_) // test filter as linear filter; don't do any resonance correction
+    if (test_linear) // test filter as linear filter; don't do any resonance correction
       {
         const float scale = 1e-5;
         fparams.pre_scale = scale;
@@ -178,8 +187,8 @@ private:
       reso += drive * sqrt (reso) * reso * 0.03f;
 
     float vol = exp2f ((drive + -12 * sqrt (reso)) * db_x2_factor);
-    fparams.pre_scale = negative_drive_vol * vol * global_volume_;
-    fparams.post_scale = std::max (1 / vol, 1.0f) / global_volume_;
+    fparams.pre_scale = negative_drive_vol * vol * global_volume;
+    fparams.post_scale = std::max (1 / vol, 1.0f) / global_volume;
     fparams.reso = sqrt (reso) * 4;
   }
   static float
@@ -390,4 +399,292 @@ public:
   }
 };
 
+/* LadderVCF for several voices at once, each voice uses one SIMD lane. Samples and the
+ * per sample freq / reso / drive inputs are interleaved, [frame * LANES + lane], all voices
+ * share the filter mode, and the oversampling filters run for all voices in one pass.
+ */
+template<uint LANES>
+class LadderVCFLanes
+{
+  using FloatV = SimdVector<float, LANES>;
+  using Mode = LadderVCF::Mode;
+  using FParams = LadderVCF::FParams;
+  struct Channel {
+    FloatV x1, x2, x3, x4;
+    FloatV y1, y2, y3, y4;
+  };
+  static constexpr uint MAX_BLOCK_SIZE = 32;
+  static constexpr uint MAX_OVER = 8;
+
+  std::array<Channel, 2> channels_;
+  std::array<LaneOversampler<LANES>, 2> oversamplers_;
+  Mode mode_ = LadderVCF::LP4;
+  float rate_ = 0;
+  float freq_scale_factor_ = 0;
+  float frequency_range_min_ = 0;
+  float frequency_range_max_ = 0;
+  float clamp_freq_min_ = 0;
+  float clamp_freq_max_ = 0;
+  float global_volume_ = 1;
+  uint over_ = 0;
+  bool test_linear_ = false;
+
+  FloatV freq_ = {};        // set_freq() / set_reso() / set_drive() values for constant parameters
+  FloatV reso_param_ = {};
+  FloatV drive_param_ = {};
+
+  FloatV reso_ = {};
+  FloatV pre_scale_ = {};
+  FloatV post_scale_ = {};
+  uint64 fparams_valid_ = 0; // bit mask of lanes
+public:
+  LadderVCFLanes (int over) :
+    oversamplers_ { LaneOversampler<LANES> (over, MAX_BLOCK_SIZE), LaneOversampler<LANES> (over, MAX_BLOCK_SIZE) },
+    over_ (over)
+  {
+    static_assert (LANES <= 64);
+    set_rate (48000);
+    set_frequency_range (10, 24000);
+    reset();
+  }
+  void
+  set_mode (Mode new_mode)
+  {
+    mode_ = new_mode;
+  }
+  void
+  set_freq (uint lane, float freq)
+  {
+    freq_[lane] = freq;
+  }
+  void
+  set_reso (uint lane, float reso)
+  {
+    reso_param_[lane] = reso;
+    fparams_valid_ &= ~(uint64 (1) << lane);
+  }
+  void
+  set_drive (uint lane, float drive)
+  {
+    drive_param_[lane] = drive;
+    fparams_valid_ &= ~(uint64 (1) << lane);
+  }
+  void
+  set_global_volume (float global_volume)
+  {
+    global_volume_ = global_volume;
+    fparams_valid_ = 0;
+  }
+  void
+  set_test_linear (bool test_linear)
+  {
+    test_linear_ = test_linear;
+    fparams_valid_ = 0;
+  }
+  void
+  set_rate (float r)
+  {
+    rate_ = r;
+    freq_scale_factor_ = 2 * M_PI / (rate_ * over_);
+
+    update_frequency_range();
+  }
+  void
+  set_frequency_range (float min_freq, float max_freq)
+  {
+    frequency_range_min_ = min_freq;
+    frequency_range_max_ = max_freq;
+
+    update_frequency_range();
+  }
+  void
+  reset()
+  {
+    for (auto& c : channels_)
+      c = Channel{};
+    for (auto& oversampler : oversamplers_)
+      oversampler.reset();
+    fparams_valid_ = 0;
+  }
+  void
+  reset_lane (uint lane)
+  {
+    for (auto& c : channels_)
+      for (FloatV *v : { &c.x1, &c.x2, &c.x3, &c.x4, &c.y1, &c.y2, &c.y3, &c.y4 })
+        (*v)[lane] = 0;
+    for (auto& oversampler : oversamplers_)
+      oversampler.reset_lane (lane);
+    fparams_valid_ &= ~(uint64 (1) << lane);
+  }
+  /* oversampling latency in frames, may be fractional */
+  double
+  delay()
+  {
+    return oversamplers_[0].delay();
+  }
+private:
+  void
+  update_frequency_range()
+  {
+    clamp_freq_min_ = frequency_range_min_;
+    clamp_freq_max_ = std::min (frequency_range_max_, rate_ * over_ * 0.49f);
+  }
+  static FloatV
+  tanh_approx (FloatV x)
+  {
+    x = simd_clamp (x, -3.0f, 3.0f);
+
+    return x * (27.0f + x * x) / (27.0f + 9.0f * x * x);
+  }
+  /* filter n_samples oversampled frames of both channels with constant cutoff, see LadderVCF::run() */
+  template<Mode MODE> inline void
+  run (float *left, float *right, FloatV freq, uint n_samples)
+  {
+    const FloatV fc = simd_clamp (freq, clamp_freq_min_, clamp_freq_max_) * freq_scale_factor_;
+    const FloatV g = 0.9892f * fc - 0.4342f * fc * fc + 0.1381f * fc * fc * fc - 0.0202f * fc * fc * fc * fc;
+    const FloatV b0 = g * (1 / 1.3f);
+    const FloatV b1 = g * (0.3f / 1.3f);
+    const FloatV a1 = g - 1;
+
+    FloatV res = reso_;
+    res *= 1.0029f + 0.0526f * fc - 0.0926f * fc * fc + 0.0218f * fc * fc * fc;
+
+    for (uint os = 0; os < n_samples; os++)
+      for (uint i = 0; i < 2; i++)
+        {
+          float *value = (i == 0 ? left : right) + os * LANES;
+          Channel& c = channels_[i];
+
+          FloatV x;
+          simd_load (x, value);
+          x *= pre_scale_;
+          const float g_comp = 0.5f; // passband gain correction
+          const FloatV x0 = tanh_approx (x - (c.y4 - g_comp * x) * res);
+
+          c.y1 = b0 * x0 + b1 * c.x1 - a1 * c.y1;
+          c.x1 = x0;
+
+          c.y2 = b0 * c.y1 + b1 * c.x2 - a1 * c.y2;
+          c.x2 = c.y1;
+
+          c.y3 = b0 * c.y2 + b1 * c.x3 - a1 * c.y3;
+          c.x3 = c.y2;
+
+          c.y4 = b0 * c.y3 + b1 * c.x4 - a1 * c.y4;
+          c.x4 = c.y3;
+
+          switch (MODE)
+            {
+              case LadderVCF::LP1: simd_store (value, c.y1 * post_scale_); break;
+              case LadderVCF::LP2: simd_store (value, c.y2 * post_scale_); break;
+              case LadderVCF::LP3: simd_store (value, c.y3 * post_scale_); break;
+              case LadderVCF::LP4: simd_store (value, c.y4 * post_scale_); break;
+            }
+        }
+  }
+  template<Mode MODE> void
+  process_block_mode (uint n_samples, float *left, float *right, const float *freq_in, const float *reso_in, const float *drive_in)
+  {
+    alignas (64) float over_samples_left[MAX_BLOCK_SIZE * MAX_OVER * LANES];
+    alignas (64) float over_samples_right[MAX_BLOCK_SIZE * MAX_OVER * LANES];
+
+    oversamplers_[0].upsample (left, n_samples, over_samples_left);
+    oversamplers_[1].upsample (right, n_samples, over_samples_right);
+
+    if (!freq_in)
+      {
+        /* use more efficient version of the filter computation if all parameters are constants */
+        for (uint l = 0; l < LANES; l++)
+          if (!(fparams_valid_ & uint64 (1) << l))
+            {
+              FParams fparams;
+              LadderVCF::setup_reso_drive (fparams, reso_param_[l], drive_param_[l], global_volume_, test_linear_);
+              reso_[l] = fparams.reso;
+              pre_scale_[l] = fparams.pre_scale;
+              post_scale_[l] = fparams.post_scale;
+            }
+        fparams_valid_ = ~uint64 (0);
+
+        run<MODE> (over_samples_left, over_samples_right, freq_, n_samples * over_);
+        oversamplers_[0].downsample (over_samples_left, n_samples, left);
+        oversamplers_[1].downsample (over_samples_right, n_samples, right);
+        return;
+      }
+
+    /* interpolate pre_scale / post_scale / reso parameters towards the values at the block end,
+     * per lane filter parameter setup only happens once per block
+     */
+    FloatV end_reso, end_pre_scale, end_post_scale;
+    for (uint l = 0; l < LANES; l++)
+      {
+        FParams fparams;
+        if (!(fparams_valid_ & uint64 (1) << l))
+          {
+            LadderVCF::setup_reso_drive (fparams, reso_in[l], drive_in[l], global_volume_, test_linear_);
+            reso_[l] = fparams.reso;
+            pre_scale_[l] = fparams.pre_scale;
+            post_scale_[l] = fparams.post_scale;
+          }
+        const uint last = (n_samples - 1) * LANES + l;
+        LadderVCF::setup_reso_drive (fparams, reso_in[last], drive_in[last], global_volume_, test_linear_);
+        end_reso[l] = fparams.reso;
+        end_pre_scale[l] = fparams.pre_scale;
+        end_post_scale[l] = fparams.post_scale;
+      }
+    fparams_valid_ = ~uint64 (0);
+
+    const float todo_inv = 1.f / n_samples;
+    const FloatV delta_reso = (end_reso - reso_) * todo_inv;
+    const FloatV delta_pre_scale = (end_pre_scale - pre_scale_) * todo_inv;
+    const FloatV delta_post_scale = (end_post_scale - post_scale_) * todo_inv;
+    for (uint i = 0; i < n_samples; i++)
+      {
+        reso_ += delta_reso;
+        pre_scale_ += delta_pre_scale;
+        post_scale_ += delta_post_scale;
+
+        FloatV freq;
+        simd_load (freq, freq_in + i * LANES);
+        run<MODE> (over_samples_left + i * over_ * LANES, over_samples_right + i * over_ * LANES, freq, over_);
+      }
+    oversamplers_[0].downsample (over_samples_left, n_samples, left);
+    oversamplers_[1].downsample (over_samples_right, n_samples, right);
+  }
+public:
+  /* filter interleaved stereo samples in place, freq_in, reso_in and drive_in are either all given per
+   * sample and lane, or all nullptr to use the constant set_freq(), set_reso() and set_drive() values
+   */
+  void
+  process_block (uint n_samples, float *left, float *right, const float *freq_in = nullptr, const float *reso_in = nullptr, const float *drive_in = nullptr)
+  {
+    while (n_samples)
+      {
+        const uint todo = std::min (n_samples, MAX_BLOCK_SIZE);
+
+        switch (mode_)
+          {
+            case LadderVCF::LP4: process_block_mode<LadderVCF::LP4> (todo, left, right, freq_in, reso_in, drive_in);
+                                 break;
+            case LadderVCF::LP3: process_block_mode<LadderVCF::LP3> (todo, left, right, freq_in, reso_in, drive_in);
+                                 break;
+            case LadderVCF::LP2: process_block_mode<LadderVCF::LP2> (todo, left, right, freq_in, reso_in, drive_in);
+                                 break;
+            case LadderVCF::LP1: process_block_mode<LadderVCF::LP1> (todo, left, right, freq_in, reso_in, drive_in);
+                                 break;
+          }
+
+        left += todo * LANES;
+        right += todo * LANES;
+        if (freq_in)
+          freq_in += todo * LANES;
+        if (reso_in)
+          reso_in += todo * LANES;
+        if (drive_in)
+          drive_in += todo * LANES;
+
+        n_samples -= todo;
+      }
+  }
+};
+
 } // SpectMorph
@@ -0,0 +1,231 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+
+#pragma once
+
+#include "ase/simd.hh"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace Ase {
+
+/* Coefficients of a Kaiser windowed half-band FIR filter with 4 * K - 1 taps, apart from the
+ * center tap (0.5) only the 2 * K odd taps are non-zero. Each table is computed once and shared.
+ */
+template<uint K>
+class HalfbandTaps
+{
+  static double
+  bessel_i0 (double x)
+  {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50; k++)
+      {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+      }
+    return sum;
+  }
+  HalfbandTaps (double beta)
+  {
+    double odd_sum = 0;
+    double h[2 * K];
+    for (uint t = 0; t < 2 * K; t++)
+      {
+        const int n = 2 * t - (2 * K - 1);
+        const double r = n / (2.0 * K);
+        const double window = bessel_i0 (beta * std::sqrt (1 - r * r)) / bessel_i0 (beta);
+        h[t] = std::sin (M_PI * n / 2) / (M_PI * n) * window;
+        odd_sum += h[t];
+      }
+    for (uint t = 0; t < 2 * K; t++)
+      {
+        down[t] = h[t] * 0.5 / odd_sum; // exact DC gain of 1
+        up[t] = 2 * down[t];
+      }
+  }
+public:
+  float up[2 * K];      // odd taps for upsampling, scaled by 2 to compensate zero stuffing
+  float down[2 * K];    // odd taps for downsampling
+  static const HalfbandTaps&
+  the()
+  {
+    static const HalfbandTaps taps (8); // beta = 8 yields ca. -80dB stop band attenuation in LaneOversampler
+    return taps;
+  }
+};
+
+/* Resampling by 2 of interleaved samples of several voices, [frame * LANES + lane].
+ * The linear phase filter delays the signal by 2 * K - 1 samples at the higher rate for
+ * upsampling, and by 2 * K - 2 samples for downsampling.
+ */
+template<uint LANES, uint K>
+class LaneHalfband
+{
+  using FloatV = SimdVector<float, LANES>;
+  const HalfbandTaps<K>& taps_;
+  const uint             history_;
+  std::vector<FloatV>    buffer_;   // history_ old input frames, followed by the current block
+public:
+  LaneHalfband (bool up, uint max_block) :
+    taps_ (HalfbandTaps<K>::the()),
+    history_ (up ? 2 * K - 1 : 4 * K - 3),
+    buffer_ (history_ + (up ? max_block : 2 * max_block))
+  {}
+  void
+  reset()
+  {
+    std::fill (buffer_.begin(), buffer_.end(), FloatV{});
+  }
+  void
+  reset_lane (uint lane)
+  {
+    for (FloatV& v : buffer_)
+      v[lane] = 0;
+  }
+  /* upsample n_frames input frames to 2 * n_frames output frames */
+  void
+  upsample (const float *in, uint n_frames, float *out)
+  {
+    FloatV *buf = buffer_.data();
+    for (uint i = 0; i < n_frames; i++)
+      simd_load (buf[history_ + i], in + i * LANES);
+    for (uint m = 0; m < n_frames; m++)
+      {
+        const FloatV *x = buf + history_ + m; // newest input frame
+        FloatV acc = {};
+        for (uint t = 0; t < K; t++)
+          acc += taps_.up[t] * (x[-int (t)] + x[int (t) - int (2 * K - 1)]);
+        simd_store (out + 2 * m * LANES, acc);
+        simd_store (out + (2 * m + 1) * LANES, x[1 - int (K)]);
+      }
+    std::copy (buf + n_frames, buf + n_frames + history_, buf);
+  }
+  /* downsample 2 * n_frames input frames to n_frames output frames */
+  void
+  downsample (const float *in, uint n_frames, float *out)
+  {
+    FloatV *buf = buffer_.data();
+    for (uint i = 0; i < 2 * n_frames; i++)
+      simd_load (buf[history_ + i], in + i * LANES);
+    for (uint m = 0; m < n_frames; m++)
+      {
+        const FloatV *x = buf + history_ + 2 * m + 1; // newest input frame
+        FloatV acc = 0.5f * x[1 - int (2 * K)];
+        for (uint t = 0; t < K; t++)
+          acc += taps_.down[t] * (x[-2 * int (t)] + x[2 + 2 * int (t) - 4 * int (K)]);
+        simd_store (out + m * LANES, acc);
+      }
+    std::copy (buf + 2 * n_frames, buf + 2 * n_frames + history_, buf);
+  }
+};
+
+/* Oversampling by 1, 2, 4 or 8 of interleaved samples of LANES voices, processing all voices
+ * in one pass. The first stage uses a steep half-band filter, later stages only need to
+ * suppress the images above the original nyquist frequency and use fewer taps.
+ */
+template<uint LANES>
+class LaneOversampler
+{
+  static constexpr uint K0 = 16, K1 = 5;
+  uint                    over_;
+  LaneHalfband<LANES, K0> up0_, down0_;
+  LaneHalfband<LANES, K1> up1_, down1_, up2_, down2_;
+public:
+  LaneOversampler (uint over, uint max_block) :
+    over_ (over),
+    up0_ (true, max_block), down0_ (false, max_block),
+    up1_ (true, 2 * max_block), down1_ (false, 2 * max_block),
+    up2_ (true, 4 * max_block), down2_ (false, 4 * max_block)
+  {
+    ASE_ASSERT_RETURN (over == 1 || over == 2 || over == 4 || over == 8);
+  }
+  uint
+  over() const
+  {
+    return over_;
+  }
+  /* signal delay of upsampling followed by downsampling, in input samples, fractional for
+   * over() >= 4 (34.75 for over() == 4), callers that need whole frames must round
+   */
+  double
+  delay() const
+  {
+    // per stage, up: 2 * K - 1 and down: 2 * K - 2 samples at the higher rate
+    double delay = 0;
+    if (over_ >= 2)
+      delay += (4 * K0 - 3) / 2.0;
+    if (over_ >= 4)
+      delay += (4 * K1 - 3) / 4.0;
+    if (over_ >= 8)
+      delay += (4 * K1 - 3) / 8.0;
+    return delay;
+  }
+  void
+  reset()
+  {
+    for (auto *stage : { &up0_, &down0_ })
+      stage->reset();
+    for (auto *stage : { &up1_, &down1_, &up2_, &down2_ })
+      stage->reset();
+  }
+  void
+  reset_lane (uint lane)
+  {
+    for (auto *stage : { &up0_, &down0_ })
+      stage->reset_lane (lane);
+    for (auto *stage : { &up1_, &down1_, &up2_, &down2_ })
+      stage->reset_lane (lane);
+  }
+  /* upsample n_frames <= max_block input frames to n_frames * over() output frames */
+  void
+  upsample (const float *in, uint n_frames, float *out)
+  {
+    alignas (64) float tmp[n_frames * 4 * LANES];
+    switch (over_)
+      {
+      case 1:
+        std::copy (in, in + n_frames * LANES, out);
+        break;
+      case 2:
+        up0_.upsample (in, n_frames, out);
+        break;
+      case 4:
+        up0_.upsample (in, n_frames, tmp);
+        up1_.upsample (tmp, 2 * n_frames, out);
+        break;
+      case 8:
+        up0_.upsample (in, n_frames, out);
+        up1_.upsample (out, 2 * n_frames, tmp);
+        up2_.upsample (tmp, 4 * n_frames, out);
+        break;
+      }
+  }
+  /* downsample n_frames * over() input frames to n_frames <= max_block output frames */
+  void
+  downsample (const float *in, uint n_frames, float *out)
+  {
+    alignas (64) float tmp[n_frames * 4 * LANES];
+    switch (over_)
+      {
+      case 1:
+        std::copy (in, in + n_frames * LANES, out);
+        break;
+      case 2:
+        down0_.downsample (in, n_frames, out);
+        break;
+      case 4:
+        down1_.downsample (in, 2 * n_frames, tmp);
+        down0_.downsample (tmp, n_frames, out);
+        break;
+      case 8:
+        down2_.downsample (in, 4 * n_frames, tmp);
+        down1_.downsample (tmp, 2 * n_frames, tmp); // in place is ok, input is buffered first
+        down0_.downsample (tmp, n_frames, out);
+        break;
+      }
+  }
+};
+
+} // Ase
@@ -4,12 +4,16 @@
 
 #define PANDA_RESAMPLER_HEADER_ONLY
 #include "pandaresampler.hh"
+#include "devices/blepsynth/laneresampler.hh"
 #include <algorithm>
 
 using PandaResampler::Resampler2;
 
+template<uint LANES> class SKFilterLanes;
+
 class SKFilter
 {
+  template<uint LANES> friend class SKFilterLanes;
 public:
   enum Mode {
     LP1, LP2, LP3, LP4, LP6, LP8,
@@ -152,12 +156,11 @@ private:
         k[stages - 1] = res * 2;
     }
   };
-  const RTable& rtable_;
 public:
   SKFilter (int over) :
-    over_ (over),
-    rtable_ (RTable::the())
+    over_ (over)
   {
+    RTable::the(); // build the shared table before rendering
     for (auto& channel : channels_)
       {
         channel.res_up   = std::make_unique<Resampler2> (Resampler2::UP, over_, Resampler2::PREC_72DB);
@@ -171,12 +174,17 @@ private:
   void
   setup_reso_drive (FParams& fparams, float reso, float drive)
   {
-    if (test_linear_) // test filter as linear filter; don't do any resonance correction
+    setup_reso_drive (fparams, reso, drive, mode_, global_volume_, test_linear_);
+  }
+  static void
+  setup_reso_drive (FParams& fparams, float reso, float drive, Mode mode, float global_volume, bool test_linear)
+  {
+    if (test_linear) // test filter as linear filter; don't do any resonance correction
       {
         const float scale = 1e-5;
         fparams.pre_scale = scale;
         fparams.post_scale = 1 / scale;
-        setup_k (fparams, reso);
+        setup_k (fparams, reso, mode);
 
         return;
       }
@@ -205,21 +213,21 @@ private:
         reso = 1 - (1-0.9f)*(1-0.9f)*(1-sqrt2/4) + (reso-0.9f)*0.1f;
       }
 
-    fparams.pre_scale = negative_drive_vol * vol * global_volume_;
-    fparams.post_scale = std::max (1 / vol, 1.0f) / global_volume_;
-    setup_k (fparams, reso);
+    fparams.pre_scale = negative_drive_vol * vol * global_volume;
+    fparams.post_scale = std::max (1 / vol, 1.0f) / global_volume;
+    setup_k (fparams, reso, mode);
   }
-  void
-  setup_k (FParams& fparams, float res)
+  static void
+  setup_k (FParams& fparams, float res, Mode mode)
   {
-    if (mode2stages (mode_) == 1)
+    if (mode2stages (mode) == 1)
       {
         // just one stage
         fparams.k[0] = res * 2;
       }
     else
       {
-        rtable_.lookup_resonance (res, mode2stages (mode_), fparams.k.data());
+        RTable::the().lookup_resonance (res, mode2stages (mode), fparams.k.data());
       }
   }
   void
@@ -603,3 +611,363 @@ public:
       }
   }
 };
+
+/* SKFilter for several voices at once, each voice uses one SIMD lane. Samples and the
+ * per sample freq / reso / drive inputs are interleaved, [frame * LANES + lane], all voices
+ * share the filter mode, and the oversampling filters run for all voices in one pass.
+ */
+template<uint LANES>
+class SKFilterLanes
+{
+  using FloatV = Ase::SimdVector<float, LANES>;
+  using Mode = SKFilter::Mode;
+  using FParams = SKFilter::FParams;
+  static constexpr int MAX_STAGES = SKFilter::MAX_STAGES;
+  static constexpr uint MAX_BLOCK_SIZE = 32;
+  static constexpr uint MAX_OVER = 8;
+
+  struct Channel
+  {
+    std::array<FloatV, MAX_STAGES> s1;
+    std::array<FloatV, MAX_STAGES> s2;
+  };
+  std::array<Channel, 2> channels_;
+  std::array<Ase::LaneOversampler<LANES>, 2> oversamplers_;
+  Mode mode_ = SKFilter::LP2;
+  float global_volume_ = 1;
+  bool test_linear_ = false;
+  int over_ = 1;
+  float freq_warp_factor_ = 0;
+  float frequency_range_min_ = 0;
+  float frequency_range_max_ = 0;
+  float clamp_freq_min_ = 0;
+  float clamp_freq_max_ = 0;
+  float rate_ = 0;
+
+  FloatV freq_ = {};        // set_freq() / set_reso() / set_drive() values for constant parameters
+  FloatV reso_param_ = {};
+  FloatV drive_param_ = {};
+
+  std::array<FloatV, MAX_STAGES> k_ = {};
+  FloatV pre_scale_ = {};
+  FloatV post_scale_ = {};
+  Ase::uint64 fparams_valid_ = 0; // bit mask of lanes
+public:
+  SKFilterLanes (int over) :
+    oversamplers_ { Ase::LaneOversampler<LANES> (over, MAX_BLOCK_SIZE), Ase::LaneOversampler<LANES> (over, MAX_BLOCK_SIZE) },
+    over_ (over)
+  {
+    static_assert (LANES <= 64);
+    SKFilter::RTable::the(); // build the shared table before rendering
+    set_rate (48000);
+    set_frequency_range (10, 24000);
+    reset();
+  }
+  void
+  set_mode (Mode m)
+  {
+    if (mode_ != m)
+      {
+        mode_ = m;
+
+        for (auto& c : channels_)
+          c = Channel{};
+        fparams_valid_ = 0;
+      }
+  }
+  void
+  set_freq (uint lane, float freq)
+  {
+    freq_[lane] = freq;
+  }
+  void
+  set_reso (uint lane, float reso)
+  {
+    reso_param_[lane] = reso;
+    fparams_valid_ &= ~(Ase::uint64 (1) << lane);
+  }
+  void
+  set_drive (uint lane, float drive)
+  {
+    drive_param_[lane] = drive;
+    fparams_valid_ &= ~(Ase::uint64 (1) << lane);
+  }
+  void
+  set_global_volume (float global_volume)
+  {
+    global_volume_ = global_volume;
+    fparams_valid_ = 0;
+  }
+  void
+  set_test_linear (bool test_linear)
+  {
+    test_linear_ = test_linear;
+    fparams_valid_ = 0;
+  }
+  void
+  reset()
+  {
+    for (auto& c : channels_)
+      c = Channel{};
+    for (auto& oversampler : oversamplers_)
+      oversampler.reset();
+    fparams_valid_ = 0;
+  }
+  void
+  reset_lane (uint lane)
+  {
+    for (auto& c : channels_)
+      for (int stage = 0; stage < MAX_STAGES; stage++)
+        {
+          c.s1[stage][lane] = 0;
+          c.s2[stage][lane] = 0;
+        }
+    for (auto& oversampler : oversamplers_)
+      oversampler.reset_lane (lane);
+    fparams_valid_ &= ~(Ase::uint64 (1) << lane);
+  }
+  void
+  set_rate (float rate)
+  {
+    freq_warp_factor_ = 4 / (rate * over_);
+    rate_ = rate;
+
+    update_frequency_range();
+  }
+  void
+  set_frequency_range (float min_freq, float max_freq)
+  {
+    frequency_range_min_ = min_freq;
+    frequency_range_max_ = max_freq;
+
+    update_frequency_range();
+  }
+  /* oversampling latency in frames, may be fractional */
+  double
+  delay()
+  {
+    return oversamplers_[0].delay();
+  }
+private:
+  void
+  update_frequency_range()
+  {
+    clamp_freq_min_ = frequency_range_min_;
+    clamp_freq_max_ = std::min (frequency_range_max_, rate_ * over_ * 0.49f);
+  }
+  FloatV
+  cutoff_warp (FloatV freq)
+  {
+    FloatV x = freq * freq_warp_factor_;
+
+    /* approximate tan (pi*x/4) for cutoff warping */
+    const float c1 = -3.16783027;
+    const float c2 =  0.134516124;
+    const float c3 = -4.033321984;
+
+    FloatV x2 = x * x;
+
+    return x * (c1 + c2 * x2) / (c3 + x2);
+  }
+  static FloatV
+  tanh_approx (FloatV x)
+  {
+    x = Ase::simd_clamp (x, -3.0f, 3.0f);
+
+    return x * (27.0f + x * x) / (27.0f + 9.0f * x * x);
+  }
+  /* filter n_samples oversampled frames of both channels with constant cutoff, see SKFilter::process() */
+  template<Mode MODE> void
+  process (float *left, float *right, FloatV freq, uint n_samples)
+  {
+    const FloatV g = cutoff_warp (Ase::simd_clamp (freq, clamp_freq_min_, clamp_freq_max_));
+    const FloatV G = g / (1 + g);
+
+    for (int stage = 0; stage < SKFilter::mode2stages (MODE); stage++)
+      {
+        const FloatV k = k_[stage];
+
+        const FloatV xnorm = 1.f / (1 - k * G + k * G * G);
+        const FloatV s1feedback = -xnorm * k * (G - 1) / (1 + g);
+        const FloatV s2feedback = -xnorm * k / (1 + g);
+
+        auto lowpass = [G] (FloatV in, FloatV& state)
+          {
+            FloatV v = G * (in - state);
+            FloatV y = v + state;
+            state = y + v;
+            return y;
+          };
+
+        auto mode_out = [] (FloatV y0, FloatV y1, FloatV y2, bool last_stage) -> FloatV
+          {
+            FloatV y1hp = y0 - y1;
+            FloatV y2hp = y1 - y2;
+
+            switch (MODE)
+              {
+                case SKFilter::LP2:
+                case SKFilter::LP4:
+                case SKFilter::LP6:
+                case SKFilter::LP8: return y2;
+                case SKFilter::BP2:
+                case SKFilter::BP4:
+                case SKFilter::BP6:
+                case SKFilter::BP8: return y2hp;
+                case SKFilter::HP2:
+                case SKFilter::HP4:
+                case SKFilter::HP6:
+                case SKFilter::HP8: return (y1hp - y2hp);
+                case SKFilter::LP1:
+                case SKFilter::LP3: return last_stage ? y1 : y2;
+                case SKFilter::HP1:
+                case SKFilter::HP3: return last_stage ? y1hp : (y1hp - y2hp);
+             }
+          };
+
+        const bool last_stage = SKFilter::mode2stages (MODE) == (stage + 1);
+        const FloatV pre_scale = last_stage ? pre_scale_ : FloatV{} + 1;
+        const FloatV post_scale = last_stage ? post_scale_ : FloatV{} + 1;
+
+        for (uint c = 0; c < 2; c++)
+          {
+            float *samples = c == 0 ? left : right;
+            FloatV s1 = channels_[c].s1[stage];
+            FloatV s2 = channels_[c].s2[stage];
+
+            for (uint i = 0; i < n_samples; i++)
+              {
+                FloatV x;
+                Ase::simd_load (x, samples + i * LANES);
+                x *= pre_scale;
+
+                FloatV y0 = x * xnorm + s1 * s1feedback + s2 * s2feedback;
+                if (last_stage)
+                  y0 = tanh_approx (y0);
+
+                const FloatV y1 = lowpass (y0, s1);
+                const FloatV y2 = lowpass (y1, s2);
+
+                Ase::simd_store (samples + i * LANES, mode_out (y0, y1, y2, last_stage) * post_scale);
+              }
+            channels_[c].s1[stage] = s1;
+            channels_[c].s2[stage] = s2;
+          }
+      }
+  }
+  template<Mode MODE> void
+  process_block_mode (uint n_samples, float *left, float *right, const float *freq_in, const float *reso_in, const float *drive_in)
+  {
+    alignas (64) float over_samples_left[MAX_BLOCK_SIZE * MAX_OVER * LANES];
+    alignas (64) float over_samples_right[MAX_BLOCK_SIZE * MAX_OVER * LANES];
+
+    oversamplers_[0].upsample (left, n_samples, over_samples_left);
+    oversamplers_[1].upsample (right, n_samples, over_samples_right);
+
+    constexpr static int STAGES = SKFilter::mode2stages (MODE);
+    if (!freq_in)
+      {
+        /* use more efficient version of the filter computation if all parameters are constants */
+        for (uint l = 0; l < LANES; l++)
+          if (!(fparams_valid_ & Ase::uint64 (1) << l))
+            {
+              FParams fparams;
+              SKFilter::setup_reso_drive (fparams, reso_param_[l], drive_param_[l], MODE, global_volume_, test_linear_);
+              for (int stage = 0; stage < STAGES; stage++)
+                k_[stage][l] = fparams.k[stage];
+              pre_scale_[l] = fparams.pre_scale;
+              post_scale_[l] = fparams.post_scale;
+            }
+        fparams_valid_ = ~Ase::uint64 (0);
+
+        process<MODE> (over_samples_left, over_samples_right, freq_, n_samples * over_);
+        oversamplers_[0].downsample (over_samples_left, n_samples, left);
+        oversamplers_[1].downsample (over_samples_right, n_samples, right);
+        return;
+      }
+
+    /* interpolate pre_scale / post_scale / k parameters towards the values at the block end,
+     * per lane filter parameter setup only happens once per block
+     */
+    std::array<FloatV, MAX_STAGES> end_k;
+    FloatV end_pre_scale, end_post_scale;
+    for (uint l = 0; l < LANES; l++)
+      {
+        FParams fparams;
+        if (!(fparams_valid_ & Ase::uint64 (1) << l))
+          {
+            SKFilter::setup_reso_drive (fparams, reso_in[l], drive_in[l], MODE, global_volume_, test_linear_);
+            for (int stage = 0; stage < STAGES; stage++)
+              k_[stage][l] = fparams.k[stage];
+            pre_scale_[l] = fparams.pre_scale;
+            post_scale_[l] = fparams.post_scale;
+          }
+        const uint last = (n_samples - 1) * LANES + l;
+        SKFilter::setup_reso_drive (fparams, reso_in[last], drive_in[last], MODE, global_volume_, test_linear_);
+        for (int stage = 0; stage < STAGES; stage++)
+          end_k[stage][l] = fparams.k[stage];
+        end_pre_scale[l] = fparams.pre_scale;
+        end_post_scale[l] = fparams.post_scale;
+      }
+    fparams_valid_ = ~Ase::uint64 (0);
+
+    const float todo_inv = 1.f / n_samples;
+    const FloatV delta_pre_scale = (end_pre_scale - pre_scale_) * todo_inv;
+    const FloatV delta_post_scale = (end_post_scale - post_scale_) * todo_inv;
+    std::array<FloatV, MAX_STAGES> delta_k;
+    for (int stage = 0; stage < STAGES; stage++)
+      delta_k[stage] = (end_k[stage] - k_[stage]) * todo_inv;
+
+    for (uint i = 0; i < n_samples; i++)
+      {
+        pre_scale_ += delta_pre_scale;
+        post_scale_ += delta_post_scale;
+        for (int stage = 0; stage < STAGES; stage++)
+          k_[stage] += delta_k[stage];
+
+        FloatV freq;
+        Ase::simd_load (freq, freq_in + i * LANES);
+        process<MODE> (over_samples_left + i * over_ * LANES, over_samples_right + i * over_ * LANES, freq, over_);
+      }
+    oversamplers_[0].downsample (over_samples_left, n_samples, left);
+    oversamplers_[1].downsample (over_samples_right, n_samples, right);
+  }
+
+  using ProcessBlockFunc = decltype (&SKFilterLanes::process_block_mode<SKFilter::LP2>);
+
+  template<size_t... INDICES>
+  static constexpr std::array<ProcessBlockFunc, SKFilter::LAST_MODE + 1>
+  make_jump_table (std::integer_sequence<size_t, INDICES...>)
+  {
+    auto mk_func = [] (auto I) { return &SKFilterLanes::process_block_mode<Mode (I.value)>; };
+
+    return { mk_func (std::integral_constant<int, INDICES>{})... };
+  }
+public:
+  /* filter interleaved stereo samples in place, freq_in, reso_in and drive_in are either all given per
+   * sample and lane, or all nullptr to use the constant set_freq(), set_reso() and set_drive() values
+   */
+  void
+  process_block (uint n_samples, float *left, float *right, const float *freq_in = nullptr, const float *reso_in = nullptr, const float *drive_in = nullptr)
+  {
+    static constexpr auto jump_table { make_jump_table (std::make_index_sequence<SKFilter::LAST_MODE + 1>()) };
+
+    while (n_samples)
+      {
+        const uint todo = std::min (n_samples, MAX_BLOCK_SIZE);
+
+        (this->*jump_table[mode_]) (todo, left, right, freq_in, reso_in, drive_in);
+
+        left += todo * LANES;
+        right += todo * LANES;
+        if (freq_in)
+          freq_in += todo * LANES;
+        if (reso_in)
+          reso_in += todo * LANES;
+        if (drive_in)
+          drive_in += todo * LANES;
+
+        n_samples -= todo;
+      }
+  }
+};
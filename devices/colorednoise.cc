@@ -1,7 +1,9 @@
 // This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
 #include "ase/processor.hh"
 #include "ase/randomhash.hh"
+#include "ase/simd.hh"
 #include "ase/internal.hh"
+#include "ase/testing.hh"
 
 namespace {
 using namespace Ase;
@@ -35,6 +37,53 @@ struct WhiteRand {
   }
 };
 
+/** Pseudo random number generator for white noise with `LANES` independent streams.
+ * Each lane runs xoshiro128+, which only needs 32 bit additions, shifts and xor, unlike
+ * the 64 bit multiplication of WhiteRand that most SIMD instruction sets lack.
+ * The weak low bits of xoshiro128+ are lost in the conversion to float.
+ */
+template<uint LANES>
+struct WhiteRandLanes {
+  using U32V = SimdVector<uint32_t, LANES>;
+  using I32V = SimdVector<int32_t, LANES>;
+  using FloatV = SimdVector<float, LANES>;
+  U32V s0_, s1_, s2_, s3_;
+  WhiteRandLanes (uint64_t seed1 = random_int64(), uint64_t seed2 = random_int64())
+  {
+    WhiteRand seeder (seed1, seed2);
+    for (uint l = 0; l < LANES; l++)
+      {
+        const uint64_t r0 = seeder.rand64(), r1 = seeder.rand64();
+        s0_[l] = r0 | 1; // avoid all zero state
+        s1_[l] = r0 >> 32;
+        s2_[l] = r1;
+        s3_[l] = r1 >> 32;
+      }
+  }
+  inline void
+  rand32 (U32V &r)
+  {
+    r = s0_ + s3_;
+    const U32V t = s1_ << 9;
+    s2_ ^= s0_;
+    s3_ ^= s1_;
+    s1_ ^= s2_;
+    s0_ ^= s3_;
+    s2_ ^= t;
+    s3_ = (s3_ << 11) | (s3_ >> 21); // rotl (s3_, 11)
+  }
+  inline void
+  randf2 (FloatV &f0, FloatV &f1)
+  {
+    U32V r0, r1;
+    rand32 (r0);
+    rand32 (r1);
+    constexpr float i2f = 4.65661287416159475086293992373695129617e-10; // 1.0 / 2147483647.5;
+    f0 = __builtin_convertvector ((I32V) r0, FloatV) * i2f;
+    f1 = __builtin_convertvector ((I32V) r1, FloatV) * i2f;
+  }
+};
+
 /// IIR evaluation in transposed direct form II from `b[0…N], w[0…N-1], a[1…N]`
 /// Where `b[N+1]` are the feed-forward coefficients, `a[N+1]` are the feed-back
 /// coefficients, `w[N]` stores the z^-1 memory, and `x` is the current input.
@@ -55,6 +104,8 @@ iir_eval_tdf2 (const D *b, const D *a, D *w, F x)
   return y;
 }
 
+template<uint LANES> struct PinkWeights;
+
 /// Pink noise filter implemented as IIR filter with order 3
 template<class Float>
 struct PinkFilter {
@@ -65,8 +116,81 @@ struct PinkFilter {
   float  delays_[N] = { 0, };
   void   reset  ()              { floatfill (delays_, 0.0, N); }
   Float  eval   (Float x)       { return iir_eval_tdf2<N> (B, A, delays_, x); }
+  template<class V> V eval_block (const V &x, const PinkWeights<simd_lanes<V>> &weights);
+};
+
+/// Weights to evaluate PinkFilter for `LANES` consecutive samples at once.
+/// The filter is linear, so outputs and the next state are weighted sums of
+/// the inputs and the current state, the weights are taken from impulse responses.
+template<uint LANES>
+struct PinkWeights {
+  using FloatV = SimdVector<float, LANES>;
+  using StateV = SimdVector<float, 4>;
+  static constexpr size_t N = PinkFilter<float>::N;
+  static_assert (N <= 4);
+  FloatV x2y[LANES];    // outputs per input sample
+  FloatV w2y[N];        // outputs per state value
+  StateV x2w[LANES];    // next state per input sample
+  StateV w2w[N];        // next state per state value
+  PinkWeights()
+  {
+    using Pink64 = PinkFilter<double>; // weights are computed in double precision
+    auto impulse_response = [] (double w[N], uint j, FloatV &y, StateV &next) {
+      for (uint i = 0; i < LANES; i++)
+        y[i] = iir_eval_tdf2<N> (Pink64::B, Pink64::A, w, i == j ? 1.0 : 0.0);
+      next = StateV{};
+      for (uint n = 0; n < N; n++)
+        next[n] = w[n];
+    };
+    for (uint j = 0; j < LANES; j++)
+      {
+        double w[N] = { 0, };
+        impulse_response (w, j, x2y[j], x2w[j]);
+      }
+    for (uint k = 0; k < N; k++)
+      {
+        double w[N] = { 0, };
+        w[k] = 1;
+        impulse_response (w, LANES, w2y[k], w2w[k]);
+      }
+  }
+  static const PinkWeights&
+  the()
+  {
+    static const PinkWeights weights;
+    return weights;
+  }
 };
 
+/// Filter `LANES` consecutive samples, equivalent to calling eval() for each sample.
+template<class Float> template<class V> V
+PinkFilter<Float>::eval_block (const V &x, const PinkWeights<simd_lanes<V>> &weights)
+{
+  using StateV = typename PinkWeights<simd_lanes<V>>::StateV;
+  constexpr uint LANES = simd_lanes<V>, ACCUS = 4; // independent sums shorten dependency chains
+  static_assert (LANES % ACCUS == 0 && N <= ACCUS);
+  alignas (64) float xs[LANES];
+  simd_store (xs, x); // broadcast input samples from memory
+  V y[ACCUS] = {};
+  StateV next[ACCUS] = {};
+  for (uint j = 0; j < LANES; j += ACCUS)
+    for (uint a = 0; a < ACCUS; a++)
+      {
+        y[a] += xs[j + a] * weights.x2y[j + a];
+        next[a] += xs[j + a] * weights.x2w[j + a];
+      }
+  for (uint k = 0; k < N; k++)
+    {
+      y[k] += delays_[k] * weights.w2y[k];
+      next[k] += delays_[k] * weights.w2w[k];
+    }
+  y[0] += y[1] + (y[2] + y[3]);
+  next[0] += next[1] + (next[2] + next[3]);
+  for (uint n = 0; n < N; n++)
+    delays_[n] = next[0][n];
+  return y[0];
+}
+
 template<class F> static inline F
 db2amp (F dB)
 {
@@ -77,8 +201,10 @@ db2amp (F dB)
 /// Noise generator for various colors of noise.
 class ColoredNoise : public AudioProcessor {
   using Pink = PinkFilter<float>;
+  static constexpr uint LANES = SIMD_FLOAT_LANES;
+  using FloatV = SimdVector<float, LANES>;
   OBusId    stereout_;
-  WhiteRand white_rand_;
+  WhiteRandLanes<LANES> white_rand_;
   Pink      pink0, pink1;
   float     gain_factor_ = 1.0;
   bool      mono_ = false;
@@ -125,6 +251,7 @@ public:
   void
   reset (uint64 target_stamp) override
   {
+    PinkWeights<LANES>::the(); // compute weights outside of render()
     pink0.reset();
     pink1.reset();
     adjust_all_params();
@@ -142,18 +269,47 @@ template<ColoredNoise::Cases CASES> void
 ColoredNoise::render_cases (float *out0, float *out1, uint n_frames, const float gain)
 {
   static_assert (CASES <= MASK);
-  for (size_t i = 0; i < n_frames; i++)
+  // each step generates LANES frames in stereo, 2 * LANES frames in mono
+  constexpr uint STEP = bool (CASES & INSTEREO) ? LANES : 2 * LANES;
+  const PinkWeights<LANES> &weights = PinkWeights<LANES>::the();
+  for (size_t i = 0; i < n_frames; i += STEP)
     {
-      auto [f0, f1] = white_rand_.randf2();
+      FloatV f0, f1;
+      white_rand_.randf2 (f0, f1);
+      const size_t n = std::min (n_frames - i, size_t (STEP));
+      if (ASE_UNLIKELY (n < STEP)) // partial step, filter only the samples used
+        {
+          alignas (64) float f[2 * LANES];
+          simd_store (f, f0);
+          simd_store (f + LANES, f1);
+          for (size_t j = 0; j < n; j++)
+            {
+              // stereo uses f0 for the left and f1 for the right channel, mono uses f0 then f1
+              float v0 = f[j], v1 = bool (CASES & INSTEREO) ? f[LANES + j] : v0;
+              if_constexpr (bool (CASES & WITHPINK))
+                {
+                  v0 = pink0.eval (v0);
+                  v1 = bool (CASES & INSTEREO) ? pink1.eval (v1) : v0;
+                }
+              if_constexpr (bool (CASES & WITHGAIN))
+                {
+                  v0 *= gain;
+                  v1 *= gain;
+                }
+              out0[i + j] = v0;
+              out1[i + j] = v1;
+            }
+          break; // surplus noise samples are discarded
+        }
       if_constexpr (bool (CASES & WITHPINK) && bool (CASES & INSTEREO))
         {
-          f0 = pink0.eval (f0); // left filter
-          f1 = pink1.eval (f1); // right filter
+          f0 = pink0.eval_block (f0, weights); // left filter
+          f1 = pink1.eval_block (f1, weights); // right filter
         }
       if_constexpr (bool (CASES & WITHPINK) && !bool (CASES & INSTEREO))
         {
-          f0 = pink0.eval (f0); // mono filter
-          f1 = pink0.eval (f1); // mono filter
+          f0 = pink0.eval_block (f0, weights); // mono filter
+          f1 = pink0.eval_block (f1, weights); // mono filter
         }
       if_constexpr (bool (CASES & WITHGAIN))
         {
@@ -162,16 +318,15 @@ ColoredNoise::render_cases (float *out0, float *out1, uint n_frames, const float
         }
       if_constexpr (bool (CASES & INSTEREO))
         {
-          out0[i] = f0;
-          out1[i] = f1;
+          simd_store (out0 + i, f0);
+          simd_store (out1 + i, f1);
         }
       else
         {
-          out0[i] = f0;
-          out1[i] = f0;
-          i++;
-          out0[i] = f1;
-          out1[i] = f1;
+          simd_store (out0 + i, f0);
+          simd_store (out1 + i, f0);
+          simd_store (out0 + i + LANES, f1);
+          simd_store (out1 + i + LANES, f1);
         }
     }
 }
@@ -193,4 +348,126 @@ ColoredNoise::render (uint n_frames)
   (this->*render_table[index]) (out0, out1, n_frames, gain);
 }
 
+TEST_INTEGRITY (colored_noise_test);
+static void
+colored_noise_test()
+{
+  constexpr uint LANES = SIMD_FLOAT_LANES, N_STEPS = 65536;
+  using FloatV = SimdVector<float, LANES>;
+  // lanes run xoshiro128+, compare with a scalar implementation
+  WhiteRandLanes<LANES> lanes (0x1234567, 0x89abcdef);
+  uint32_t s[4] = { lanes.s0_[1], lanes.s1_[1], lanes.s2_[1], lanes.s3_[1] };
+  for (uint i = 0; i < 1000; i++)
+    {
+      WhiteRandLanes<LANES>::U32V r;
+      lanes.rand32 (r);
+      TASSERT (r[1] == s[0] + s[3]);
+      const uint32_t t = s[1] << 9;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl (s[3], 11);
+    }
+  // statistics of uniform white noise in [-1,+1]: mean 0, variance 1/3, uncorrelated in time and across lanes
+  double sum = 0, sum2 = 0, lag1 = 0, neighbour = 0, vmin = 0, vmax = 0;
+  for (uint i = 0; i < N_STEPS; i++)
+    {
+      FloatV f0, f1;
+      lanes.randf2 (f0, f1);
+      for (uint l = 0; l < LANES; l++)
+        {
+          sum += f0[l] + f1[l];
+          sum2 += f0[l] * f0[l] + f1[l] * f1[l];
+          lag1 += f0[l] * f1[l];                        // successive values of a stream
+          neighbour += f0[l] * f0[(l + 1) % LANES];     // neighbouring streams
+          vmin = std::min<double> (vmin, std::min (f0[l], f1[l]));
+          vmax = std::max<double> (vmax, std::max (f0[l], f1[l]));
+        }
+    }
+  const double n = 2.0 * N_STEPS * LANES;
+  TASSERT (vmin >= -1 && vmax <= +1 && vmin < -0.999 && vmax > 0.999);
+  TASSERT (fabs (sum / n) < 0.005);
+  TASSERT (fabs (sum2 / n - 1 / 3.0) < 0.005);
+  TASSERT (fabs (lag1 / (n / 2) / (1 / 3.0)) < 0.01);
+  TASSERT (fabs (neighbour / (n / 2) / (1 / 3.0)) < 0.01);
+  // block evaluation of the pink filter matches a double precision reference like per sample evaluation,
+  // both accumulate float rounding errors in the filter state, with poles close to 1
+  PinkFilter<float> pink, pink_block;
+  using Pink64 = PinkFilter<double>;
+  double w64[Pink64::N] = { 0, }, max_diff = 0, block_diff = 0;
+  WhiteRand white (0x1234567, 0x89abcdef);
+  for (uint i = 0; i < 16384; i++)
+    {
+      FloatV x;
+      for (uint l = 0; l < LANES; l++)
+        x[l] = std::get<0> (white.randf2());
+      const FloatV y = pink_block.eval_block (x, PinkWeights<LANES>::the());
+      for (uint l = 0; l < LANES; l++)
+        {
+          const double y64 = iir_eval_tdf2<Pink64::N> (Pink64::B, Pink64::A, w64, double (x[l]));
+          max_diff = std::max (max_diff, fabs (pink.eval (x[l]) - y64));
+          block_diff = std::max (block_diff, fabs (y[l] - y64));
+        }
+    }
+  TASSERT (max_diff < 4e-4);    // pink output peaks at ca. 0.22
+  TASSERT (block_diff < 4e-4);
+}
+
+template<class Generate> static void
+colored_noise_bench (const char *what, Generate generate)
+{
+  constexpr uint N_FRAMES = 256, RUNS = 4000;
+  alignas (64) float out0[N_FRAMES], out1[N_FRAMES];
+  Test::Timer timer (0.15);
+  const double bench_time = timer.benchmark ([&] () {
+    for (uint r = 0; r < RUNS; r++)
+      generate (out0, out1, N_FRAMES);
+  });
+  printerr ("  BENCH    %-28s %7.1f M samples/s\n", what, 2.0 * N_FRAMES * RUNS / bench_time / 1000000);
+}
+
+TEST_BENCHMARK (colored_noise_benchmarks);
+static void
+colored_noise_benchmarks()
+{
+  constexpr uint LANES = SIMD_FLOAT_LANES;
+  using FloatV = SimdVector<float, LANES>;
+  WhiteRand white;
+  PinkFilter<float> pink0, pink1;
+  colored_noise_bench ("ColoredNoise white, scalar:", [&] (float *out0, float *out1, uint n_frames) {
+    for (uint i = 0; i < n_frames; i++)
+      std::tie (out0[i], out1[i]) = white.randf2();
+  });
+  colored_noise_bench ("ColoredNoise pink, scalar:", [&] (float *out0, float *out1, uint n_frames) {
+    for (uint i = 0; i < n_frames; i++)
+      {
+        const auto [f0, f1] = white.randf2();
+        out0[i] = pink0.eval (f0);
+        out1[i] = pink1.eval (f1);
+      }
+  });
+  WhiteRandLanes<LANES> lanes;
+  const PinkWeights<LANES> &weights = PinkWeights<LANES>::the();
+  colored_noise_bench ("ColoredNoise white, vector:", [&] (float *out0, float *out1, uint n_frames) {
+    for (uint i = 0; i < n_frames; i += LANES)
+      {
+        FloatV f0, f1;
+        lanes.randf2 (f0, f1);
+        simd_store (out0 + i, f0);
+        simd_store (out1 + i, f1);
+      }
+  });
+  colored_noise_bench ("ColoredNoise pink, vector:", [&] (float *out0, float *out1, uint n_frames) {
+    for (uint i = 0; i < n_frames; i += LANES)
+      {
+        FloatV f0, f1;
+        lanes.randf2 (f0, f1);
+        simd_store (out0 + i, pink0.eval_block (f0, weights));
+        simd_store (out1 + i, pink1.eval_block (f1, weights));
+      }
+  });
+}
+
 } // Anon
@@ -2,6 +2,8 @@
 #include "ase/processor.hh"
 #include "ase/internal.hh"
 #include "devices/blepsynth/linearsmooth.hh"
+#include "devices/freeverb/revlanes.hh"
+#include "ase/testing.hh"
 
 namespace {
 
@@ -15,7 +17,7 @@ using namespace Ase;
 class Freeverb : public AudioProcessor {
   IBusId stereoin;
   OBusId stereout;
-  revmodel model;
+  RevModelLanes model;
   LinearSmooth mix_smooth_;
   bool mix_smooth_reset_ = false;
 public:
@@ -67,7 +69,8 @@ public:
       case MIX:         mix_smooth_.set (get_param (paramid) * 0.01, mix_smooth_reset_);
                         mix_smooth_reset_ = false;
                         break;
-      case ROOMSIZE:    return model.setroomsize ((get_param (paramid) - offsetroom) / scaleroom);
+      case ROOMSIZE:    update_tail (get_param (paramid));
+                        return model.setroomsize ((get_param (paramid) - offsetroom) / scaleroom);
       case WIDTH:       return model.setwidth (0.01 * get_param (paramid));
       case MODE:
       case DAMPING:     return model.setdamp (0.01 * get_param (ParamId (DAMPING)),
@@ -75,6 +78,14 @@ public:
       }
   }
   void
+  update_tail (double roomsize)
+  {
+    // comb feedback equals roomsize, render until the longest comb decayed below -100dB
+    const double loops = std::log (1e-5) / std::log (CLAMP (roomsize, 0.1, 0.999));
+    const int64 longest_comb = combtuningR8, allpasses = allpasstuningR1 + allpasstuningR2 + allpasstuningR3 + allpasstuningR4;
+    set_tail (int64 (loops + 1) * longest_comb + allpasses);
+  }
+  void
   reset (uint64 target_stamp) override
   {
     model.setmode (0);          // no-freeze, allow mute
@@ -92,7 +103,7 @@ public:
       return;
 
     // this only generates the wet signal
-    model.processreplace (input0, input1, output0, output1, n_frames, 1);
+    model.processreplace (input0, input1, output0, output1, n_frames);
 
     if (mix_smooth_.is_constant()) // faster version: mix parameter is constant during the block
       {
@@ -144,4 +155,82 @@ public:
 };
 static auto freeverb = register_audio_processor<Freeverb> ("Ase::Devices::Freeverb");
 
+TEST_INTEGRITY (freeverb_lanes_test);
+static void
+freeverb_lanes_test()
+{
+  // the vectorized model must match the original revmodel for all damping modes and freeze
+  constexpr uint N = 300;
+  float input0[N], input1[N], output0[N], output1[N], expect0[N], expect1[N];
+  for (int dampmode : { +1, 0, -1 })
+    {
+      auto reference = std::make_unique<revmodel>();
+      auto lanes = std::make_unique<RevModelLanes>();
+      auto setup = [dampmode] (auto &model) {
+        model.setroomsize (0.8);
+        model.setdamp (0.3, dampmode);
+        model.setwidth (0.7);
+        model.setdry (0.1);
+        model.setwet (1);
+      };
+      setup (*reference);
+      setup (*lanes);
+      double max_diff = 0, energy = 0;
+      for (uint block = 0; block < 40; block++)
+        {
+          if (block == 30)
+            {
+              reference->setmode (1);
+              lanes->setmode (1);
+            }
+          for (uint i = 0; i < N; i++)
+            {
+              input0[i] = block < 4 ? sin ((block * N + i) * 0.05) : 0;
+              input1[i] = block < 4 ? cos ((block * N + i) * 0.13) : 0;
+            }
+          reference->processreplace (input0, input1, expect0, expect1, N, 1);
+          lanes->processreplace (input0, input1, output0, output1, N);
+          for (uint i = 0; i < N; i++)
+            {
+              max_diff = std::max<double> (max_diff, std::abs (output0[i] - expect0[i]) + std::abs (output1[i] - expect1[i]));
+              energy += output0[i] * output0[i] + output1[i] * output1[i];
+            }
+        }
+      TASSERT (energy > 1);
+      TASSERT (max_diff < 1e-5);
+    }
+}
+
+template<class Model> static void
+freeverb_bench (const char *name)
+{
+  constexpr uint N = 128, BLOCKS = 64;
+  auto model = std::make_unique<Model>();
+  float input0[N], input1[N], output0[N], output1[N];
+  for (uint i = 0; i < N; i++)
+    {
+      input0[i] = sin (i * 0.05);
+      input1[i] = cos (i * 0.13);
+    }
+  auto render = [&] () {
+    for (uint block = 0; block < BLOCKS; block++)
+      if constexpr (std::is_same<Model, revmodel>::value)
+        model->processreplace (input0, input1, output0, output1, N, 1);
+      else
+        model->processreplace (input0, input1, output0, output1, N);
+  };
+  Test::Timer timer (0.15);
+  const double bench_time = timer.benchmark (render);
+  const double rendered_secs = BLOCKS * N / 48000.0;
+  printerr ("  BENCH    Freeverb %-8s %8.1f instances per core\n", name, rendered_secs / bench_time);
+}
+
+TEST_BENCHMARK (freeverb_benchmarks);
+static void
+freeverb_benchmarks()
+{
+  freeverb_bench<revmodel> ("scalar:");
+  freeverb_bench<RevModelLanes> ("lanes:");
+}
+
 } // Anon
@@ -0,0 +1,237 @@
+// This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
+#pragma once
+
+#include "ase/simd.hh"
+#include "tuning.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace Ase {
+
+/* Vectorized variant of the Freeverb revmodel with identical tuning and parameters.
+ * The 8 parallel combs of a channel are processed as 8 SIMD lanes (one AVX or two SSE registers),
+ * the allpasses in series are vectorized across the frames of a block. Blocks are shorter than the
+ * shortest allpass delay line, so no allpass sample is read within the block it was written in.
+ */
+class RevModelLanes
+{
+  static constexpr uint COMBS = numcombs, ALLPASSES = numallpasses, MAX_BLOCK = 128, COMB_RING = 2048;
+  static constexpr uint LANES = std::min (SIMD_FLOAT_LANES, COMBS), PARTS = COMBS / LANES;
+  static_assert (COMBS % LANES == 0 && MAX_BLOCK <= allpasstuningL4 && combtuningR8 <= COMB_RING);
+  // native vector width, the compiler splits wider vectors poorly for comparisons
+  using FloatV = SimdVector<float, LANES>;
+  using IntV = SimdVector<int, LANES>;
+  struct DelayLine {
+    std::vector<float> buffer;
+    uint               index = 0;
+  };
+  /* The comb delay lines of a channel share one ring buffer with interleaved lanes, every frame
+   * is written as one vector. Each lane reads its comb output comb_length samples behind.
+   */
+  struct Channel {
+    std::vector<float> comb_ring;
+    uint               comb_pos = 0;
+    uint               comb_length[COMBS] = {};
+    FloatV             filterstore[PARTS] = {};
+    DelayLine          allpasses[ALLPASSES];
+  };
+  Channel channels_[2];
+  float   gain_ = 0, roomsize_ = 0, roomsize1_ = 0, damp_ = 0, damp1_ = 0, damp2_ = 0;
+  int     dampmode_ = 0;
+  float   wet_ = 0, wet1_ = 0, wet2_ = 0, dry_ = 0, width_ = 0, mode_ = 0;
+  // same as the undenormalise() macro, zero samples with zero exponent
+  static void
+  flush_denormal (float &v)
+  {
+    if ((__builtin_bit_cast (uint32_t, v) & 0x7f800000) == 0)
+      v = 0;
+  }
+  static void
+  flush_denormal (FloatV &v)
+  {
+    const IntV bits = (IntV) v;
+    v = (FloatV) (bits & ~((bits & 0x7f800000) == 0));
+  }
+  void
+  update()
+  {
+    wet1_ = wet_ * (width_ / 2 + 0.5f);
+    wet2_ = wet_ * ((1 - width_) / 2);
+    const bool freeze = mode_ >= freezemode;
+    roomsize1_ = freeze ? 1 : roomsize_;
+    damp1_ = freeze ? 0 : damp_;
+    gain_ = freeze ? muted : fixedgain;
+    damp2_ = 1 - damp1_;
+    if (dampmode_ == -1)        // STK damping sign correction
+      damp1_ = -damp1_;
+    else if (dampmode_ == 0)    // VLC disables the damping feedback
+      damp1_ = 0;
+  }
+  /* run the combs of both channels, sum up their outputs per frame */
+  void
+  process_combs (const float *input, float *output_l, float *output_r, uint n_frames)
+  {
+    const FloatV damp1 = FloatV{} + damp1_, damp2 = FloatV{} + damp2_, feedback = FloatV{} + roomsize1_;
+    for (uint i = 0; i < n_frames; i++)
+      {
+        const FloatV in = FloatV{} + input[i];
+        FloatV sum[2] = {};
+        for (uint ch = 0; ch < 2; ch++) // both channels interleaved for independent dependency chains
+          {
+            Channel &channel = channels_[ch];
+            float *ring = channel.comb_ring.data();
+            const uint pos = channel.comb_pos + i;
+            for (uint p = 0; p < PARTS; p++)
+              {
+                FloatV out;
+                for (uint l = 0; l < LANES; l++)
+                  {
+                    const uint c = p * LANES + l;
+                    out[l] = ring[((pos - channel.comb_length[c]) & (COMB_RING - 1)) * COMBS + c];
+                  }
+                flush_denormal (out);
+                FloatV &filterstore = channel.filterstore[p];
+                filterstore = out * damp2 + filterstore * damp1;
+                flush_denormal (filterstore);
+                simd_store (ring + (pos & (COMB_RING - 1)) * COMBS + p * LANES, in + filterstore * feedback);
+                sum[ch] += out;
+              }
+          }
+        output_l[i] = simd_sum (sum[0]);
+        output_r[i] = simd_sum (sum[1]);
+      }
+    for (Channel &channel : channels_)
+      channel.comb_pos = (channel.comb_pos + n_frames) & (COMB_RING - 1);
+  }
+  /* run the allpasses of `channel` in series, in place */
+  static void
+  process_allpasses (Channel &channel, float *samples, uint n_frames)
+  {
+    for (DelayLine &allpass : channel.allpasses)
+      for (uint i = 0; i < n_frames;)
+        {
+          // contiguous segment up to the delay line wrap around
+          float *buffer = allpass.buffer.data() + allpass.index;
+          const uint n = std::min<uint> (n_frames - i, allpass.buffer.size() - allpass.index);
+          uint k = 0;
+          for (; k + LANES <= n; k += LANES)
+            {
+              FloatV bufout, x;
+              simd_load (bufout, buffer + k);
+              simd_load (x, samples + i + k);
+              flush_denormal (bufout);
+              simd_store (buffer + k, x + bufout * 0.5f);
+              simd_store (samples + i + k, bufout - x);
+            }
+          for (; k < n; k++)
+            {
+              float bufout = buffer[k];
+              flush_denormal (bufout);
+              const float x = samples[i + k];
+              buffer[k] = x + bufout * 0.5f;
+              samples[i + k] = bufout - x;
+            }
+          allpass.index = allpass.index + n < allpass.buffer.size() ? allpass.index + n : 0;
+          i += n;
+        }
+  }
+public:
+  RevModelLanes()
+  {
+    const int combtuning[COMBS] = { combtuningL1, combtuningL2, combtuningL3, combtuningL4,
+                                    combtuningL5, combtuningL6, combtuningL7, combtuningL8 };
+    const int allpasstuning[ALLPASSES] = { allpasstuningL1, allpasstuningL2, allpasstuningL3, allpasstuningL4 };
+    for (uint ch = 0; ch < 2; ch++)
+      {
+        channels_[ch].comb_ring.resize (COMB_RING * COMBS);
+        for (uint c = 0; c < COMBS; c++)
+          channels_[ch].comb_length[c] = combtuning[c] + ch * stereospread;
+        for (uint a = 0; a < ALLPASSES; a++)
+          channels_[ch].allpasses[a].buffer.resize (allpasstuning[a] + ch * stereospread);
+      }
+    setwet (initialwet);
+    setroomsize (initialroom);
+    setdry (initialdry);
+    setdamp (initialdamp, +1);
+    setwidth (initialwidth);
+    setmode (initialmode);
+  }
+  void
+  mute()
+  {
+    if (mode_ >= freezemode)
+      return;
+    for (Channel &channel : channels_)
+      {
+        std::fill (channel.comb_ring.begin(), channel.comb_ring.end(), 0);
+        for (DelayLine &delay : channel.allpasses)
+          std::fill (delay.buffer.begin(), delay.buffer.end(), 0);
+        std::fill (channel.filterstore, channel.filterstore + PARTS, FloatV{});
+      }
+  }
+  void
+  processreplace (const float *input_l, const float *input_r, float *output_l, float *output_r, uint n_frames)
+  {
+    while (n_frames)
+      {
+        const uint n = std::min (n_frames, MAX_BLOCK);
+        alignas (64) float input[MAX_BLOCK], out_l[MAX_BLOCK], out_r[MAX_BLOCK];
+        for (uint i = 0; i < n; i++)
+          input[i] = (input_l[i] + input_r[i]) * gain_;
+        process_combs (input, out_l, out_r, n);
+        process_allpasses (channels_[0], out_l, n);
+        process_allpasses (channels_[1], out_r, n);
+        for (uint i = 0; i < n; i++)
+          {
+            const float l = out_l[i] * wet1_ + out_r[i] * wet2_ + input_l[i] * dry_;
+            const float r = out_r[i] * wet1_ + out_l[i] * wet2_ + input_r[i] * dry_;
+            output_l[i] = l;    // output may alias input
+            output_r[i] = r;
+          }
+        input_l += n;
+        input_r += n;
+        output_l += n;
+        output_r += n;
+        n_frames -= n;
+      }
+  }
+  void
+  setroomsize (float value)
+  {
+    roomsize_ = value * scaleroom + offsetroom;
+    update();
+  }
+  void
+  setdamp (float value, int mode)
+  {
+    damp_ = value * scaledamp;
+    dampmode_ = mode;
+    update();
+  }
+  void
+  setwet (float value)
+  {
+    wet_ = value * scalewet;
+    update();
+  }
+  void
+  setdry (float value)
+  {
+    dry_ = value * scaledry;
+  }
+  void
+  setwidth (float value)
+  {
+    width_ = value;
+    update();
+  }
+  void
+  setmode (float value)
+  {
+    mode_ = value;
+    update();
+  }
+};
+
+} // Ase
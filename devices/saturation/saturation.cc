@@ -1,6 +1,7 @@
 // This Source Code Form is licensed MPL-2.0: http://mozilla.org/MPL/2.0
 #include "ase/processor.hh"
 #include "ase/internal.hh"
+#include "ase/testing.hh"
 #include "saturationdsp.hh"
 
 namespace {
@@ -24,7 +25,7 @@ public:
     info.creator_name = "Stefan Westerfeld";
     info.website_url  = "https://anklang.testbit.eu";
   }
-  enum Params { MODE = 1, MIX, DRIVE };
+  enum Params { MODE = 1, MIX, DRIVE, QUALITY };
   void
   initialize (SpeakerArrangement busses) override
   {
@@ -41,6 +42,13 @@ public:
     pmap[MIX]   = Param { "mix",   "Mix dry/wet", "Mix", 100, "%", { 0, 100 } };
     pmap[DRIVE] = Param { "drive", "Drive", "Drive", 0, "dB", { -6, 36 } };
 
+    ChoiceS qentries;
+    qentries += { "Classic", "8x oversampling, cheap tanh approximation, as in earlier versions" };
+    qentries += { "Draft",   "2x oversampling, cheap tanh approximation" };
+    qentries += { "Normal",  "4x oversampling, accurate tanh approximation" };
+    qentries += { "High",    "8x oversampling, tanh within 1e-6" };
+    pmap[QUALITY] = Param { "quality", "Quality", "Qual", 0, "", std::move (qentries), "", { String ("blurb=") + _("Oversampling and saturation function accuracy"), } };
+
     install_params (pmap);
 
     prepare_event_input();
@@ -50,7 +58,18 @@ public:
   {
     if (m == 1)
       return SaturationDSP::Mode::HARD_CLIP;
-    return SaturationDSP::Mode::TANH_CHEAP;
+    return SaturationDSP::Mode::SOFT;
+  }
+  SaturationDSP::Quality
+  map_quality (int q)
+  {
+    if (q == 1)
+      return SaturationDSP::Quality::DRAFT;
+    if (q == 2)
+      return SaturationDSP::Quality::NORMAL;
+    if (q == 3)
+      return SaturationDSP::Quality::HIGH;
+    return SaturationDSP::Quality::CLASSIC;
   }
   void
   adjust_param (uint32_t tag) override
@@ -63,6 +82,8 @@ public:
                         return;
       case MODE:        saturation.set_mode (map_mode (get_param (MODE)));
                         return;
+      case QUALITY:     saturation.set_quality (map_quality (get_param (QUALITY)));
+                        return;
       }
   }
   void
@@ -110,4 +131,48 @@ public:
 };
 static auto saturation = register_audio_processor<Saturation> ("Ase::Devices::Saturation");
 
+TEST_INTEGRITY (saturation_tanh_test);
+static void
+saturation_tanh_test()
+{
+  using FloatV = SaturationDSP::FloatV;
+  constexpr uint L = SaturationDSP::LANES;
+  auto saturation = std::make_unique<SaturationDSP>();
+  double cheap_err = 0, pade_err = 0, rational_err = 0, table_err = 0;
+  for (int i = -12000; i < 12000; i += L)
+    {
+      FloatV x;
+      for (uint l = 0; l < L; l++)
+        x[l] = (i + int (l)) * 0.001;
+      const FloatV cheap = SaturationDSP::cheap_tanh (x);
+      const FloatV pade = SaturationDSP::pade_tanh (x);
+      const FloatV rational = SaturationDSP::rational_tanh (x);
+      for (uint l = 0; l < L; l++)
+        {
+          const double t = std::tanh (double (x[l]));
+          TASSERT (std::abs (pade[l]) <= 1 && std::abs (rational[l]) <= 1);
+          cheap_err = std::max (cheap_err, std::abs (cheap[l] - t));
+          pade_err = std::max (pade_err, std::abs (pade[l] - t));
+          rational_err = std::max (rational_err, std::abs (rational[l] - t));
+          table_err = std::max (table_err, std::abs (saturation->lookup_table (x[l]) - t));
+        }
+    }
+  TASSERT (cheap_err < 0.025);
+  TASSERT (pade_err < 0.0002);
+  TASSERT (rational_err < 0.000002);
+  TASSERT (table_err < 0.002);
+  // quality selects the oversampling factor, the default matches earlier versions
+  TASSERT (saturation->quality == SaturationDSP::Quality::CLASSIC);
+  TASSERT (saturation->oversample() == 8);
+  saturation->reset (48000);
+  saturation->set_quality (SaturationDSP::Quality::DRAFT);
+  TASSERT (saturation->oversample() == 2);
+  saturation->set_quality (SaturationDSP::Quality::NORMAL);
+  TASSERT (saturation->oversample() == 4);
+  saturation->set_quality (SaturationDSP::Quality::HIGH);
+  TASSERT (saturation->oversample() == 8);
+  saturation->set_quality (SaturationDSP::Quality::CLASSIC);
+  TASSERT (saturation->oversample() == 8);
+}
+
 }
@@ -7,20 +7,58 @@
 #define PANDA_RESAMPLER_HEADER_ONLY
 
 #include "pandaresampler.hh"
+#include "ase/simd.hh"
 
 namespace Ase {
 
 class SaturationDSP
 {
+public:
+  using FloatV = SimdVector<float, SIMD_FLOAT_LANES>;
+  static constexpr uint LANES = SIMD_FLOAT_LANES;
+
   // https://www.musicdsp.org/en/latest/Other/238-rational-tanh-approximation.html
-  float
-  cheap_tanh (float x)
+  // max error 0.024
+  static FloatV
+  cheap_tanh (FloatV x)
   {
-    x = std::clamp (x, -3.0f, 3.0f);
+    x = simd_clamp (x, -3.0f, 3.0f);
 
     return (x * (27.0f + x * x) / (27.0f + 9.0f * x * x));
   }
-
+  // 7/6 Pade approximation (Lambert continued fraction), reaches 1 at 4.97, max error 1e-4
+  static FloatV
+  pade_tanh (FloatV x)
+  {
+    x = simd_clamp (x, -4.97f, 4.97f);
+    const FloatV x2 = x * x;
+    const FloatV p = ((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f;
+    const FloatV q = ((28.0f * x2 + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+    return simd_clamp (x * p / q, -1.0f, 1.0f);
+  }
+  // 13/6 rational minimax approximation (as used by Eigen), max error 1e-6
+  static FloatV
+  rational_tanh (FloatV x)
+  {
+    x = simd_clamp (x, -7.90531110763549805f, 7.90531110763549805f);
+    const FloatV x2 = x * x;
+    FloatV p = x2 * -2.76076847742355e-16f + 2.00018790482477e-13f;
+    p = p * x2 + -8.60467152213735e-11f;
+    p = p * x2 + 5.12229709037114e-08f;
+    p = p * x2 + 1.48572235717979e-05f;
+    p = p * x2 + 6.37261928875436e-04f;
+    p = p * x2 + 4.89352455891786e-03f;
+    FloatV q = x2 * 1.19825839466702e-06f + 1.18534705686654e-04f;
+    q = q * x2 + 2.26843463243900e-03f;
+    q = q * x2 + 4.89352518554385e-03f;
+    return x * p / q;
+  }
+  static FloatV
+  hard_clip (FloatV x)
+  {
+    return simd_clamp (x, -1.0f, 1.0f);
+  }
+private:
   /*
    * tanh function which is restricted in the range [-4:4]
    */
@@ -53,7 +91,7 @@ class SaturationDSP
   }
 
   static constexpr int table_size = 512;
-  static constexpr int oversample = 8;
+  static constexpr int max_oversample = 8;
   std::array<float, table_size> table;
   float current_drive = 0;
   float dest_drive = 0;
@@ -61,6 +99,7 @@ class SaturationDSP
   float current_mix = 1;
   float dest_mix = 1;
   float mix_max_step = 0;
+  unsigned int sample_rate = 48000;
 
   void
   fill_table()
@@ -73,36 +112,80 @@ class SaturationDSP
     table[0] = table[1];
     table[table_size - 1] = table[table_size - 2];
   }
-  std::unique_ptr<PandaResampler::Resampler2> res_up_left;
-  std::unique_ptr<PandaResampler::Resampler2> res_up_right;
-  std::unique_ptr<PandaResampler::Resampler2> res_down_left;
-  std::unique_ptr<PandaResampler::Resampler2> res_down_right;
+  struct Resamplers {
+    int oversample = 1;
+    std::unique_ptr<PandaResampler::Resampler2> up_left;
+    std::unique_ptr<PandaResampler::Resampler2> up_right;
+    std::unique_ptr<PandaResampler::Resampler2> down_left;
+    std::unique_ptr<PandaResampler::Resampler2> down_right;
+  };
+  std::array<Resamplers, 3> resamplers;    // 2x, 4x and 8x, switching Quality must not allocate
+  Resamplers *res = nullptr;
 public:
   enum class Mode {
     TANH_TABLE,
-    TANH_TRUE,
+    TANH_TRUE,  // rational_tanh(), within 1e-6 of std::tanh()
     TANH_CHEAP,
-    HARD_CLIP
+    HARD_CLIP,
+    TANH_PADE,
+    SOFT        // tanh approximation selected by Quality
+  };
+  /* Quality selects the oversampling factor and the tanh approximation of Mode::SOFT:
+   * CLASSIC: 8x, cheap_tanh() (the soft saturation of earlier versions); DRAFT: 2x, cheap_tanh();
+   * NORMAL: 4x, pade_tanh(); HIGH: 8x, rational_tanh()
+   */
+  enum class Quality {
+    CLASSIC,
+    DRAFT,
+    NORMAL,
+    HIGH
   };
   Mode mode = Mode::TANH_TABLE;
+  Quality quality = Quality::CLASSIC;
+private:
+  Resamplers&
+  quality_resamplers (Quality q)
+  {
+    switch (q)
+      {
+      case Quality::DRAFT:      return resamplers[0];
+      case Quality::NORMAL:     return resamplers[1];
+      case Quality::CLASSIC:
+      case Quality::HIGH:       return resamplers[2];
+      }
+    return resamplers[2];
+  }
+public:
   SaturationDSP()
   {
     fill_table();
 
     using PandaResampler::Resampler2;
-    res_up_left    = std::make_unique<Resampler2> (Resampler2::UP, oversample, Resampler2::PREC_72DB);
-    res_up_right   = std::make_unique<Resampler2> (Resampler2::UP, oversample, Resampler2::PREC_72DB);
-    res_down_left  = std::make_unique<Resampler2> (Resampler2::DOWN, oversample, Resampler2::PREC_72DB);
-    res_down_right = std::make_unique<Resampler2> (Resampler2::DOWN, oversample, Resampler2::PREC_72DB);
+    for (size_t q = 0; q < resamplers.size(); q++)
+      {
+        Resamplers &r = resamplers[q];
+        r.oversample = 2 << q;
+        r.up_left    = std::make_unique<Resampler2> (Resampler2::UP, r.oversample, Resampler2::PREC_72DB);
+        r.up_right   = std::make_unique<Resampler2> (Resampler2::UP, r.oversample, Resampler2::PREC_72DB);
+        r.down_left  = std::make_unique<Resampler2> (Resampler2::DOWN, r.oversample, Resampler2::PREC_72DB);
+        r.down_right = std::make_unique<Resampler2> (Resampler2::DOWN, r.oversample, Resampler2::PREC_72DB);
+      }
+    res = &quality_resamplers (quality);
   }
   void
-  reset (unsigned int sample_rate)
+  reset (unsigned int new_sample_rate)
   {
-    mix_max_step = 1 / (0.050 * sample_rate * oversample);    // smooth mix range over 50ms
-    drive_max_step = 6 / (0.020 * sample_rate * oversample);  // smooth factor delta of 6dB over 20ms
+    sample_rate = new_sample_rate;
+    mix_max_step = 1 / (0.050 * sample_rate * res->oversample);    // smooth mix range over 50ms
+    drive_max_step = 6 / (0.020 * sample_rate * res->oversample);  // smooth factor delta of 6dB over 20ms
 
-    res_up_left->reset();
-    res_up_right->reset();
+    res->up_left->reset();
+    res->up_right->reset();
+  }
+  int
+  oversample() const
+  {
+    return res->oversample;
   }
   float
   lookup_table (float f)
@@ -131,10 +214,67 @@ public:
   {
     mode = new_mode;
   }
+  void
+  set_quality (Quality new_quality)
+  {
+    if (new_quality == quality)
+      return;
+    quality = new_quality;
+    res = &quality_resamplers (quality);
+    reset (sample_rate);
+    res->down_left->reset();
+    res->down_right->reset();
+  }
+  /* apply `saturate` with drive and dry/wet mix to n_samples (oversampled) samples, vectorized across samples */
+  template<bool STEREO, bool INCREMENT, class Saturate>
+  void
+  process_samples (float *left_over, float *right_over, int n_samples, float current_factor, float factor_step, float mix_step,
+                   const Saturate &saturate)
+  {
+    FloatV ramp;
+    for (uint l = 0; l < LANES; l++)
+      ramp[l] = INCREMENT ? l : 0;
+    FloatV factor = current_factor + factor_step * ramp;
+    FloatV mix = current_mix + mix_step * ramp;
+    auto process_vector = [&] (float *samples, uint n) {
+      alignas (64) float tmp[LANES] = { 0, };
+      std::copy (samples, samples + n, tmp);
+      FloatV x;
+      simd_load (x, tmp);
+      simd_store (tmp, saturate (x * factor) * mix + x * (1 - mix));
+      std::copy (tmp, tmp + n, samples);
+    };
+    int i = 0;
+    for (; i + int (LANES) <= n_samples; i += LANES)
+      {
+        FloatV x;
+        simd_load (x, left_over + i);
+        simd_store (left_over + i, saturate (x * factor) * mix + x * (1 - mix));
+        if (STEREO)
+          {
+            simd_load (x, right_over + i);
+            simd_store (right_over + i, saturate (x * factor) * mix + x * (1 - mix));
+          }
+        if (INCREMENT)
+          {
+            factor += factor_step * LANES;
+            mix += mix_step * LANES;
+          }
+      }
+    if (i < n_samples) // partial vector
+      {
+        process_vector (left_over + i, n_samples - i);
+        if (STEREO)
+          process_vector (right_over + i, n_samples - i);
+      }
+    if (INCREMENT)
+      current_mix += mix_step * n_samples;
+  }
   template<bool STEREO, bool INCREMENT>
   void
   process_sub_block (float *left_over, float *right_over, int n_samples)
   {
+    const int oversample = res->oversample;
     float mix_step = std::clamp ((dest_mix - current_mix) / (n_samples * oversample), -mix_max_step, mix_max_step);
     float drive_step = std::clamp ((dest_drive - current_drive) / (n_samples * oversample), -drive_max_step, drive_max_step);
 
@@ -144,73 +284,47 @@ public:
     float end_factor = exp2f (current_drive / 6);
     float factor_step = (end_factor - current_factor) / (n_samples * oversample);
 
-    if (mode == Mode::TANH_TABLE)
+    const Mode kernel = mode != Mode::SOFT ? mode :
+                        quality == Quality::CLASSIC || quality == Quality::DRAFT ? Mode::TANH_CHEAP :
+                        quality == Quality::NORMAL ? Mode::TANH_PADE : Mode::TANH_TRUE;
+    auto process = [&] (const auto &saturate) {
+      process_samples<STEREO, INCREMENT> (left_over, right_over, n_samples * oversample, current_factor, factor_step, mix_step, saturate);
+    };
+    switch (kernel)
       {
-        for (int i = 0; i < n_samples * oversample; i++)
-          {
-            left_over[i] = lookup_table (left_over[i] * current_factor) * current_mix + left_over[i] * (1 - current_mix);
-            if (STEREO)
-              right_over[i] = lookup_table (right_over[i] * current_factor) * current_mix + right_over[i] * (1 - current_mix);
-            if (INCREMENT)
-              {
-                current_mix += mix_step;
-                current_factor += factor_step;
-              }
-          }
-      }
-    if (mode == Mode::TANH_TRUE)
-      {
-        for (int i = 0; i < n_samples * oversample; i++)
-          {
-            left_over[i] = std::tanh (left_over[i] * current_factor) * current_mix + left_over[i] * (1 - current_mix);
-            if (STEREO)
-              right_over[i] = std::tanh (right_over[i] * current_factor) * current_mix + right_over[i] * (1 - current_mix);
-            if (INCREMENT)
-              {
-                current_mix += mix_step;
-                current_factor += factor_step;
-              }
-          }
-      }
-    if (mode == Mode::TANH_CHEAP)
-      {
-        for (int i = 0; i < n_samples * oversample; i++)
-          {
-            left_over[i] = cheap_tanh (left_over[i] * current_factor) * current_mix + left_over[i] * (1 - current_mix);
-            if (STEREO)
-              right_over[i] = cheap_tanh (right_over[i] * current_factor) * current_mix + right_over[i] * (1 - current_mix);
-            if (INCREMENT)
-              {
-                current_mix += mix_step;
-                current_factor += factor_step;
-              }
-          }
-      }
-    if (mode == Mode::HARD_CLIP)
-      {
-        for (int i = 0; i < n_samples * oversample; i++)
-          {
-            left_over[i] = std::clamp (left_over[i] * current_factor, -1.f, 1.f) * current_mix + left_over[i] * (1 - current_mix);
-            if (STEREO)
-              right_over[i] = std::clamp (right_over[i] * current_factor, -1.f, 1.f) * current_mix + right_over[i] * (1 - current_mix);
-            if (INCREMENT)
-              {
-                current_mix += mix_step;
-                current_factor += factor_step;
-              }
-          }
+      case Mode::TANH_TABLE:
+        process ([this] (FloatV x) {
+          for (uint l = 0; l < LANES; l++)
+            x[l] = lookup_table (x[l]);
+          return x;
+        });
+        break;
+      case Mode::TANH_TRUE:
+        process ([] (FloatV x) { return rational_tanh (x); });
+        break;
+      case Mode::TANH_PADE:
+        process ([] (FloatV x) { return pade_tanh (x); });
+        break;
+      case Mode::TANH_CHEAP:
+        process ([] (FloatV x) { return cheap_tanh (x); });
+        break;
+      case Mode::HARD_CLIP:
+        process ([] (FloatV x) { return hard_clip (x); });
+        break;
+      case Mode::SOFT: ; // resolved above
       }
   }
   template<bool STEREO>
   void
   process (float *left_in, float *right_in, float *left_out, float *right_out, int n_samples)
   {
-    float left_over[oversample * n_samples];
-    float right_over[oversample * n_samples];
+    const int oversample = res->oversample;
+    alignas (64) float left_over[max_oversample * n_samples];
+    alignas (64) float right_over[max_oversample * n_samples];
 
-    res_up_left->process_block (left_in, n_samples, left_over);
+    res->up_left->process_block (left_in, n_samples, left_over);
     if (STEREO)
-      res_up_right->process_block (right_in, n_samples, right_over);
+      res->up_right->process_block (right_in, n_samples, right_over);
 
     int pos = 0;
     while (pos < n_samples)
@@ -230,9 +344,9 @@ public:
           }
       }
 
-    res_down_left->process_block (left_over, oversample * n_samples, left_out);
+    res->down_left->process_block (left_over, oversample * n_samples, left_out);
     if (STEREO)
-      res_down_right->process_block (right_over, oversample * n_samples, right_out);
+      res->down_right->process_block (right_over, oversample * n_samples, right_out);
   }
 };
 